@@ -0,0 +1,370 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-async.hpp
+ * @brief Asynchronous sink used by the LoggerRegistry async mode
+ *
+ * The AsyncSink wraps the sink created by the LoggerRegistry. Calling threads copy each formatted
+ * record into a bounded lock-free queue and return; a dedicated backend thread drains the queue and
+ * writes to the wrapped sink.
+ */
+
+#pragma once
+
+#include <spdlog/details/log_msg.h>
+#include <spdlog/sinks/sink.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace tt {
+
+namespace detail {
+
+constexpr std::size_t cache_line_size = 64;
+
+/**
+ * @brief Bounded lock-free multi-producer single-consumer queue
+ *
+ * Dmitry Vyukov's bounded queue: every cell carries a sequence number that tells producers and the
+ * consumer whose turn it is, so producers only contend on a single compare-exchange of the enqueue
+ * position. Elements are written and read in place to avoid extra copies of the record payload.
+ */
+template <typename T> class MpscQueue {
+  private:
+    struct alignas(cache_line_size) Cell {
+        std::atomic<std::size_t> sequence;
+        T                        data;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t             mask_;
+
+    alignas(cache_line_size) std::atomic<std::size_t> enqueue_pos_{ 0 };
+    alignas(cache_line_size) std::atomic<std::size_t> dequeue_pos_{ 0 };
+
+    static std::size_t round_up_capacity(std::size_t capacity) {
+        std::size_t rounded = 2;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        return rounded;
+    }
+
+  public:
+    explicit MpscQueue(std::size_t capacity) :
+        cells_(new Cell[round_up_capacity(capacity)]), mask_(round_up_capacity(capacity) - 1) {
+        for (std::size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue &)             = delete;
+    MpscQueue & operator=(const MpscQueue &) = delete;
+
+    // Claims a cell and calls writer(T &) on it. Returns false without calling writer if the queue is full.
+    template <typename Writer> bool try_emplace(Writer && writer) {
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell *      cell;
+        for (;;) {
+            cell                = &cells_[pos & mask_];
+            std::size_t    seq  = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        writer(cell->data);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Calls reader(T &) on the oldest element and releases its cell. Must only be called by the consumer.
+    template <typename Reader> bool try_consume(Reader && reader) {
+        std::size_t pos  = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell *      cell = &cells_[pos & mask_];
+        if (cell->sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+        reader(cell->data);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        dequeue_pos_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Number of elements ever enqueued
+    std::size_t enqueued() const noexcept { return enqueue_pos_.load(std::memory_order_acquire); }
+
+    // Number of elements ever consumed
+    std::size_t consumed() const noexcept { return dequeue_pos_.load(std::memory_order_acquire); }
+
+    std::size_t size_approx() const noexcept {
+        std::size_t consumed_count = consumed();
+        std::size_t enqueued_count = enqueued();
+        return enqueued_count > consumed_count ? enqueued_count - consumed_count : 0;
+    }
+
+    std::size_t capacity() const noexcept { return mask_ + 1; }
+};
+
+// Owned copy of a spdlog::details::log_msg. Unlike log_msg_buffer it can be reassigned in place,
+// so queue cells keep their buffer capacity across records.
+struct AsyncRecord {
+    spdlog::details::log_msg msg;
+    spdlog::memory_buf_t     buffer;
+
+    void assign(const spdlog::details::log_msg & orig) {
+        buffer.clear();
+        buffer.append(orig.logger_name.begin(), orig.logger_name.end());
+        buffer.append(orig.payload.begin(), orig.payload.end());
+        msg             = orig;
+        msg.logger_name = spdlog::string_view_t{ buffer.data(), orig.logger_name.size() };
+        msg.payload     = spdlog::string_view_t{ buffer.data() + orig.logger_name.size(), orig.payload.size() };
+    }
+};
+
+// Lets a backend thread sleep while its input is empty. Producers only take the mutex when the
+// backend is asleep; a notification that races with falling asleep costs at most idle_wait of latency.
+class BackendWakeup {
+  public:
+    static constexpr std::chrono::milliseconds idle_wait{ 1 };
+
+    void notify_if_sleeping() {
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            notify();
+        }
+    }
+
+    void notify() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_one();
+    }
+
+    template <typename HasWork> void wait(HasWork && has_work) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleeping_.store(true, std::memory_order_relaxed);
+        if (!has_work()) {
+            cv_.wait_for(lock, idle_wait);
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+
+  private:
+    std::mutex              mutex_;
+    std::condition_variable cv_;
+    std::atomic<bool>       sleeping_{ false };
+};
+
+template <typename T> void atomic_max(std::atomic<T> & target, T value) {
+    T current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+}  // namespace detail
+
+// What a producer does when the async queue is full
+enum class AsyncOverflowPolicy {
+    block,  // Wait for the backend thread to free a slot (no message loss)
+    drop,   // Discard the message and count it in AsyncStats::dropped
+};
+
+struct AsyncStats {
+    std::uint64_t enqueued         = 0;  // Records accepted into the queue
+    std::uint64_t dropped          = 0;  // Records discarded because the queue was full
+    std::uint64_t latency_samples  = 0;  // Number of enqueue calls that were timed
+    std::uint64_t total_enqueue_ns = 0;  // Sum of the timed enqueue latencies
+    std::uint64_t max_enqueue_ns   = 0;  // Slowest timed enqueue
+    std::size_t   queue_depth      = 0;  // Records waiting for the backend thread right now
+    std::size_t   max_queue_depth  = 0;  // Deepest queue observed by the timed enqueues
+    std::size_t   queue_capacity   = 0;
+
+    double average_enqueue_ns() const {
+        return latency_samples ? static_cast<double>(total_enqueue_ns) / static_cast<double>(latency_samples) : 0.0;
+    }
+};
+
+/**
+ * @brief spdlog sink that hands records to a backend thread through a lock-free queue
+ *
+ * The calling thread only copies the already formatted record into a queue cell. The backend thread
+ * writes it to the wrapped sink, so callers never wait on the wrapped sink's mutex or on write(2).
+ * flush() waits until every record enqueued before the call has reached the wrapped sink.
+ */
+class AsyncSink final : public spdlog::sinks::sink {
+  public:
+    static constexpr std::size_t default_queue_size = 8192;
+
+    // One in this many enqueues per thread is timed for AsyncStats
+    static constexpr std::uint32_t latency_sample_interval = 64;
+
+    explicit AsyncSink(std::shared_ptr<spdlog::sinks::sink> inner, std::size_t queue_size = default_queue_size,
+                       AsyncOverflowPolicy policy = AsyncOverflowPolicy::block) :
+        inner_(std::move(inner)), queue_(queue_size), policy_(policy) {
+        worker_ = std::thread([this] { run(); });
+    }
+
+    ~AsyncSink() override { stop(); }
+
+    void log(const spdlog::details::log_msg & msg) override {
+        if (stopped_.load(std::memory_order_acquire)) {
+            write_after_stop(msg);
+            return;
+        }
+
+        thread_local std::uint32_t call_count = 0;
+        const bool                 timed      = (++call_count % latency_sample_interval) == 0;
+        const auto                 start      = timed ? std::chrono::steady_clock::now() : clock::time_point{};
+
+        auto writer = [&msg](detail::AsyncRecord & record) { record.assign(msg); };
+        while (!queue_.try_emplace(writer)) {
+            if (policy_ == AsyncOverflowPolicy::drop) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (stopped_.load(std::memory_order_acquire)) {
+                write_after_stop(msg);  // Nobody is left to free a slot
+                return;
+            }
+            wakeup_.notify();
+            std::this_thread::yield();
+        }
+        // Pairs with the fence of the backend thread once it has seen stopped_: either that thread drains
+        // this record, or this thread sees stopped_ and makes sure it is written
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (stopped_.load(std::memory_order_relaxed)) {
+            drain_after_stop();
+            return;
+        }
+        wakeup_.notify_if_sleeping();
+
+        if (timed) {
+            record_latency(std::chrono::steady_clock::now() - start);
+        }
+    }
+
+    void flush() override {
+        if (!stopped_.load(std::memory_order_acquire)) {
+            const std::size_t target = queue_.enqueued();
+            while (queue_.consumed() < target) {
+                wakeup_.notify();
+                std::this_thread::yield();
+            }
+        }
+        inner_->flush();
+    }
+
+    void set_pattern(const std::string & pattern) override { inner_->set_pattern(pattern); }
+
+    void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) override {
+        inner_->set_formatter(std::move(sink_formatter));
+    }
+
+    // Drains the queue and joins the backend thread. Later records are written synchronously, so the sink
+    // can stay in place while other threads are still logging.
+    void stop() {
+        if (stopped_.exchange(true)) {
+            return;
+        }
+        wakeup_.notify();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+        drained_.store(true, std::memory_order_release);
+        drain_after_stop();
+        inner_->flush();
+    }
+
+    AsyncStats stats() const {
+        AsyncStats stats;
+        stats.enqueued         = queue_.enqueued();
+        stats.dropped          = dropped_.load(std::memory_order_relaxed);
+        stats.latency_samples  = latency_samples_.load(std::memory_order_relaxed);
+        stats.total_enqueue_ns = total_enqueue_ns_.load(std::memory_order_relaxed);
+        stats.max_enqueue_ns   = max_enqueue_ns_.load(std::memory_order_relaxed);
+        stats.queue_depth      = queue_.size_approx();
+        stats.max_queue_depth  = max_queue_depth_.load(std::memory_order_relaxed);
+        stats.queue_capacity   = queue_.capacity();
+        return stats;
+    }
+
+    const std::shared_ptr<spdlog::sinks::sink> & inner() const noexcept { return inner_; }
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    std::shared_ptr<spdlog::sinks::sink>   inner_;
+    detail::MpscQueue<detail::AsyncRecord> queue_;
+    AsyncOverflowPolicy                    policy_;
+    std::thread                            worker_;
+    detail::BackendWakeup                  wakeup_;
+    std::atomic<bool>                      stopped_{ false };
+    std::atomic<bool>                      drained_{ false };  // Set once the backend thread has exited
+    std::mutex                             drain_mutex_;       // Makes one thread at a time the consumer
+    std::atomic<std::uint64_t>             dropped_{ 0 };
+    std::atomic<std::uint64_t>             latency_samples_{ 0 };
+    std::atomic<std::uint64_t>             total_enqueue_ns_{ 0 };
+    std::atomic<std::uint64_t>             max_enqueue_ns_{ 0 };
+    std::atomic<std::size_t>               max_queue_depth_{ 0 };
+
+    void record_latency(clock::duration elapsed) {
+        const auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        latency_samples_.fetch_add(1, std::memory_order_relaxed);
+        total_enqueue_ns_.fetch_add(ns, std::memory_order_relaxed);
+        detail::atomic_max(max_enqueue_ns_, ns);
+        detail::atomic_max(max_queue_depth_, queue_.size_approx());
+    }
+
+    // Writes the records enqueued by producers that raced with stop(), once the backend thread is gone
+    void drain_after_stop() {
+        while (!drained_.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        auto                        reader = [this](detail::AsyncRecord & record) { inner_->log(record.msg); };
+        std::lock_guard<std::mutex> lock(drain_mutex_);
+        while (queue_.try_consume(reader)) {
+        }
+    }
+
+    void write_after_stop(const spdlog::details::log_msg & msg) {
+        drain_after_stop();  // Records enqueued before this one come first
+        inner_->log(msg);
+    }
+
+    void run() {
+        auto reader = [this](detail::AsyncRecord & record) { inner_->log(record.msg); };
+        for (;;) {
+            if (queue_.try_consume(reader)) {
+                continue;
+            }
+            if (stopped_.load(std::memory_order_acquire)) {
+                // Producers may still be finishing an emplace they started before stop(). The fence pairs with
+                // the one in log(), so every enqueue that did not see stopped_ is counted in enqueued().
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                while (queue_.try_consume(reader) || queue_.consumed() < queue_.enqueued()) {
+                }
+                return;
+            }
+            wakeup_.wait([this] { return queue_.size_approx() != 0 || stopped_.load(std::memory_order_acquire); });
+        }
+    }
+};
+
+}  // namespace tt
@@ -0,0 +1,574 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-binary.hpp
+ * @brief Compact binary log file format: the BinarySink writer and the BinaryLogReader used by tt-logger-decode
+ *
+ * A binary log starts with the 8 byte magic "TTLOGBIN" and a version byte, followed by a stream of
+ * records, each introduced by a one byte tag:
+ *
+ * - logger:    varint id, string name
+ * - call_site: varint id, string file, varint line, string function, string format
+ * - message:   zigzag varint nanoseconds since the previous message, varint logger id, byte level,
+ *              varint call site id, varint thread id, arguments
+ *
+ * Strings are a varint length followed by the bytes. Logger and call site records are written once,
+ * the first time a message refers to them. The arguments of a message are either a byte holding the
+ * argument count followed by that many typed arguments, formatted with the call site's format string
+ * when decoding, or the preformatted_message marker followed by the already formatted text. Messages
+ * only carry typed arguments in deferred mode, where the raw arguments reach the sink; every other
+ * path hands the sink formatted text.
+ */
+
+#pragma once
+
+#include <fmt/args.h>
+#include <spdlog/details/file_helper.h>
+#include <spdlog/details/log_msg.h>
+#include <spdlog/sinks/base_sink.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace tt {
+
+namespace detail {
+
+constexpr char          binary_log_magic[8]  = { 'T', 'T', 'L', 'O', 'G', 'B', 'I', 'N' };
+constexpr std::uint8_t  binary_log_version   = 1;
+constexpr std::uint8_t  preformatted_message = 0xff;  // In place of the argument count
+constexpr std::uint32_t max_binary_args      = 254;
+
+enum class BinaryRecordTag : std::uint8_t {
+    logger    = 1,
+    call_site = 2,
+    message   = 3,
+};
+
+enum class BinaryArgType : std::uint8_t {
+    signed_int   = 1,  // zigzag varint
+    unsigned_int = 2,  // varint
+    float32      = 3,  // 4 bytes
+    float64      = 4,  // 8 bytes, also used for long double
+    boolean      = 5,  // 1 byte
+    character    = 6,  // 1 byte
+    string       = 7,  // varint length, bytes
+    null_string  = 8,  // a null const char *, no payload
+    pointer      = 9,  // varint address
+};
+
+inline void put_varint(spdlog::memory_buf_t & out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline std::uint64_t zigzag_encode(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t zigzag_decode(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+inline void put_string(spdlog::memory_buf_t & out, std::string_view value) {
+    put_varint(out, value.size());
+    out.append(value.data(), value.data() + value.size());
+}
+
+template <typename T> constexpr bool is_binary_string_v =
+    std::is_same_v<T, const char *> || std::is_same_v<T, char *> || std::is_same_v<T, std::string> ||
+    std::is_same_v<T, std::string_view> || std::is_same_v<T, fmt::string_view>;
+
+// Types that BinaryArgWriter can store with their type, so that the decoder formats them exactly as fmt would
+template <typename T> constexpr bool binary_encodable_v =
+    (std::is_arithmetic_v<T> && sizeof(T) <= sizeof(std::uint64_t)) || std::is_floating_point_v<T> ||
+    std::is_same_v<T, const void *> || std::is_same_v<T, void *> || is_binary_string_v<T>;
+
+// Integer type that decodes a log_clock time point losslessly
+inline std::int64_t to_nanoseconds(spdlog::log_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+}  // namespace detail
+
+/**
+ * @brief Writes the argument section of a binary message record
+ */
+class BinaryArgWriter {
+  public:
+    explicit BinaryArgWriter(spdlog::memory_buf_t & out) : out_(out) {}
+
+    // Starts a list of count typed arguments
+    void begin(std::size_t count) { out_.push_back(static_cast<char>(count)); }
+
+    // Stores the whole message as text instead of typed arguments
+    void write_message(std::string_view message) {
+        out_.push_back(static_cast<char>(detail::preformatted_message));
+        detail::put_string(out_, message);
+    }
+
+    template <typename T> void write(const T & value) {
+        static_assert(detail::binary_encodable_v<T>, "type has no binary log encoding");
+        if constexpr (std::is_same_v<T, bool>) {
+            put_type(detail::BinaryArgType::boolean);
+            out_.push_back(static_cast<char>(value ? 1 : 0));
+        } else if constexpr (std::is_same_v<T, char>) {
+            put_type(detail::BinaryArgType::character);
+            out_.push_back(value);
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            put_type(detail::BinaryArgType::signed_int);
+            detail::put_varint(out_, detail::zigzag_encode(static_cast<std::int64_t>(value)));
+        } else if constexpr (std::is_integral_v<T>) {
+            put_type(detail::BinaryArgType::unsigned_int);
+            detail::put_varint(out_, static_cast<std::uint64_t>(value));
+        } else if constexpr (std::is_same_v<T, float>) {
+            put_type(detail::BinaryArgType::float32);
+            put_bytes(value);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            put_type(detail::BinaryArgType::float64);
+            put_bytes(static_cast<double>(value));
+        } else if constexpr (std::is_pointer_v<T> && !detail::is_binary_string_v<T>) {
+            put_type(detail::BinaryArgType::pointer);
+            detail::put_varint(out_, reinterpret_cast<std::uintptr_t>(value));
+        } else if constexpr (std::is_pointer_v<T>) {
+            if (!value) {
+                put_type(detail::BinaryArgType::null_string);
+                return;
+            }
+            put_type(detail::BinaryArgType::string);
+            detail::put_string(out_, value);
+        } else {
+            put_type(detail::BinaryArgType::string);
+            detail::put_string(out_, std::string_view(value.data(), value.size()));
+        }
+    }
+
+  private:
+    spdlog::memory_buf_t & out_;
+
+    void put_type(detail::BinaryArgType type) { out_.push_back(static_cast<char>(type)); }
+
+    template <typename T> void put_bytes(T value) {
+        const char * bytes = reinterpret_cast<const char *>(&value);
+        out_.append(bytes, bytes + sizeof(T));
+    }
+};
+
+struct BinarySinkStats {
+    std::uint64_t records     = 0;  // Message records written
+    std::uint64_t call_sites  = 0;  // Distinct call sites interned
+    std::uint64_t bytes       = 0;  // Bytes handed to the file
+    std::uint64_t write_calls = 0;  // Writes issued to the file
+};
+
+/**
+ * @brief Sink that writes the compact binary format instead of text
+ *
+ * Records are encoded into an in-memory buffer that is written to the file once it holds
+ * write_buffer_size bytes or on flush, so a write reaches the file every few thousand messages.
+ */
+class BinarySink final : public spdlog::sinks::base_sink<std::mutex> {
+  public:
+    static constexpr std::size_t write_buffer_size = 64 * 1024;
+
+    explicit BinarySink(const spdlog::filename_t & filename) {
+        file_.open(filename, true);
+        buffer_.append(std::begin(detail::binary_log_magic), std::end(detail::binary_log_magic));
+        buffer_.push_back(static_cast<char>(detail::binary_log_version));
+    }
+
+    ~BinarySink() override {
+        try {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flush_();
+        } catch (...) {
+        }
+    }
+
+    // Writes a message whose arguments are encoded by write_args(BinaryArgWriter &) instead of taken from
+    // msg.payload. format is the format string the arguments belong to.
+    template <typename WriteArgs>
+    void log_encoded(const spdlog::details::log_msg & msg, std::string_view format, WriteArgs && write_args) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!should_log(msg.level)) {
+            return;
+        }
+        write_header(msg, format);
+        BinaryArgWriter writer(buffer_);
+        std::invoke(std::forward<WriteArgs>(write_args), writer);
+        end_message();
+    }
+
+    BinarySinkStats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+  protected:
+    void sink_it_(const spdlog::details::log_msg & msg) override {
+        write_header(msg, std::string_view());
+        BinaryArgWriter(buffer_).write_message(std::string_view(msg.payload.data(), msg.payload.size()));
+        end_message();
+    }
+
+    void flush_() override {
+        write_out();
+        file_.flush();
+    }
+
+  private:
+    struct CallSiteKey {
+        std::string_view file;
+        int              line;
+        std::string_view function;
+        std::string_view format;
+
+        bool operator==(const CallSiteKey & other) const {
+            return line == other.line && file == other.file && function == other.function && format == other.format;
+        }
+    };
+
+    struct CallSiteKeyHash {
+        std::size_t operator()(const CallSiteKey & key) const {
+            std::hash<std::string_view> hash;
+            std::size_t                 seed = hash(key.format);
+            seed ^= hash(key.file) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+            seed ^= hash(key.function) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+            seed ^= static_cast<std::size_t>(key.line) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+            return seed;
+        }
+    };
+
+    spdlog::details::file_helper                               file_;
+    spdlog::memory_buf_t                                       buffer_;
+    std::deque<std::string>                                    strings_;  // Owns the views held by the maps below
+    std::unordered_map<std::string_view, std::uint32_t>        loggers_;
+    std::unordered_map<CallSiteKey, std::uint32_t, CallSiteKeyHash> call_sites_;
+    std::int64_t                                               last_time_ns_ = 0;
+    BinarySinkStats                                            stats_;
+
+    std::string_view intern(std::string_view value) { return strings_.emplace_back(value); }
+
+    std::uint32_t logger_id(std::string_view name) {
+        auto it = loggers_.find(name);
+        if (it != loggers_.end()) {
+            return it->second;
+        }
+        const auto id = static_cast<std::uint32_t>(loggers_.size());
+        loggers_.emplace(intern(name), id);
+        buffer_.push_back(static_cast<char>(detail::BinaryRecordTag::logger));
+        detail::put_varint(buffer_, id);
+        detail::put_string(buffer_, name);
+        return id;
+    }
+
+    std::uint32_t call_site_id(const spdlog::source_loc & loc, std::string_view format) {
+        const CallSiteKey key{ loc.filename ? loc.filename : "", loc.line, loc.funcname ? loc.funcname : "", format };
+        auto              it = call_sites_.find(key);
+        if (it != call_sites_.end()) {
+            return it->second;
+        }
+        const auto id = static_cast<std::uint32_t>(call_sites_.size());
+        call_sites_.emplace(CallSiteKey{ intern(key.file), key.line, intern(key.function), intern(key.format) }, id);
+        buffer_.push_back(static_cast<char>(detail::BinaryRecordTag::call_site));
+        detail::put_varint(buffer_, id);
+        detail::put_string(buffer_, key.file);
+        detail::put_varint(buffer_, static_cast<std::uint64_t>(key.line));
+        detail::put_string(buffer_, key.function);
+        detail::put_string(buffer_, key.format);
+        ++stats_.call_sites;
+        return id;
+    }
+
+    void write_header(const spdlog::details::log_msg & msg, std::string_view format) {
+        const std::uint32_t logger    = logger_id(std::string_view(msg.logger_name.data(), msg.logger_name.size()));
+        const std::uint32_t call_site = call_site_id(msg.source, format);
+        const std::int64_t  time_ns   = detail::to_nanoseconds(msg.time);
+
+        buffer_.push_back(static_cast<char>(detail::BinaryRecordTag::message));
+        detail::put_varint(buffer_, detail::zigzag_encode(time_ns - last_time_ns_));
+        detail::put_varint(buffer_, logger);
+        buffer_.push_back(static_cast<char>(msg.level));
+        detail::put_varint(buffer_, call_site);
+        detail::put_varint(buffer_, msg.thread_id);
+        last_time_ns_ = time_ns;
+    }
+
+    void end_message() {
+        ++stats_.records;
+        if (buffer_.size() >= write_buffer_size) {
+            write_out();
+        }
+    }
+
+    void write_out() {
+        if (buffer_.size() == 0) {
+            return;
+        }
+        file_.write(buffer_);
+        stats_.bytes += buffer_.size();
+        ++stats_.write_calls;
+        buffer_.clear();
+    }
+};
+
+/**
+ * @brief Decodes a binary log back into spdlog log messages
+ */
+class BinaryLogReader {
+  public:
+    explicit BinaryLogReader(std::istream & in) : in_(in) {}
+
+    // Calls on_message(const spdlog::details::log_msg &) for every message in the stream. Returns false if the
+    // stream is not a binary log or ends in the middle of a record, as the file of a crashed process may.
+    template <typename OnMessage> bool read(OnMessage && on_message) {
+        char magic[sizeof(detail::binary_log_magic)];
+        if (!in_.read(magic, sizeof(magic)) || std::memcmp(magic, detail::binary_log_magic, sizeof(magic)) != 0) {
+            error_ = "not a tt-logger binary log";
+            return false;
+        }
+        std::uint8_t version = 0;
+        if (!get_byte(version) || version != detail::binary_log_version) {
+            error_ = "unsupported binary log version";
+            return false;
+        }
+
+        for (;;) {
+            const int tag = in_.get();
+            if (tag == std::char_traits<char>::eof()) {
+                return true;
+            }
+            if (!read_record(static_cast<detail::BinaryRecordTag>(tag), on_message)) {
+                if (error_.empty()) {
+                    error_ = "truncated record";
+                }
+                return false;
+            }
+        }
+    }
+
+    // Why read() returned false
+    const std::string & error() const { return error_; }
+
+  private:
+    struct CallSite {
+        std::string file;
+        int         line = 0;
+        std::string function;
+        std::string format;
+    };
+
+    std::istream &          in_;
+    std::vector<std::string> loggers_;
+    std::vector<CallSite>   call_sites_;
+    std::int64_t            last_time_ns_ = 0;
+    spdlog::memory_buf_t    message_;
+    std::string             error_;
+
+    bool get_byte(std::uint8_t & value) {
+        const int byte = in_.get();
+        value          = static_cast<std::uint8_t>(byte);
+        return byte != std::char_traits<char>::eof();
+    }
+
+    bool get_varint(std::uint64_t & value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            std::uint8_t byte;
+            if (!get_byte(byte)) {
+                return false;
+            }
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool get_string(std::string & value) {
+        std::uint64_t size;
+        if (!get_varint(size)) {
+            return false;
+        }
+        value.resize(size);
+        return static_cast<bool>(in_.read(value.data(), static_cast<std::streamsize>(size)));
+    }
+
+    template <typename T> bool get_bytes(T & value) {
+        return static_cast<bool>(in_.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+
+    template <typename OnMessage> bool read_record(detail::BinaryRecordTag tag, OnMessage & on_message) {
+        std::uint64_t id;
+        switch (tag) {
+            case detail::BinaryRecordTag::logger: {
+                std::string name;
+                if (!get_varint(id) || !get_string(name) || id != loggers_.size()) {
+                    return false;
+                }
+                loggers_.push_back(std::move(name));
+                return true;
+            }
+            case detail::BinaryRecordTag::call_site: {
+                CallSite      site;
+                std::uint64_t line;
+                if (!get_varint(id) || !get_string(site.file) || !get_varint(line) || !get_string(site.function) ||
+                    !get_string(site.format) || id != call_sites_.size()) {
+                    return false;
+                }
+                site.line = static_cast<int>(line);
+                call_sites_.push_back(std::move(site));
+                return true;
+            }
+            case detail::BinaryRecordTag::message: return read_message(on_message);
+        }
+        error_ = "unknown record tag";
+        return false;
+    }
+
+    template <typename OnMessage> bool read_message(OnMessage & on_message) {
+        std::uint64_t delta, logger, call_site, thread_id;
+        std::uint8_t  level;
+        if (!get_varint(delta) || !get_varint(logger) || !get_byte(level) || !get_varint(call_site) ||
+            !get_varint(thread_id) || logger >= loggers_.size() || call_site >= call_sites_.size()) {
+            return false;
+        }
+        if (!read_arguments(call_sites_[call_site].format)) {
+            return false;
+        }
+        last_time_ns_ += detail::zigzag_decode(delta);
+
+        const CallSite &              site = call_sites_[call_site];
+        const auto                    time = spdlog::log_clock::time_point(
+            std::chrono::duration_cast<spdlog::log_clock::duration>(std::chrono::nanoseconds(last_time_ns_)));
+        spdlog::details::log_msg msg(time,
+                                     spdlog::source_loc{ site.file.c_str(), site.line, site.function.c_str() },
+                                     spdlog::string_view_t(loggers_[logger].data(), loggers_[logger].size()),
+                                     static_cast<spdlog::level::level_enum>(level),
+                                     spdlog::string_view_t(message_.data(), message_.size()));
+        msg.thread_id = static_cast<std::size_t>(thread_id);
+        on_message(static_cast<const spdlog::details::log_msg &>(msg));
+        return true;
+    }
+
+    // Rebuilds the message text into message_
+    bool read_arguments(const std::string & format) {
+        message_.clear();
+        std::uint8_t count;
+        if (!get_byte(count)) {
+            return false;
+        }
+        if (count == detail::preformatted_message) {
+            std::string text;
+            if (!get_string(text)) {
+                return false;
+            }
+            message_.append(text.data(), text.data() + text.size());
+            return true;
+        }
+
+        fmt::dynamic_format_arg_store<fmt::format_context> args;
+        for (std::uint8_t index = 0; index < count; ++index) {
+            if (!read_argument(args)) {
+                return false;
+            }
+        }
+        try {
+            fmt::vformat_to(fmt::appender(message_), format, args);
+        } catch (const std::exception & e) {
+            message_.clear();
+            fmt::format_to(fmt::appender(message_), "[tt-logger] failed to format binary message: {}", e.what());
+        }
+        return true;
+    }
+
+    bool read_argument(fmt::dynamic_format_arg_store<fmt::format_context> & args) {
+        std::uint8_t  type;
+        std::uint64_t value;
+        if (!get_byte(type)) {
+            return false;
+        }
+        switch (static_cast<detail::BinaryArgType>(type)) {
+            case detail::BinaryArgType::signed_int:
+                if (!get_varint(value)) {
+                    return false;
+                }
+                args.push_back(detail::zigzag_decode(value));
+                return true;
+            case detail::BinaryArgType::unsigned_int:
+                if (!get_varint(value)) {
+                    return false;
+                }
+                args.push_back(value);
+                return true;
+            case detail::BinaryArgType::float32: {
+                float number;
+                if (!get_bytes(number)) {
+                    return false;
+                }
+                args.push_back(number);
+                return true;
+            }
+            case detail::BinaryArgType::float64: {
+                double number;
+                if (!get_bytes(number)) {
+                    return false;
+                }
+                args.push_back(number);
+                return true;
+            }
+            case detail::BinaryArgType::boolean: {
+                std::uint8_t flag;
+                if (!get_byte(flag)) {
+                    return false;
+                }
+                args.push_back(flag != 0);
+                return true;
+            }
+            case detail::BinaryArgType::character: {
+                std::uint8_t character;
+                if (!get_byte(character)) {
+                    return false;
+                }
+                args.push_back(static_cast<char>(character));
+                return true;
+            }
+            case detail::BinaryArgType::string: {
+                std::string text;
+                if (!get_string(text)) {
+                    return false;
+                }
+                args.push_back(std::move(text));
+                return true;
+            }
+            case detail::BinaryArgType::null_string: args.push_back(static_cast<const char *>(nullptr)); return true;
+            case detail::BinaryArgType::pointer:
+                if (!get_varint(value)) {
+                    return false;
+                }
+                args.push_back(reinterpret_cast<const void *>(static_cast<std::uintptr_t>(value)));
+                return true;
+        }
+        error_ = "unknown argument type";
+        return false;
+    }
+};
+
+}  // namespace tt
@@ -0,0 +1,180 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-clock.hpp
+ * @brief Cycle-counter timestamps for the deferred backend
+ *
+ * Reading the CPU cycle counter (rdtsc on x86-64, cntvct_el0 on AArch64) costs a few nanoseconds, a
+ * fraction of a system clock read. Log calls only store the raw counter; the backend thread converts it
+ * to wall-clock time with a TscClock that is calibrated against the system clock at startup and again
+ * every calibration_interval.
+ */
+
+#pragma once
+
+#include <spdlog/common.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#    else
+#        include <cpuid.h>
+#        include <x86intrin.h>
+#    endif
+#endif
+
+namespace tt {
+
+enum class TimestampSource {
+    system_clock,  // spdlog::log_clock::now() on the calling thread
+    tsc,           // CPU cycle counter, converted to wall-clock time on the backend thread
+};
+
+namespace detail {
+
+inline std::int64_t system_clock_ns() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(spdlog::log_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace detail
+
+/**
+ * @brief Converts cycle counter readings to wall-clock time
+ *
+ * The conversion is linear from the most recent calibration point, with the tick rate measured over
+ * the whole time since the first calibration, so it gets more accurate the longer the clock runs. A
+ * system clock step larger than max_step restarts the measurement. Not thread-safe: one TscClock
+ * belongs to the thread that converts timestamps.
+ */
+class TscClock {
+  public:
+    static constexpr std::chrono::milliseconds initial_calibration{ 2 };
+    static constexpr std::chrono::seconds      calibration_interval{ 1 };
+    static constexpr std::chrono::milliseconds max_step{ 1 };
+
+    // Whether the platform has a cycle counter that runs at a constant rate on every core
+    static bool available() noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+        // Invariant TSC: CPUID leaf 0x80000007, EDX bit 8
+#    if defined(_MSC_VER)
+        int regs[4] = { 0 };
+        __cpuid(regs, 0x80000007);
+        return (regs[3] & (1 << 8)) != 0;
+#    else
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8)) != 0;
+#    endif
+#elif defined(__aarch64__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Raw counter value; falls back to system clock nanoseconds where there is no cycle counter
+    static std::uint64_t ticks() noexcept {
+#if defined(__x86_64__) || defined(_M_X64)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        std::uint64_t value;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+        return value;
+#else
+        return static_cast<std::uint64_t>(detail::system_clock_ns());
+#endif
+    }
+
+    // Blocks for initial_calibration to measure the tick rate
+    TscClock() {
+        origin_ = sample();
+        const auto end = std::chrono::steady_clock::now() + initial_calibration;
+        while (std::chrono::steady_clock::now() < end) {
+            std::this_thread::yield();
+        }
+        recalibrate();
+    }
+
+    // Takes a new calibration point
+    void recalibrate() {
+        const Sample now = sample();
+        recalibrate(now.ticks, now.ns);
+    }
+
+    // Takes a calibration point from a counter reading and the system clock time it was taken at
+    void recalibrate(std::uint64_t ticks, std::int64_t ns) {
+        const Sample now{ ticks, ns };
+        if (base_.ticks != 0 && std::llabs(to_ns(now.ticks) - now.ns) > max_step_ns) {
+            // The system clock was stepped: keep the rate and measure it again from here on, as an interval
+            // across the step says nothing about it
+            origin_ = now;
+        } else if (now.ticks > origin_.ticks) {
+            ns_per_tick_ = static_cast<double>(now.ns - origin_.ns) / static_cast<double>(now.ticks - origin_.ticks);
+        }
+        base_             = now;
+        next_calibration_ = now.ticks + static_cast<std::uint64_t>(calibration_interval_ns / ns_per_tick_);
+    }
+
+    // Recalibrates if calibration_interval has passed since the last calibration
+    void maybe_recalibrate(std::uint64_t current_ticks) {
+        if (current_ticks >= next_calibration_) {
+            recalibrate();
+        }
+    }
+
+    std::int64_t to_ns(std::uint64_t value) const noexcept {
+        const auto delta = static_cast<std::int64_t>(value - base_.ticks);
+        return base_.ns + static_cast<std::int64_t>(static_cast<double>(delta) * ns_per_tick_);
+    }
+
+    spdlog::log_clock::time_point to_time_point(std::uint64_t value) const noexcept {
+        return spdlog::log_clock::time_point(
+            std::chrono::duration_cast<spdlog::log_clock::duration>(std::chrono::nanoseconds(to_ns(value))));
+    }
+
+    // Number of ticks in a duration at the calibrated rate
+    std::uint64_t ticks_in(std::chrono::nanoseconds duration) const noexcept {
+        return static_cast<std::uint64_t>(static_cast<double>(duration.count()) / ns_per_tick_);
+    }
+
+    double ns_per_tick() const noexcept { return ns_per_tick_; }
+
+  private:
+    static constexpr std::int64_t max_step_ns             = std::chrono::nanoseconds(max_step).count();
+    static constexpr double       calibration_interval_ns = std::chrono::nanoseconds(calibration_interval).count();
+
+    struct Sample {
+        std::uint64_t ticks = 0;
+        std::int64_t  ns    = 0;
+    };
+
+    Sample        origin_;
+    Sample        base_;
+    double        ns_per_tick_      = 1.0;
+    std::uint64_t next_calibration_ = 0;
+
+    // Pairs a counter reading with a system clock reading, keeping the tightest of a few attempts
+    static Sample sample() noexcept {
+        Sample        best;
+        std::uint64_t best_span = ~std::uint64_t{ 0 };
+        for (int attempt = 0; attempt < 5; ++attempt) {
+            const std::uint64_t before = ticks();
+            const std::int64_t  ns     = detail::system_clock_ns();
+            const std::uint64_t after  = ticks();
+            if (after - before < best_span) {
+                best_span  = after - before;
+                best.ticks = before + (after - before) / 2;
+                best.ns    = ns;
+            }
+        }
+        return best;
+    }
+};
+
+}  // namespace tt
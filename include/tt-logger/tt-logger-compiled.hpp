@@ -0,0 +1,137 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-compiled.hpp
+ * @brief The log_* macros of tt-logger.hpp over an entry point in the tt-logger::compiled library
+ *
+ * tt-logger.hpp brings spdlog and the whole of fmt into every translation unit that logs. This header
+ * only needs fmt/core.h: the level check stays inline, and the arguments are passed type-erased, as
+ * fmt::format_args, to tt::compiled::vlog(), which is built once in src/tt-logger-compiled.cpp. Link
+ * tt-logger::compiled (CMake option TT_LOGGER_BUILD_COMPILED) and include this header instead of
+ * tt-logger.hpp.
+ *
+ * The messages go through the same LoggerRegistry, so every environment variable, sink and backend works
+ * as usual. What needs a CallSite does not: calls are not registered in the call-site registry or the
+ * flight recorder, and TT_LOGGER_SITES rules do not apply to them. The rate-limited log_*_every_n,
+ * log_*_first_n and log_*_every_ms variants and TT_LOGGER_COMPILED_LEVELS are only in tt-logger.hpp.
+ */
+
+#pragma once
+
+#include <fmt/core.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <tt-logger/tt-logger-types.hpp>
+
+// Level numbers of spdlog, defined the same way by spdlog/common.h
+#ifndef SPDLOG_LEVEL_TRACE
+#    define SPDLOG_LEVEL_TRACE    0
+#    define SPDLOG_LEVEL_DEBUG    1
+#    define SPDLOG_LEVEL_INFO     2
+#    define SPDLOG_LEVEL_WARN     3
+#    define SPDLOG_LEVEL_ERROR    4
+#    define SPDLOG_LEVEL_CRITICAL 5
+#    define SPDLOG_LEVEL_OFF      6
+#endif
+
+#ifndef SPDLOG_ACTIVE_LEVEL
+#    define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#endif
+
+namespace tt {
+
+namespace compiled {
+
+// The runtime level table of tt-logger.hpp, one entry per LogType
+extern const std::atomic<std::uint8_t> * const log_type_levels;
+
+// Whether the current runtime level of type lets level, an SPDLOG_LEVEL_* number, through
+inline bool should_log(LogType type, int level) noexcept {
+    return level >= log_type_levels[static_cast<std::size_t>(type)].load(std::memory_order_relaxed);
+}
+
+// Formats a message and hands it to the LoggerRegistry. A format string the arguments do not fit is
+// written as it is.
+void vlog(LogType type, int level, const char * file, int line, const char * function, fmt::string_view format,
+          fmt::format_args args);
+
+template <typename... Args>
+void log(LogType type, int level, const char * file, int line, const char * function,
+         fmt::format_string<Args...> format, Args &&... args) {
+    vlog(type, level, file, line, function, format, fmt::make_format_args(args...));
+}
+
+// Message without arguments, written as it is like in tt-logger.hpp
+template <typename T>
+void log(LogType type, int level, const char * file, int line, const char * function, const T & msg) {
+    vlog(type, level, file, line, function, "{}", fmt::make_format_args(msg));
+}
+
+}  // namespace compiled
+
+}  // namespace tt
+
+#ifndef TT_LOGGER_LOGTYPE_FORMATTER
+#    define TT_LOGGER_LOGTYPE_FORMATTER
+namespace fmt {
+template <> struct formatter<tt::LogType> : fmt::formatter<std::string_view> {
+    template <typename FormatContext> constexpr auto format(tt::LogType logtype, FormatContext & ctx) const {
+        return fmt::formatter<std::string_view>::format(tt::logtype_to_string(logtype), ctx);
+    }
+};
+}  // namespace fmt
+#endif
+
+// tt-logger.hpp defines the same macros, and replaces these when it is included later
+#ifndef TT_LOGGER_CALL
+
+#    define TT_LOGGER_COMPILED_CALL(type, level, ...)                                 \
+        (!tt::compiled::should_log(type, level) ?                                     \
+             (void) 0 :                                                               \
+             tt::compiled::log(type, level, __FILE__, __LINE__,                       \
+                               static_cast<const char *>(__FUNCTION__), __VA_ARGS__))
+
+#    if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
+#        define log_trace(type, ...) TT_LOGGER_COMPILED_CALL(type, SPDLOG_LEVEL_TRACE, __VA_ARGS__)
+#    else
+#        define log_trace(type, ...) (void) 0
+#    endif
+
+#    if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#        define log_debug(type, ...) TT_LOGGER_COMPILED_CALL(type, SPDLOG_LEVEL_DEBUG, __VA_ARGS__)
+#    else
+#        define log_debug(type, ...) (void) 0
+#    endif
+
+#    if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
+#        define log_info(type, ...) TT_LOGGER_COMPILED_CALL(type, SPDLOG_LEVEL_INFO, __VA_ARGS__)
+#    else
+#        define log_info(type, ...) (void) 0
+#    endif
+
+#    if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
+#        define log_warning(type, ...) TT_LOGGER_COMPILED_CALL(type, SPDLOG_LEVEL_WARN, __VA_ARGS__)
+#    else
+#        define log_warning(type, ...) (void) 0
+#    endif
+
+#    if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ERROR
+#        define log_error(type, ...) TT_LOGGER_COMPILED_CALL(type, SPDLOG_LEVEL_ERROR, __VA_ARGS__)
+#    else
+#        define log_error(type, ...) (void) 0
+#    endif
+
+#    if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_CRITICAL
+#        define log_critical(type, ...) TT_LOGGER_COMPILED_CALL(type, SPDLOG_LEVEL_CRITICAL, __VA_ARGS__)
+#        define log_fatal(type, ...)    TT_LOGGER_COMPILED_CALL(type, SPDLOG_LEVEL_CRITICAL, __VA_ARGS__)
+#    else
+#        define log_critical(type, ...) (void) 0
+#        define log_fatal(type, ...)    (void) 0
+#    endif
+
+#endif
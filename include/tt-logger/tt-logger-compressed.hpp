@@ -0,0 +1,320 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-compressed.hpp
+ * @brief Text file sink that compresses the log in independent blocks on a background thread
+ *
+ * TT_LOGGER_FILE=run.log.gz writes the formatted text through a CompressedFileSink. Log calls only copy
+ * their text into an in-memory block; a low-priority background thread compresses each full block into a
+ * gzip member of its own and appends it to the file. Concatenated gzip members are themselves a valid gzip
+ * file, so `zcat run.log.gz` reads the log, and a file cut short by a crash still decodes up to the last
+ * complete block.
+ *
+ * Compression needs zlib. The CMake target links it and defines TT_LOGGER_HAS_COMPRESSION=1 when zlib is
+ * found; without it, a .gz path is written as plain text under the name without .gz, with a warning.
+ */
+
+#pragma once
+
+#include <string_view>
+
+#ifndef TT_LOGGER_HAS_COMPRESSION
+#    define TT_LOGGER_HAS_COMPRESSION 0
+#endif
+
+namespace tt {
+
+inline constexpr std::string_view compressed_log_extension = ".gz";
+
+}  // namespace tt
+
+#if TT_LOGGER_HAS_COMPRESSION
+
+#    include <spdlog/common.h>
+#    include <spdlog/details/log_msg.h>
+#    include <spdlog/sinks/base_sink.h>
+#    include <zlib.h>
+
+#    include <cerrno>
+#    include <chrono>
+#    include <condition_variable>
+#    include <cstddef>
+#    include <cstdint>
+#    include <cstdio>
+#    include <cstring>
+#    include <ctime>
+#    include <deque>
+#    include <mutex>
+#    include <string>
+#    include <string_view>
+#    include <thread>
+#    include <utility>
+#    include <vector>
+
+#    if defined(__linux__)
+#        include <sys/resource.h>
+#        include <sys/syscall.h>
+#        include <unistd.h>
+#    endif
+
+namespace tt {
+
+struct CompressionStats {
+    std::uint64_t blocks       = 0;  // Blocks compressed and written to the file
+    std::uint64_t input_bytes  = 0;  // Text bytes in those blocks
+    std::uint64_t output_bytes = 0;  // Compressed bytes written for them
+    std::uint64_t compress_ns  = 0;  // Wall time spent compressing
+    std::uint64_t cpu_ns       = 0;  // CPU time of the compression thread
+    std::uint64_t waits        = 0;  // Log calls that waited because every block buffer was queued
+
+    CompressionStats & operator+=(const CompressionStats & other) {
+        blocks += other.blocks;
+        input_bytes += other.input_bytes;
+        output_bytes += other.output_bytes;
+        compress_ns += other.compress_ns;
+        cpu_ns += other.cpu_ns;
+        waits += other.waits;
+        return *this;
+    }
+
+    double ratio() const {
+        return output_bytes ? static_cast<double>(input_bytes) / static_cast<double>(output_bytes) : 0.0;
+    }
+
+    // Text bytes compressed per second of compression time, in MB/s
+    double throughput_mb_per_s() const {
+        return compress_ns ? static_cast<double>(input_bytes) * 1e3 / static_cast<double>(compress_ns) : 0.0;
+    }
+};
+
+/**
+ * @brief Text file sink that writes a gzip member per block from a background thread
+ *
+ * A block is handed to the compression thread once it holds block_size bytes, or on flush. At most
+ * max_queued_blocks blocks wait for compression; a log call that needs another one waits for the thread to
+ * catch up, which stats().waits counts.
+ */
+class CompressedFileSink final : public spdlog::sinks::base_sink<std::mutex> {
+  public:
+    static constexpr std::size_t default_block_size = 256 * 1024;
+    static constexpr std::size_t max_queued_blocks  = 4;
+    static constexpr int         default_level      = Z_BEST_SPEED;
+    static constexpr int         thread_nice        = 10;  // Scheduling priority of the compression thread
+
+    explicit CompressedFileSink(const std::string & filename, std::size_t block_size = default_block_size,
+                                int level = default_level) :
+        block_size_(block_size) {
+        file_ = std::fopen(filename.c_str(), "wb");
+        if (!file_) {
+            spdlog::throw_spdlog_ex("Failed opening file " + filename + " for writing", errno);
+        }
+        // windowBits 15 + 16 selects the gzip wrapper
+        if (deflateInit2(&stream_, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            std::fclose(file_);
+            spdlog::throw_spdlog_ex("Failed initializing compression for " + filename);
+        }
+        block_.reserve(block_size_);
+        compressor_ = std::thread([this] { compress_blocks(); });
+    }
+
+    ~CompressedFileSink() override {
+        try {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flush_();
+        } catch (...) {
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            stopping_ = true;
+        }
+        queue_cv_.notify_all();
+        compressor_.join();
+        deflateEnd(&stream_);
+        std::fclose(file_);
+    }
+
+    CompressionStats stats() {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        return stats_;
+    }
+
+  protected:
+    void sink_it_(const spdlog::details::log_msg & msg) override {
+        spdlog::memory_buf_t formatted;
+        formatter_->format(msg, formatted);
+        if (!block_.empty() && block_.size() + formatted.size() > block_size_) {
+            submit_block();
+        }
+        block_.append(formatted.data(), formatted.size());
+    }
+
+    // Compresses everything logged so far and waits until it is in the file
+    void flush_() override {
+        if (!block_.empty()) {
+            submit_block();
+        }
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        queue_cv_.wait(lock, [&] { return (queued_.empty() && !compressing_) || !error_.empty(); });
+        throw_if_failed();
+    }
+
+  private:
+    std::size_t block_size_;
+    std::string block_;  // Block being filled, under mutex_
+    std::FILE * file_   = nullptr;
+    z_stream    stream_ = {};  // Used by the compression thread only
+
+    // Shared with the compression thread under queue_mutex_
+    std::mutex               queue_mutex_;
+    std::condition_variable  queue_cv_;
+    std::deque<std::string>  queued_;  // Full blocks waiting for compression, oldest first
+    std::vector<std::string> free_;    // Emptied blocks to reuse
+    bool                     compressing_ = false;
+    bool                     stopping_    = false;
+    std::string              error_;
+    CompressionStats         stats_;
+    std::thread              compressor_;
+
+    // Called with queue_mutex_ held
+    void throw_if_failed() const {
+        if (!error_.empty()) {
+            spdlog::throw_spdlog_ex(error_);
+        }
+    }
+
+    // Queues block_ for compression and starts a new one. Called under mutex_.
+    void submit_block() {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        if (free_.empty() && queued_.size() >= max_queued_blocks) {
+            ++stats_.waits;
+            queue_cv_.wait(lock, [&] { return !free_.empty() || !error_.empty(); });
+        }
+        throw_if_failed();
+        queued_.push_back(std::move(block_));
+        if (free_.empty()) {
+            block_ = std::string();
+            block_.reserve(block_size_);
+        } else {
+            block_ = std::move(free_.back());
+            free_.pop_back();
+        }
+        lock.unlock();
+        queue_cv_.notify_all();
+    }
+
+    static std::uint64_t thread_cpu_ns() {
+        timespec now{};
+        ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return static_cast<std::uint64_t>(now.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(now.tv_nsec);
+    }
+
+    // Compresses `block` into one complete gzip member in `output`
+    bool compress(const std::string & block, std::vector<unsigned char> & output) {
+        output.resize(deflateBound(&stream_, static_cast<uLong>(block.size())));
+        stream_.next_in   = reinterpret_cast<Bytef *>(const_cast<char *>(block.data()));
+        stream_.avail_in  = static_cast<uInt>(block.size());
+        stream_.next_out  = output.data();
+        stream_.avail_out = static_cast<uInt>(output.size());
+        const int result  = deflate(&stream_, Z_FINISH);
+        output.resize(output.size() - stream_.avail_out);
+        deflateReset(&stream_);
+        return result == Z_STREAM_END;
+    }
+
+    // Background thread: compresses queued blocks in order and appends them to the file
+    void compress_blocks() {
+#    if defined(__linux__)
+        // Linux applies nice values to single threads; a busy compressor then yields to the logging threads
+        (void) ::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), thread_nice);
+#    endif
+        std::vector<unsigned char>   output;
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        for (;;) {
+            queue_cv_.wait(lock, [&] { return stopping_ || !queued_.empty(); });
+            if (queued_.empty()) {
+                break;
+            }
+            std::string block = std::move(queued_.front());
+            queued_.pop_front();
+            compressing_ = true;
+            lock.unlock();
+
+            const std::uint64_t cpu_start = thread_cpu_ns();
+            const auto          start     = std::chrono::steady_clock::now();
+            std::string         error;
+            if (!compress(block, output)) {
+                error = "Failed compressing a log block";
+            }
+            const auto compress_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now() - start)
+                                         .count();
+            // Each member is flushed to the file whole, so a crash loses at most the blocks not yet written
+            if (error.empty() && (std::fwrite(output.data(), 1, output.size(), file_) != output.size() ||
+                                  std::fflush(file_) != 0)) {
+                error = std::string("Failed writing compressed log: ") + std::strerror(errno);
+            }
+            const std::uint64_t cpu_ns = thread_cpu_ns() - cpu_start;
+
+            lock.lock();
+            if (error.empty()) {
+                ++stats_.blocks;
+                stats_.input_bytes += block.size();
+                stats_.output_bytes += output.size();
+                stats_.compress_ns += static_cast<std::uint64_t>(compress_ns);
+            } else if (error_.empty()) {
+                error_ = error;
+            }
+            stats_.cpu_ns += cpu_ns;
+            block.clear();
+            free_.push_back(std::move(block));
+            compressing_ = false;
+            queue_cv_.notify_all();
+        }
+    }
+};
+
+struct DecompressedLog {
+    std::string text;               // Text of every complete block
+    std::size_t blocks    = 0;      // Complete blocks decoded
+    bool        truncated = false;  // The data ended inside a block or was corrupt from there on
+};
+
+// Decodes the blocks of a compressed log, stopping at the first incomplete or damaged one
+inline DecompressedLog decompress_log(std::string_view data) {
+    DecompressedLog log;
+    z_stream        stream = {};
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+        log.truncated = !data.empty();
+        return log;
+    }
+    std::string   block;
+    unsigned char chunk[64 * 1024];
+    while (!data.empty()) {
+        stream.next_in  = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        int result      = Z_OK;
+        while (result == Z_OK) {
+            stream.next_out  = chunk;
+            stream.avail_out = sizeof(chunk);
+            result           = inflate(&stream, Z_NO_FLUSH);
+            block.append(reinterpret_cast<const char *>(chunk), sizeof(chunk) - stream.avail_out);
+        }
+        if (result != Z_STREAM_END) {
+            log.truncated = true;
+            break;
+        }
+        log.text += block;
+        block.clear();
+        ++log.blocks;
+        data.remove_prefix(data.size() - stream.avail_in);
+        inflateReset(&stream);
+    }
+    inflateEnd(&stream);
+    return log;
+}
+
+}  // namespace tt
+
+#endif  // TT_LOGGER_HAS_COMPRESSION
@@ -0,0 +1,228 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-config.hpp
+ * @brief Configuration file (TT_LOGGER_CONFIG) parsing and change notification
+ *
+ * The file holds one "key = value" setting per line; '#' starts a comment. Every key is the name of the
+ * matching environment variable without the TT_LOGGER_ prefix, in lower case, plus a few settings that
+ * only exist in the file:
+ *
+ *   level = warning,Fabric:debug      # TT_LOGGER_LEVEL
+ *   types = All,-MetalTrace           # TT_LOGGER_TYPES
+ *   pattern = %H:%M:%S.%e %n %v       # Output pattern of the text sink
+ *   rate_limit = 1000,Fabric:100      # Messages per second and LogType, 0 for no limit
+ *   sample_rate = Dispatch:1000       # TT_LOGGER_SAMPLE_RATE
+ *
+ * A ConfigWatcher reports changes to the file from a background thread (Linux only).
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#    include <fcntl.h>
+#    include <poll.h>
+#    include <sys/inotify.h>
+#    include <unistd.h>
+#    define TT_LOGGER_HAS_CONFIG_WATCH 1
+#else
+#    define TT_LOGGER_HAS_CONFIG_WATCH 0
+#endif
+
+namespace tt {
+
+// Settings of a configuration file by key
+using ConfigValues = std::map<std::string, std::string, std::less<>>;
+
+// Keys a configuration file may set
+inline constexpr std::string_view config_keys[] = {
+    "level",                 // TT_LOGGER_LEVEL
+    "types",                 // TT_LOGGER_TYPES
+    "file",                  // TT_LOGGER_FILE
+    "file_per_type",         // TT_LOGGER_FILE_PER_TYPE
+    "rotate_size",           // TT_LOGGER_ROTATE_SIZE
+    "rotate_interval",       // TT_LOGGER_ROTATE_INTERVAL
+    "pattern",               // Output pattern of the text sink
+    "rate_limit",            // Messages per second and LogType
+    "sample_rate",           // TT_LOGGER_SAMPLE_RATE
+    "sites",                 // TT_LOGGER_SITES
+    "async",                 // TT_LOGGER_ASYNC
+    "async_queue_size",      // TT_LOGGER_ASYNC_QUEUE_SIZE
+    "async_overflow",        // TT_LOGGER_ASYNC_OVERFLOW
+    "deferred",              // TT_LOGGER_DEFERRED
+    "deferred_buffer_size",  // TT_LOGGER_DEFERRED_BUFFER_SIZE
+    "timestamp",             // TT_LOGGER_TIMESTAMP
+    "backtrace",             // TT_LOGGER_BACKTRACE
+    "backtrace_size",        // TT_LOGGER_BACKTRACE_SIZE
+    "dedup",                 // TT_LOGGER_DEDUP
+    "dedup_timeout",         // TT_LOGGER_DEDUP_TIMEOUT
+    "flight_recorder",       // TT_LOGGER_FLIGHT_RECORDER
+    "flight_recorder_file",  // TT_LOGGER_FLIGHT_RECORDER_FILE
+    "flight_recorder_size",  // TT_LOGGER_FLIGHT_RECORDER_SIZE
+};
+
+/**
+ * @brief Parses the text of a configuration file
+ *
+ * Invalid lines and unknown keys are skipped after calling on_error(const char * problem, std::string_view
+ * line). A key given twice keeps its last value.
+ */
+template <typename OnError> ConfigValues parse_config(std::string_view text, OnError && on_error) {
+    const auto trim = [](std::string_view s) {
+        const std::size_t begin = s.find_first_not_of(" \t\r");
+        if (begin == std::string_view::npos) {
+            return std::string_view{};
+        }
+        return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+    };
+
+    ConfigValues values;
+    while (!text.empty()) {
+        const std::size_t end  = text.find('\n');
+        std::string_view  line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        const std::size_t equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            on_error("line without '='", line);
+            continue;
+        }
+        const std::string_view key   = trim(line.substr(0, equals));
+        bool                   known = false;
+        for (const std::string_view config_key : config_keys) {
+            known = known || key == config_key;
+        }
+        if (!known) {
+            on_error("unknown key", line);
+            continue;
+        }
+        values[std::string(key)] = std::string(trim(line.substr(equals + 1)));
+    }
+    return values;
+}
+
+// Reads and parses a configuration file; throws std::runtime_error if it cannot be read
+template <typename OnError> ConfigValues read_config(const std::string & path, OnError && on_error) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("tt-logger: cannot read config file '" + path + "'");
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    return parse_config(text.str(), std::forward<OnError>(on_error));
+}
+
+#if TT_LOGGER_HAS_CONFIG_WATCH
+
+/**
+ * @brief Calls a function from a background thread whenever a file is written, replaced or created
+ *
+ * The watch is on the file's directory, so it follows editors and tools that replace the file by renaming
+ * a new one over it. Changes arriving within settle_time_ms of each other are reported once.
+ */
+class ConfigWatcher {
+  public:
+    static constexpr int settle_time_ms = 50;
+
+    ConfigWatcher(const std::string & path, std::function<void()> on_change) : on_change_(std::move(on_change)) {
+        const std::size_t slash     = path.rfind('/');
+        const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        name_                       = slash == std::string::npos ? path : path.substr(slash + 1);
+
+        inotify_fd_ = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (inotify_fd_ < 0 ||
+            ::inotify_add_watch(inotify_fd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0 ||
+            ::pipe2(wake_fds_, O_CLOEXEC) < 0) {
+            const std::string error = std::strerror(errno);
+            if (inotify_fd_ >= 0) {
+                ::close(inotify_fd_);
+            }
+            throw std::runtime_error("tt-logger: cannot watch config file '" + path + "': " + error);
+        }
+
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ConfigWatcher(const ConfigWatcher &)             = delete;
+    ConfigWatcher & operator=(const ConfigWatcher &) = delete;
+
+    ~ConfigWatcher() {
+        const char wake = 1;
+        while (::write(wake_fds_[1], &wake, 1) < 0 && errno == EINTR) {
+        }
+        thread_.join();
+        ::close(inotify_fd_);
+        ::close(wake_fds_[0]);
+        ::close(wake_fds_[1]);
+    }
+
+  private:
+    std::function<void()> on_change_;
+    std::string           name_;
+    int                   inotify_fd_  = -1;
+    int                   wake_fds_[2] = { -1, -1 };
+    std::thread           thread_;
+
+    // Whether the queued events mention the watched file
+    bool drain_events() {
+        alignas(inotify_event) char buffer[4096];
+        bool                        changed = false;
+        for (;;) {
+            const ssize_t length = ::read(inotify_fd_, buffer, sizeof(buffer));
+            if (length <= 0) {
+                return changed;
+            }
+            for (ssize_t offset = 0; offset < length;) {
+                const auto * event = reinterpret_cast<const inotify_event *>(buffer + offset);
+                changed            = changed || (event->len > 0 && name_ == event->name);
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+    }
+
+    void run() {
+        bool pending = false;
+        for (;;) {
+            pollfd fds[2] = {
+                { inotify_fd_, POLLIN, 0 },
+                { wake_fds_[0], POLLIN, 0 },
+            };
+            const int ready = ::poll(fds, 2, pending ? settle_time_ms : -1);
+            if (ready < 0 && errno != EINTR) {
+                return;
+            }
+            if (fds[1].revents) {
+                return;
+            }
+            if (ready > 0 && (fds[0].revents & POLLIN)) {
+                pending = drain_events() || pending;
+            } else if (ready == 0 && pending) {
+                pending = false;
+                on_change_();
+            }
+        }
+    }
+};
+
+#endif  // TT_LOGGER_HAS_CONFIG_WATCH
+
+}  // namespace tt
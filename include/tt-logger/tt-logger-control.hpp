@@ -0,0 +1,299 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-control.hpp
+ * @brief Unix domain socket control plane for changing a running process's log configuration
+ *
+ * A ControlServer listens on a local socket from a background thread and hands every received line to a
+ * handler, sending the handler's reply back. The protocol is one command per line; every reply starts
+ * with a line that is either "ok" or "error: <reason>", optionally followed by more output. The server
+ * never touches the logging hot path: it only runs when a client connects.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#    include <fcntl.h>
+#    include <poll.h>
+#    include <sys/socket.h>
+#    include <sys/stat.h>
+#    include <sys/un.h>
+#    include <unistd.h>
+#    define TT_LOGGER_HAS_CONTROL_SOCKET 1
+#else
+#    define TT_LOGGER_HAS_CONTROL_SOCKET 0
+#endif
+
+namespace tt {
+
+#if TT_LOGGER_HAS_CONTROL_SOCKET
+
+namespace detail {
+
+inline sockaddr_un control_socket_address(const std::string & path) {
+    sockaddr_un address{};
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("tt-logger: invalid control socket path '" + path + "'");
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+inline std::runtime_error control_socket_error(const char * what, const std::string & path) {
+    return std::runtime_error(std::string("tt-logger: cannot ") + what + " control socket '" + path +
+                              "': " + std::strerror(errno));
+}
+
+// Writes all of data, returning false if the peer went away
+inline bool write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t written = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+    }
+    return true;
+}
+
+}  // namespace detail
+
+// Default socket path of the process with the given pid, used when TT_LOGGER_CONTROL_SOCKET is "1"
+inline std::string default_control_socket_path(long pid) {
+    return "/tmp/tt-logger-" + std::to_string(pid) + ".sock";
+}
+
+/**
+ * @brief Background listener for control commands
+ *
+ * Clients are served one at a time. A client that sends nothing for client_timeout_ms is disconnected so it
+ * cannot block others. The socket file is removed when the server stops.
+ *
+ * Commands change the process's logging and can make it write files, so the socket is created with mode
+ * 0600 and clients running as another user are turned away with an error. A path that exists and is not a
+ * socket is left alone and the server is not started.
+ */
+class ControlServer {
+  public:
+    using Handler = std::function<std::string(std::string_view command)>;
+
+    static constexpr int         client_timeout_ms = 1000;
+    static constexpr std::size_t max_line_length   = 4096;
+
+    ControlServer(std::string path, Handler handler) : path_(std::move(path)), handler_(std::move(handler)) {
+        const sockaddr_un address = detail::control_socket_address(path_);
+
+        listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            throw detail::control_socket_error("create", path_);
+        }
+        // A socket file left behind by an earlier process with the same pid would make bind fail. Anything
+        // else at the path is most likely a mistyped TT_LOGGER_CONTROL_SOCKET.
+        struct stat existing;
+        if (::lstat(path_.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                ::close(listen_fd_);
+                throw std::runtime_error("tt-logger: not replacing '" + path_ + "' with the control socket: " +
+                                         "it exists and is not a socket");
+            }
+            ::unlink(path_.c_str());
+        }
+        // Connections are refused until listen(), so nobody gets in before the mode is set
+        if (::bind(listen_fd_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0) {
+            const auto error = detail::control_socket_error("bind", path_);
+            ::close(listen_fd_);
+            throw error;
+        }
+        if (::chmod(path_.c_str(), S_IRUSR | S_IWUSR) < 0 || ::listen(listen_fd_, 4) < 0) {
+            const auto error = detail::control_socket_error("listen on", path_);
+            ::close(listen_fd_);
+            throw error;
+        }
+        if (::pipe2(wake_fds_, O_CLOEXEC) < 0) {
+            const auto error = detail::control_socket_error("create wakeup pipe for", path_);
+            ::close(listen_fd_);
+            ::unlink(path_.c_str());
+            throw error;
+        }
+
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ControlServer(const ControlServer &)             = delete;
+    ControlServer & operator=(const ControlServer &) = delete;
+
+    ~ControlServer() { stop(); }
+
+    // Finishes the command in progress, stops the listener thread and removes the socket file
+    void stop() {
+        if (!thread_.joinable()) {
+            return;
+        }
+        const char wake = 1;
+        while (::write(wake_fds_[1], &wake, 1) < 0 && errno == EINTR) {
+        }
+        thread_.join();
+        ::close(listen_fd_);
+        ::close(wake_fds_[0]);
+        ::close(wake_fds_[1]);
+        ::unlink(path_.c_str());
+    }
+
+    const std::string & path() const { return path_; }
+
+  private:
+    std::string path_;
+    Handler     handler_;
+    int         listen_fd_   = -1;
+    int         wake_fds_[2] = { -1, -1 };
+    std::thread thread_;
+
+    void run() {
+        for (;;) {
+            pollfd fds[2] = {
+                { listen_fd_, POLLIN, 0 },
+                { wake_fds_[0], POLLIN, 0 },
+            };
+            if (::poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            if (fds[1].revents) {
+                return;
+            }
+            if (fds[0].revents & POLLIN) {
+                const int client = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+                if (client >= 0) {
+                    if (same_user(client)) {
+                        serve(client);
+                    } else {
+                        refuse(client);
+                    }
+                    ::close(client);
+                }
+            }
+        }
+    }
+
+    // Whether the client runs as the user of this process; the mode of the socket file alone depends on who
+    // can reach its directory
+    static bool same_user(int client) {
+        ucred     credentials{};
+        socklen_t length = sizeof(credentials);
+        return ::getsockopt(client, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 &&
+               credentials.uid == ::geteuid();
+    }
+
+    // Replies with an error and waits for the client to hang up, as closing with its command unread would
+    // reset the connection before the client reads the reply
+    static void refuse(int client) {
+        if (!detail::write_all(client, "error: permission denied\n") || ::shutdown(client, SHUT_WR) < 0) {
+            return;
+        }
+        char   chunk[512];
+        pollfd fd = { client, POLLIN, 0 };
+        while (::poll(&fd, 1, client_timeout_ms) > 0 && ::recv(client, chunk, sizeof(chunk), 0) > 0) {
+        }
+    }
+
+    // Runs every line the client sends until it closes its end, goes quiet or sends an overlong line
+    void serve(int client) {
+        std::string buffer;
+        char        chunk[512];
+        for (;;) {
+            std::size_t newline;
+            while ((newline = buffer.find('\n')) != std::string::npos) {
+                std::string_view line(buffer.data(), newline);
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                if (!line.empty() && !detail::write_all(client, handler_(line))) {
+                    return;
+                }
+                buffer.erase(0, newline + 1);
+            }
+            if (buffer.size() > max_line_length) {
+                detail::write_all(client, "error: command too long\n");
+                return;
+            }
+
+            pollfd fd = { client, POLLIN, 0 };
+            if (::poll(&fd, 1, client_timeout_ms) <= 0) {
+                return;
+            }
+            const ssize_t received = ::recv(client, chunk, sizeof(chunk), 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                // A last command without a trailing newline still counts
+                if (!buffer.empty()) {
+                    detail::write_all(client, handler_(buffer));
+                }
+                return;
+            }
+            buffer.append(chunk, static_cast<std::size_t>(received));
+        }
+    }
+};
+
+/**
+ * @brief Sends one command to a ControlServer and returns its reply
+ *
+ * Throws std::runtime_error if the socket cannot be reached.
+ */
+inline std::string send_control_command(const std::string & path, std::string_view command) {
+    const sockaddr_un address = detail::control_socket_address(path);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw detail::control_socket_error("create", path);
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0) {
+        const auto error = detail::control_socket_error("connect to", path);
+        ::close(fd);
+        throw error;
+    }
+
+    std::string request(command);
+    request += '\n';
+    std::string reply;
+    if (detail::write_all(fd, request)) {
+        ::shutdown(fd, SHUT_WR);
+        char chunk[512];
+        for (;;) {
+            const ssize_t received = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                break;
+            }
+            reply.append(chunk, static_cast<std::size_t>(received));
+        }
+    }
+    ::close(fd);
+    return reply;
+}
+
+#endif  // TT_LOGGER_HAS_CONTROL_SOCKET
+
+}  // namespace tt
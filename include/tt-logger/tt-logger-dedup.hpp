@@ -0,0 +1,283 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-dedup.hpp
+ * @brief Sink stage that folds runs of repeated messages into one "repeated N times" line
+ *
+ * Retry loops log the same text thousands of times in a row. With TT_LOGGER_DEDUP=1 every message passes
+ * through a DuplicateFilterSink before it reaches the real sink. A message whose text hashes the same as the
+ * previous one from its call site and LogType is counted instead of written. The count is written as one
+ * summary line when the site logs something else, once the run has gone on for the timeout, and at exit.
+ */
+
+#pragma once
+
+#include <spdlog/common.h>
+#include <spdlog/details/log_msg.h>
+#include <spdlog/formatter.h>
+#include <spdlog/sinks/sink.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace tt {
+
+/**
+ * @brief Counts repeats of the previous message of every call site and LogType instead of writing them
+ *
+ * Messages are told apart by a hash of their formatted text. A run of repeats ends with a summary line at
+ * the level and source location of the repeated message when the site logs a different message, when the
+ * first repeat not yet summarized is `timeout` old, or on end_runs(). A zero timeout only ends runs on a
+ * different message and on end_runs(). The summaries of timed-out runs are written by a background thread.
+ *
+ * The runs are split into shards by logger name, each with its own lock, so loggers do not contend with
+ * each other. Whether a message is written is decided under its shard's lock; the message and any summary
+ * are written to the inner sink after the lock is released.
+ */
+class DuplicateFilterSink final : public spdlog::sinks::sink {
+  public:
+    static constexpr std::chrono::seconds default_timeout{ 10 };
+
+    explicit DuplicateFilterSink(std::shared_ptr<spdlog::sinks::sink> inner,
+                                 std::chrono::milliseconds             timeout = default_timeout) :
+        timeout_(timeout) {
+        set_inner(std::move(inner));
+        if (timeout_.count() > 0) {
+            timer_ = std::thread([this] { end_timed_out_runs(); });
+        }
+    }
+
+    ~DuplicateFilterSink() override {
+        {
+            std::lock_guard<std::mutex> lock(timer_mutex_);
+            stopping_ = true;
+        }
+        wakeup_.notify_all();
+        if (timer_.joinable()) {
+            timer_.join();
+        }
+        try {
+            end_runs();
+        } catch (...) {
+        }
+    }
+
+    void log(const spdlog::details::log_msg & msg) override {
+        const std::string_view text(msg.payload.data(), msg.payload.size());
+        const std::string_view logger_name(msg.logger_name.data(), msg.logger_name.size());
+        const std::size_t      hash = std::hash<std::string_view>{}(text);
+        const auto             file = reinterpret_cast<std::uintptr_t>(msg.source.filename);
+
+        std::optional<Summary> summary;
+        {
+            Shard &                     shard = shard_of(logger_name);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto                        run = shard.runs.find(std::make_tuple(file, msg.source.line, logger_name));
+            if (run == shard.runs.end()) {
+                run = shard.runs.emplace(Key(file, msg.source.line, std::string(logger_name)), Run{}).first;
+            } else if (run->second.hash == hash) {
+                if (run->second.repeats++ == 0) {
+                    run->second.deadline = clock::now() + timeout_;
+                    schedule(run->second.deadline);
+                }
+                suppressed_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                summary = take_summary(run->first, run->second);
+            }
+            run->second.hash  = hash;
+            run->second.level = msg.level;
+            run->second.loc   = msg.source;
+        }
+        if (summary) {
+            write(*summary);
+        }
+        inner_.load(std::memory_order_acquire)->log(msg);
+    }
+
+    void flush() override { inner_.load(std::memory_order_acquire)->flush(); }
+
+    void set_pattern(const std::string & pattern) override {
+        inner_.load(std::memory_order_acquire)->set_pattern(pattern);
+    }
+
+    void set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) override {
+        inner_.load(std::memory_order_acquire)->set_formatter(std::move(sink_formatter));
+    }
+
+    // Writes the summary of every run that has repeats not yet summarized
+    void end_runs() {
+        for (Shard & shard : shards_) {
+            std::vector<Summary> summaries;
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                for (auto & [key, run] : shard.runs) {
+                    if (auto summary = take_summary(key, run)) {
+                        summaries.push_back(std::move(*summary));
+                    }
+                }
+            }
+            for (const Summary & summary : summaries) {
+                write(summary);
+            }
+        }
+    }
+
+    // Sink that receives the messages that get through. Same threading restrictions as changing the sinks of
+    // a logger: no message may be in flight. Replaced sinks are kept alive until the filter is destroyed, for
+    // the background thread.
+    void set_inner(std::shared_ptr<spdlog::sinks::sink> inner) {
+        std::lock_guard<std::mutex> lock(inners_mutex_);
+        inner_.store(inner.get(), std::memory_order_release);
+        inners_.push_back(std::move(inner));
+    }
+
+    // Messages counted as repeats so far
+    std::uint64_t suppressed() const { return suppressed_.load(std::memory_order_relaxed); }
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t shard_count = 32;
+
+    // Address of the source file name, line and logger name of a call site
+    using Key = std::tuple<std::uintptr_t, int, std::string>;
+
+    struct Run {
+        std::size_t               hash    = 0;  // Of the text of the last message written
+        std::uint64_t             repeats = 0;  // Repeats of it since that message or the last summary
+        spdlog::level::level_enum level   = spdlog::level::info;
+        spdlog::source_loc        loc;
+        clock::time_point         deadline;  // When the summary of the repeats is due
+    };
+
+    struct Shard {
+        std::mutex                      mutex;
+        std::map<Key, Run, std::less<>> runs;
+    };
+
+    // A "repeated N times" line taken out of a run, written once the shard's lock is released
+    struct Summary {
+        std::string               logger_name;
+        spdlog::source_loc        loc;
+        spdlog::level::level_enum level   = spdlog::level::info;
+        std::uint64_t             repeats = 0;
+    };
+
+    std::atomic<spdlog::sinks::sink *>                inner_{ nullptr };
+    std::mutex                                        inners_mutex_;
+    std::vector<std::shared_ptr<spdlog::sinks::sink>> inners_;  // The inner sink and the ones it replaced
+    std::chrono::milliseconds                         timeout_;
+    std::array<Shard, shard_count>                    shards_;
+    std::atomic<std::uint64_t>                        suppressed_{ 0 };
+
+    std::mutex              timer_mutex_;
+    std::condition_variable wakeup_;
+    clock::time_point       next_deadline_ = clock::time_point::max();  // Earliest deadline of any run
+    bool                    stopping_      = false;
+    std::thread             timer_;
+
+    Shard & shard_of(std::string_view logger_name) {
+        return shards_[std::hash<std::string_view>{}(logger_name) % shard_count];
+    }
+
+    // Wakes the background thread earlier if `deadline` comes before the one it waits for
+    void schedule(clock::time_point deadline) {
+        if (!timer_.joinable()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+        if (deadline < next_deadline_) {
+            next_deadline_ = deadline;
+            wakeup_.notify_all();
+        }
+    }
+
+    // Called with the shard's mutex held
+    static std::optional<Summary> take_summary(const Key & key, Run & run) {
+        if (run.repeats == 0) {
+            return std::nullopt;
+        }
+        Summary summary{ std::get<2>(key), run.loc, run.level, run.repeats };
+        run.repeats = 0;
+        return summary;
+    }
+
+    void write(const Summary & summary) {
+        spdlog::memory_buf_t text;
+        fmt::format_to(fmt::appender(text), "Last message repeated {} {}", summary.repeats,
+                       summary.repeats == 1 ? "time" : "times");
+        inner_.load(std::memory_order_acquire)
+            ->log(spdlog::details::log_msg(
+                summary.loc, spdlog::string_view_t(summary.logger_name.data(), summary.logger_name.size()),
+                summary.level, spdlog::string_view_t(text.data(), text.size())));
+    }
+
+    // Background thread: writes the summaries of runs whose deadline has passed
+    void end_timed_out_runs() {
+        std::unique_lock<std::mutex> lock(timer_mutex_);
+        while (!stopping_) {
+            if (next_deadline_ == clock::time_point::max()) {
+                wakeup_.wait(lock);
+            } else {
+                wakeup_.wait_until(lock, next_deadline_);
+            }
+            const clock::time_point now = clock::now();
+            if (stopping_ || now < next_deadline_) {
+                continue;
+            }
+            // Runs that start repeating meanwhile lower next_deadline_ again through schedule()
+            next_deadline_ = clock::time_point::max();
+            lock.unlock();
+
+            clock::time_point    earliest = clock::time_point::max();
+            std::vector<Summary> summaries;
+            for (Shard & shard : shards_) {
+                {
+                    std::lock_guard<std::mutex> shard_lock(shard.mutex);
+                    for (auto & [key, run] : shard.runs) {
+                        if (run.repeats == 0) {
+                            continue;
+                        }
+                        if (run.deadline <= now) {
+                            summaries.push_back(*take_summary(key, run));
+                        } else if (run.deadline < earliest) {
+                            earliest = run.deadline;
+                        }
+                    }
+                }
+                for (const Summary & summary : summaries) {
+                    try {
+                        write(summary);
+                    } catch (...) {
+                    }
+                }
+                summaries.clear();
+            }
+
+            lock.lock();
+            if (earliest < next_deadline_) {
+                next_deadline_ = earliest;
+            }
+        }
+    }
+};
+
+}  // namespace tt
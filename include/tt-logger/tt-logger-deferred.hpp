@@ -0,0 +1,796 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-deferred.hpp
+ * @brief Deferred formatting backend used by the LoggerRegistry deferred mode
+ *
+ * In deferred mode a log call does not run fmt at all. The calling thread copies the format string,
+ * the source location and the raw arguments into a buffer owned by that thread, and a backend thread
+ * decodes the arguments, formats the message and writes it to the sink.
+ *
+ * Arithmetic, enum and void pointer arguments are copied as raw bytes. Strings (std::string,
+ * std::string_view, C strings) are copied by value. Any other argument type, such as containers or
+ * std::filesystem::path, makes the whole message fall back to being formatted on the calling thread;
+ * the formatted text is then handed to the backend like any other record. Specialize
+ * tt::deferred_by_value for trivially copyable types whose fmt::formatter only reads the value itself.
+ *
+ * When the sink is a BinarySink, or a SplitSink whose file for the record's logger is one, records whose
+ * arguments all have a binary encoding are not formatted at all: the backend hands the format string and
+ * the typed arguments to the sink.
+ *
+ * With TimestampSource::tsc a log call stores the raw cycle counter instead of reading the system clock;
+ * the backend converts it to wall-clock time when it writes the record.
+ */
+
+#pragma once
+
+#include <spdlog/details/log_msg.h>
+#include <spdlog/details/os.h>
+#include <spdlog/logger.h>
+#include <spdlog/sinks/sink.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tt-logger/tt-logger-async.hpp>
+#include <tt-logger/tt-logger-binary.hpp>
+#include <tt-logger/tt-logger-clock.hpp>
+#include <tt-logger/tt-logger-split.hpp>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tt {
+
+// Opt-in for trivially copyable user types that can be formatted from a byte copy on the backend thread
+template <typename T> struct deferred_by_value : std::false_type {};
+
+namespace detail {
+
+enum class DeferredArgKind {
+    value,     // Copied as raw bytes
+    c_string,  // NUL-terminated copy, decoded as const char *
+    string,    // Length-prefixed copy, decoded as fmt::string_view
+    eager,     // Cannot be deferred, the message is formatted on the calling thread
+};
+
+template <typename T> constexpr DeferredArgKind deferred_arg_kind() {
+    if constexpr (std::is_same_v<T, char *> || std::is_same_v<T, const char *>) {
+        return DeferredArgKind::c_string;
+    } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> ||
+                         std::is_same_v<T, fmt::string_view>) {
+        return DeferredArgKind::string;
+    } else if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_same_v<T, const void *> ||
+                         std::is_same_v<T, void *> || deferred_by_value<T>::value) {
+        static_assert(std::is_trivially_copyable_v<T>, "deferred_by_value types must be trivially copyable");
+        return DeferredArgKind::value;
+    } else {
+        return DeferredArgKind::eager;
+    }
+}
+
+template <typename T, DeferredArgKind Kind = deferred_arg_kind<T>()> struct DeferredArgCodec;
+
+template <typename T> struct DeferredArgCodec<T, DeferredArgKind::value> {
+    using decoded_type = T;
+
+    static std::size_t size(const T &) { return sizeof(T); }
+
+    static std::byte * encode(std::byte * out, const T & value) {
+        std::memcpy(out, &value, sizeof(T));
+        return out + sizeof(T);
+    }
+
+    static T decode(const std::byte *& in) {
+        T value;
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    }
+};
+
+template <typename T> struct DeferredArgCodec<T, DeferredArgKind::c_string> {
+    using decoded_type = const char *;
+
+    // A null pointer is kept as null so fmt reports it exactly like the synchronous path
+    static std::size_t size(const char * value) { return sizeof(std::uint32_t) + (value ? std::strlen(value) + 1 : 0); }
+
+    static std::byte * encode(std::byte * out, const char * value) {
+        const std::uint32_t length = value ? static_cast<std::uint32_t>(std::strlen(value) + 1) : 0;
+        std::memcpy(out, &length, sizeof(length));
+        std::memcpy(out + sizeof(length), value, length);
+        return out + sizeof(length) + length;
+    }
+
+    static const char * decode(const std::byte *& in) {
+        std::uint32_t length;
+        std::memcpy(&length, in, sizeof(length));
+        const char * value = length ? reinterpret_cast<const char *>(in + sizeof(length)) : nullptr;
+        in += sizeof(length) + length;
+        return value;
+    }
+};
+
+template <typename T> struct DeferredArgCodec<T, DeferredArgKind::string> {
+    using decoded_type = fmt::string_view;
+
+    static std::size_t size(const T & value) { return sizeof(std::uint32_t) + value.size(); }
+
+    static std::byte * encode(std::byte * out, const T & value) {
+        const auto length = static_cast<std::uint32_t>(value.size());
+        std::memcpy(out, &length, sizeof(length));
+        std::memcpy(out + sizeof(length), value.data(), length);
+        return out + sizeof(length) + length;
+    }
+
+    static fmt::string_view decode(const std::byte *& in) {
+        std::uint32_t length;
+        std::memcpy(&length, in, sizeof(length));
+        fmt::string_view value(reinterpret_cast<const char *>(in + sizeof(length)), length);
+        in += sizeof(length) + length;
+        return value;
+    }
+};
+
+template <typename... Args>
+constexpr bool all_deferrable = ((deferred_arg_kind<std::decay_t<Args>>() != DeferredArgKind::eager) && ...);
+
+template <typename... Args>
+constexpr bool all_binary_encodable = (binary_encodable_v<typename DeferredArgCodec<Args>::decoded_type> && ...);
+
+// Formats a record payload into out
+using DeferredFormatFn = void (*)(const std::byte * payload, std::size_t size, spdlog::memory_buf_t & out);
+
+// Writes the arguments of a record payload in the binary log encoding
+using DeferredBinaryFn = void (*)(const std::byte * payload, std::size_t size, BinaryArgWriter & out);
+
+// Every record points to the codec that knows its payload layout
+struct DeferredCodec {
+    DeferredFormatFn format;
+    DeferredBinaryFn write_binary;  // nullptr unless every argument has a binary encoding
+};
+
+// Payload: uint32 format string length, format string, encoded arguments
+inline fmt::string_view deferred_format_string(const std::byte * payload) {
+    std::uint32_t fmt_length;
+    std::memcpy(&fmt_length, payload, sizeof(fmt_length));
+    return fmt::string_view(reinterpret_cast<const char *>(payload + sizeof(fmt_length)), fmt_length);
+}
+
+template <typename... Args> void format_deferred(const std::byte * payload, std::size_t, spdlog::memory_buf_t & out) {
+    const fmt::string_view fmt_str = deferred_format_string(payload);
+    const std::byte *      in      = payload + sizeof(std::uint32_t) + fmt_str.size();
+
+    // Braced initialization decodes the arguments left to right
+    std::tuple<typename DeferredArgCodec<Args>::decoded_type...> values{ DeferredArgCodec<Args>::decode(in)... };
+    std::apply(
+        [&](auto &... decoded) { fmt::vformat_to(fmt::appender(out), fmt_str, fmt::make_format_args(decoded...)); },
+        values);
+}
+
+template <typename... Args> void write_binary_deferred(const std::byte * payload, std::size_t, BinaryArgWriter & out) {
+    static_assert(sizeof...(Args) <= max_binary_args, "too many arguments for the binary log format");
+    const std::byte * in = payload + sizeof(std::uint32_t) + deferred_format_string(payload).size();
+    out.begin(sizeof...(Args));
+    (out.write(DeferredArgCodec<Args>::decode(in)), ...);
+}
+
+template <typename... Args> constexpr DeferredBinaryFn binary_writer_for() {
+    if constexpr (all_binary_encodable<Args...>) {
+        return &write_binary_deferred<Args...>;
+    } else {
+        return nullptr;
+    }
+}
+
+template <typename... Args>
+inline constexpr DeferredCodec deferred_codec{ &format_deferred<Args...>, binary_writer_for<Args...>() };
+
+// Payload: the already formatted message
+inline void format_preformatted(const std::byte * payload, std::size_t size, spdlog::memory_buf_t & out) {
+    const char * text = reinterpret_cast<const char *>(payload);
+    out.append(text, text + size);
+}
+
+inline constexpr DeferredCodec preformatted_codec{ &format_preformatted, nullptr };
+
+struct DeferredRecordHeader {
+    std::uint32_t                 size;          // Whole record including this header; padding_flag marks padding
+    std::uint32_t                 payload_size;  // Bytes following this header
+    const DeferredCodec *         codec;
+    spdlog::logger *              logger;
+    spdlog::source_loc            loc;
+    std::uint64_t                 timestamp;  // Cycle counter ticks or system clock nanoseconds, see TimestampSource
+    std::size_t                   thread_id;
+    spdlog::level::level_enum     level;
+
+    static constexpr std::uint32_t padding_flag = 0x80000000u;
+};
+
+constexpr std::size_t record_alignment = alignof(DeferredRecordHeader);
+
+constexpr std::size_t align_record_size(std::size_t size) {
+    return (size + record_alignment - 1) & ~(record_alignment - 1);
+}
+
+/**
+ * @brief Single-producer single-consumer ring of variable-sized records owned by one logging thread
+ *
+ * A record never wraps around the end of the buffer: if it does not fit in the remaining space, that
+ * space is marked as padding and the record starts again at offset 0. Positions grow monotonically and
+ * are masked on access.
+ */
+class alignas(cache_line_size) ThreadBuffer {
+  public:
+    // The buffer is touched up front so that page faults are not paid on the logging hot path
+    explicit ThreadBuffer(std::size_t capacity) :
+        capacity_(round_up_capacity(capacity)), data_(new std::byte[capacity_]) {
+        std::memset(data_.get(), 0, capacity_);
+    }
+
+    ThreadBuffer(const ThreadBuffer &)             = delete;
+    ThreadBuffer & operator=(const ThreadBuffer &) = delete;
+
+    std::size_t capacity() const noexcept { return capacity_; }
+
+    // Producer: returns space for a record of size bytes (a multiple of record_alignment) or nullptr if full
+    std::byte * reserve(std::size_t size) {
+        const std::size_t write      = write_pos_.load(std::memory_order_relaxed);
+        const std::size_t offset     = write & (capacity_ - 1);
+        const std::size_t contiguous = capacity_ - offset;
+        const std::size_t needed     = size <= contiguous ? size : contiguous + size;
+
+        if (capacity_ - (write - cached_read_pos_) < needed) {
+            cached_read_pos_ = read_pos_.load(std::memory_order_acquire);
+            if (capacity_ - (write - cached_read_pos_) < needed) {
+                return nullptr;
+            }
+        }
+
+        if (size > contiguous) {
+            const auto padding = static_cast<std::uint32_t>(contiguous) | DeferredRecordHeader::padding_flag;
+            std::memcpy(data_.get() + offset, &padding, sizeof(padding));
+            pending_write_pos_ = write + contiguous + size;
+            return data_.get();
+        }
+        pending_write_pos_ = write + size;
+        return data_.get() + offset;
+    }
+
+    // Producer: publishes the record returned by the last reserve()
+    void commit() {
+        records_.store(records_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        write_pos_.store(pending_write_pos_, std::memory_order_release);
+    }
+
+    // Consumer: oldest published record, or nullptr if the buffer is empty
+    const DeferredRecordHeader * front() {
+        const std::size_t write = write_pos_.load(std::memory_order_acquire);
+        while (consumer_read_pos_ != write) {
+            const std::byte * record = data_.get() + (consumer_read_pos_ & (capacity_ - 1));
+            std::uint32_t     size;
+            std::memcpy(&size, record, sizeof(size));
+            if (!(size & DeferredRecordHeader::padding_flag)) {
+                return reinterpret_cast<const DeferredRecordHeader *>(record);
+            }
+            consumer_read_pos_ += size & ~DeferredRecordHeader::padding_flag;
+        }
+        return nullptr;
+    }
+
+    // Consumer: releases the record returned by front()
+    void pop() {
+        std::uint32_t size;
+        std::memcpy(&size, data_.get() + (consumer_read_pos_ & (capacity_ - 1)), sizeof(size));
+        consumer_read_pos_ += size;
+        read_pos_.store(consumer_read_pos_, std::memory_order_release);
+    }
+
+    // Producer: the owning thread has exited and will not write again
+    void retire() { retired_.store(true, std::memory_order_release); }
+
+    // Consumer: the owning thread has exited and every record has been consumed
+    bool reclaimable() const {
+        return retired_.load(std::memory_order_acquire) &&
+               read_pos_.load(std::memory_order_relaxed) == write_pos_.load(std::memory_order_acquire);
+    }
+
+    std::size_t written() const noexcept { return write_pos_.load(std::memory_order_acquire); }
+
+    std::size_t read() const noexcept { return read_pos_.load(std::memory_order_acquire); }
+
+    // Number of records ever committed
+    std::uint64_t records() const noexcept { return records_.load(std::memory_order_relaxed); }
+
+  private:
+    static std::size_t round_up_capacity(std::size_t capacity) {
+        std::size_t rounded = 4096;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        return rounded;
+    }
+
+    const std::size_t            capacity_;
+    std::unique_ptr<std::byte[]> data_;
+
+    // Producer-owned
+    alignas(cache_line_size) std::atomic<std::size_t> write_pos_{ 0 };
+    std::atomic<std::uint64_t> records_{ 0 };
+    std::size_t                pending_write_pos_ = 0;
+    std::size_t                cached_read_pos_   = 0;
+
+    // Consumer-owned
+    alignas(cache_line_size) std::atomic<std::size_t> read_pos_{ 0 };
+    std::size_t       consumer_read_pos_ = 0;
+    std::atomic<bool> retired_{ false };
+};
+
+}  // namespace detail
+
+struct DeferredStats {
+    std::uint64_t records           = 0;  // Records handed to the backend thread
+    std::uint64_t eager_records     = 0;  // Records formatted on the calling thread because of their argument types
+    std::uint64_t dropped           = 0;  // Records discarded because the thread buffer was full
+    std::size_t   thread_buffers    = 0;  // Buffers of threads that are alive or still have records queued
+    std::size_t   reclaimed_buffers = 0;  // Buffers freed after their thread exited
+};
+
+/**
+ * @brief Backend thread that formats deferred records and writes them to a sink
+ *
+ * Every logging thread gets its own detail::ThreadBuffer on its first log call, so producers never share
+ * a queue. The backend thread k-way merges the buffers by record timestamp, which keeps the output in
+ * global time order as long as no thread stalls for longer than ordering_window between taking a
+ * timestamp and publishing its record. The buffer of a thread that has exited is freed once drained.
+ */
+class DeferredBackend {
+  public:
+    static constexpr std::size_t default_buffer_size = 256 * 1024;
+
+    // TimestampSource::tsc falls back to the system clock where TscClock is not available
+    explicit DeferredBackend(std::shared_ptr<spdlog::sinks::sink> sink,
+                             std::size_t                          buffer_size = default_buffer_size,
+                             AsyncOverflowPolicy                  policy      = AsyncOverflowPolicy::block,
+                             TimestampSource                      timestamps  = TimestampSource::system_clock) :
+        sink_(std::move(sink)),
+        binary_sink_(dynamic_cast<BinarySink *>(sink_.get())),
+        split_sink_(dynamic_cast<SplitSink *>(sink_.get())),
+        buffer_size_(buffer_size),
+        policy_(policy),
+        use_tsc_(timestamps == TimestampSource::tsc && TscClock::available()),
+        id_(next_backend_id()) {
+        if (use_tsc_) {
+            tsc_clock_.emplace();
+        }
+        worker_ = std::thread([this] { run(); });
+    }
+
+    ~DeferredBackend() { stop(); }
+
+    DeferredBackend(const DeferredBackend &)             = delete;
+    DeferredBackend & operator=(const DeferredBackend &) = delete;
+
+    // Records a log call. The caller has already checked that the logger accepts the level.
+    template <typename... Args>
+    void log(spdlog::logger & logger, spdlog::source_loc loc, spdlog::level::level_enum level,
+             spdlog::format_string_t<Args...> fmt, Args &&... args) {
+        if constexpr (detail::all_deferrable<Args...>) {
+            const fmt::string_view fmt_str = fmt;
+            const std::size_t      payload_size =
+                sizeof(std::uint32_t) + fmt_str.size() +
+                (std::size_t{ 0 } + ... + detail::DeferredArgCodec<std::decay_t<Args>>::size(args));
+
+            std::byte * payload = begin_record(logger, loc, level, payload_size,
+                                               &detail::deferred_codec<std::decay_t<Args>...>);
+            if (!payload) {
+                return;
+            }
+            const auto fmt_length = static_cast<std::uint32_t>(fmt_str.size());
+            std::memcpy(payload, &fmt_length, sizeof(fmt_length));
+            std::memcpy(payload + sizeof(fmt_length), fmt_str.data(), fmt_str.size());
+            std::byte * out = payload + sizeof(fmt_length) + fmt_str.size();
+            ((out = detail::DeferredArgCodec<std::decay_t<Args>>::encode(out, args)), ...);
+            end_record(logger, level);
+        } else {
+            spdlog::memory_buf_t buffer;
+            try {
+                fmt::format_to(fmt::appender(buffer), fmt, std::forward<Args>(args)...);
+            } catch (const std::exception & e) {
+                // Written like a record the backend fails to format, instead of throwing into the log call
+                buffer.clear();
+                fmt::format_to(fmt::appender(buffer), "[tt-logger] failed to format deferred message: {}", e.what());
+            }
+            eager_records_.fetch_add(1, std::memory_order_relaxed);
+            log_formatted(logger, loc, level, fmt::string_view(buffer.data(), buffer.size()));
+        }
+    }
+
+    // Records an already formatted message
+    void log_formatted(spdlog::logger & logger, spdlog::source_loc loc, spdlog::level::level_enum level,
+                       fmt::string_view message) {
+        std::byte * payload = begin_record(logger, loc, level, message.size(), &detail::preformatted_codec);
+        if (!payload) {
+            return;
+        }
+        std::memcpy(payload, message.data(), message.size());
+        end_record(logger, level);
+    }
+
+    // Block until every record logged before the call has been written, then flush the sink
+    void flush() {
+        if (!stopped_.load(std::memory_order_acquire)) {
+            flush_waiters_.fetch_add(1, std::memory_order_acq_rel);
+            for (const auto & buffer : snapshot_buffers()) {
+                const std::size_t target = buffer->written();
+                while (buffer->read() < target) {
+                    wakeup_.notify();
+                    std::this_thread::yield();
+                }
+            }
+            flush_waiters_.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        sink_->flush();
+    }
+
+    // Drains every thread buffer and joins the backend thread. Later records are written on the calling
+    // thread, so the backend can stay in place while other threads are still logging.
+    void stop() {
+        if (stopped_.exchange(true)) {
+            return;
+        }
+        wakeup_.notify();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+        drained_.store(true, std::memory_order_release);
+        sink_->flush();
+    }
+
+    TimestampSource timestamp_source() const noexcept {
+        return use_tsc_ ? TimestampSource::tsc : TimestampSource::system_clock;
+    }
+
+    DeferredStats stats() const {
+        DeferredStats stats;
+        stats.records       = oversized_records_.load(std::memory_order_relaxed);
+        stats.eager_records = eager_records_.load(std::memory_order_relaxed);
+        stats.dropped       = dropped_.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        stats.records += retired_records_;
+        for (const auto & buffer : buffers_) {
+            stats.records += buffer->records();
+        }
+        stats.thread_buffers    = buffers_.size();
+        stats.reclaimed_buffers = reclaimed_buffers_;
+        return stats;
+    }
+
+  private:
+    // A record is only written once it is this old, so that a record whose thread took its timestamp
+    // but has not yet published it cannot be overtaken by newer records from other threads
+    static constexpr std::chrono::microseconds ordering_window{ 100 };
+
+    // Records written per merge pass before the backend re-checks for new buffers and stop requests
+    static constexpr std::size_t max_merge_records = 4096;
+
+    static constexpr std::uint64_t max_timestamp = ~std::uint64_t{ 0 };
+
+    std::shared_ptr<spdlog::sinks::sink>               sink_;
+    BinarySink *                                       binary_sink_;  // sink_ when it takes typed arguments
+    SplitSink *                                        split_sink_;   // sink_ when it writes a file per LogType
+    std::size_t                                        buffer_size_;
+    AsyncOverflowPolicy                                policy_;
+    bool                                               use_tsc_;
+    std::optional<TscClock>                            tsc_clock_;  // Backend thread only once started
+    std::uint64_t                                      id_;
+    std::thread                                        worker_;
+    detail::BackendWakeup                              wakeup_;
+    std::atomic<bool>                                  stopped_{ false };
+    std::atomic<bool>                                  drained_{ false };  // Set once the backend thread has exited
+    mutable std::mutex                                 buffers_mutex_;
+    std::vector<std::shared_ptr<detail::ThreadBuffer>> buffers_;
+    std::atomic<std::size_t>                           buffers_version_{ 0 };
+    std::atomic<std::uint64_t>                         oversized_records_{ 0 };
+    std::atomic<std::uint64_t>                         eager_records_{ 0 };
+    std::atomic<std::uint64_t>                         dropped_{ 0 };
+    std::atomic<int>                                   flush_waiters_{ 0 };
+    std::uint64_t                                      retired_records_   = 0;  // Guarded by buffers_mutex_
+    std::size_t                                        reclaimed_buffers_ = 0;  // Guarded by buffers_mutex_
+    std::vector<std::pair<std::uint64_t, std::size_t>> heads_;  // Backend thread only
+
+    std::uint64_t timestamp_now() const noexcept {
+        return use_tsc_ ? TscClock::ticks() : static_cast<std::uint64_t>(detail::system_clock_ns());
+    }
+
+    spdlog::log_clock::time_point to_time_point(std::uint64_t timestamp) const noexcept {
+        if (use_tsc_) {
+            return tsc_clock_->to_time_point(timestamp);
+        }
+        return spdlog::log_clock::time_point(std::chrono::duration_cast<spdlog::log_clock::duration>(
+            std::chrono::nanoseconds(static_cast<std::int64_t>(timestamp))));
+    }
+
+    // Newest timestamp the backend may write without overtaking a record that is still being published
+    std::uint64_t merge_cutoff() const noexcept {
+        const std::uint64_t now    = timestamp_now();
+        const std::uint64_t window = use_tsc_ ? tsc_clock_->ticks_in(ordering_window) :
+                                                static_cast<std::uint64_t>(
+                                                    std::chrono::nanoseconds(ordering_window).count());
+        return now > window ? now - window : 0;
+    }
+
+    static std::uint64_t next_backend_id() {
+        static std::atomic<std::uint64_t> next_id{ 1 };
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::vector<std::shared_ptr<detail::ThreadBuffer>> snapshot_buffers() const {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        return buffers_;
+    }
+
+    // Per-thread producer state for this backend
+    struct Producer {
+        std::uint64_t                         backend_id = 0;
+        std::shared_ptr<detail::ThreadBuffer> buffer;
+        std::vector<std::byte>                oversized;  // Scratch space for records too large for the buffer
+        bool                                  writing_oversized = false;
+
+        ~Producer() {
+            if (buffer) {
+                buffer->retire();
+            }
+        }
+    };
+
+    Producer & producer() {
+        thread_local Producer state;
+        if (state.backend_id != id_) {
+            if (state.buffer) {
+                state.buffer->retire();
+            }
+            state.buffer = std::make_shared<detail::ThreadBuffer>(buffer_size_);
+            {
+                std::lock_guard<std::mutex> lock(buffers_mutex_);
+                buffers_.push_back(state.buffer);
+            }
+            buffers_version_.fetch_add(1, std::memory_order_release);
+            state.backend_id = id_;
+        }
+        return state;
+    }
+
+    // Reserves a record and fills in its header. Returns where the payload goes, or nullptr if dropped.
+    std::byte * begin_record(spdlog::logger & logger, spdlog::source_loc loc, spdlog::level::level_enum level,
+                             std::size_t payload_size, const detail::DeferredCodec * codec) {
+        const std::size_t size  = detail::align_record_size(sizeof(detail::DeferredRecordHeader) + payload_size);
+        Producer &        state = producer();
+
+        std::byte * record = nullptr;
+        if (size <= state.buffer->capacity() / 4 && !stopped_.load(std::memory_order_acquire)) {
+            while (!(record = state.buffer->reserve(size))) {
+                if (policy_ == AsyncOverflowPolicy::drop) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                if (stopped_.load(std::memory_order_acquire)) {
+                    break;  // Nobody is left to free space
+                }
+                wakeup_.notify();
+                std::this_thread::yield();
+            }
+        }
+        if (!record) {
+            // Too large for the ring or logged after stop(): end_record() formats and writes it on the calling
+            // thread
+            state.oversized.resize(size);
+            state.writing_oversized = true;
+            record                  = state.oversized.data();
+        }
+
+        auto * header = new (record) detail::DeferredRecordHeader{
+            static_cast<std::uint32_t>(size),
+            static_cast<std::uint32_t>(payload_size),
+            codec,
+            &logger,
+            loc,
+            timestamp_now(),
+            spdlog::details::os::thread_id(),
+            level,
+        };
+        return reinterpret_cast<std::byte *>(header + 1);
+    }
+
+    void end_record(spdlog::logger & logger, spdlog::level::level_enum level) {
+        Producer & state = producer();
+        if (state.writing_oversized) {
+            state.writing_oversized = false;
+            // Keep this thread's earlier records ahead of this one
+            if (stopped_.load(std::memory_order_acquire)) {
+                drain_after_stop(state);
+            } else {
+                flush();
+            }
+            write_record(*reinterpret_cast<const detail::DeferredRecordHeader *>(state.oversized.data()));
+            oversized_records_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            state.buffer->commit();
+            // Pairs with the fence of the backend thread once it has seen stopped_: either that thread drains
+            // this record, or this thread sees stopped_ and writes it
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (stopped_.load(std::memory_order_relaxed)) {
+                drain_after_stop(state);
+            } else {
+                wakeup_.notify_if_sleeping();
+            }
+        }
+        if (level >= logger.flush_level()) {
+            flush();
+        }
+    }
+
+    // Writes what is left in this thread's buffer by a commit that raced with stop(), once the backend thread
+    // is gone and this thread is the only one reading its buffer
+    void drain_after_stop(Producer & state) {
+        while (!drained_.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        while (const detail::DeferredRecordHeader * header = state.buffer->front()) {
+            write_record(*header);
+            state.buffer->pop();
+        }
+    }
+
+    void write_record(const detail::DeferredRecordHeader & header) {
+        const std::byte * payload = reinterpret_cast<const std::byte *>(&header + 1);
+        BinarySink * binary_sink = binary_sink_;
+        if (split_sink_ && header.codec->write_binary) {
+            binary_sink = dynamic_cast<BinarySink *>(split_sink_->file_sink(
+                std::string_view(header.logger->name().data(), header.logger->name().size())));
+        }
+        if (binary_sink && header.codec->write_binary) {
+            spdlog::details::log_msg msg(to_time_point(header.timestamp), header.loc, header.logger->name(),
+                                         header.level, spdlog::string_view_t());
+            msg.thread_id                  = header.thread_id;
+            const fmt::string_view fmt_str = detail::deferred_format_string(payload);
+            binary_sink->log_encoded(msg, std::string_view(fmt_str.data(), fmt_str.size()),
+                                     [&](BinaryArgWriter & out) {
+                                         header.codec->write_binary(payload, header.payload_size, out);
+                                     });
+            return;
+        }
+
+        spdlog::memory_buf_t buffer;
+        try {
+            header.codec->format(payload, header.payload_size, buffer);
+        } catch (const std::exception & e) {
+            buffer.clear();
+            fmt::format_to(fmt::appender(buffer), "[tt-logger] failed to format deferred message: {}", e.what());
+        }
+        spdlog::details::log_msg msg(to_time_point(header.timestamp), header.loc, header.logger->name(),
+                                     header.level, spdlog::string_view_t(buffer.data(), buffer.size()));
+        msg.thread_id = header.thread_id;
+        if (sink_->should_log(header.level)) {
+            sink_->log(msg);
+        }
+    }
+
+    // Writes the records of all buffers that are older than cutoff, merged by timestamp
+    std::size_t merge(const std::vector<std::shared_ptr<detail::ThreadBuffer>> & buffers, std::uint64_t cutoff) {
+        using Head   = std::pair<std::uint64_t, std::size_t>;
+        auto later   = [](const Head & a, const Head & b) { return a.first > b.first; };
+        auto push_if = [&](std::size_t index) {
+            const detail::DeferredRecordHeader * header = buffers[index]->front();
+            if (header && header->timestamp <= cutoff) {
+                heads_.emplace_back(header->timestamp, index);
+                std::push_heap(heads_.begin(), heads_.end(), later);
+            }
+        };
+
+        heads_.clear();
+        for (std::size_t index = 0; index < buffers.size(); ++index) {
+            push_if(index);
+        }
+        std::size_t written = 0;
+        while (!heads_.empty() && written < max_merge_records) {
+            std::pop_heap(heads_.begin(), heads_.end(), later);
+            const std::size_t index = heads_.back().second;
+            heads_.pop_back();
+            write_record(*buffers[index]->front());
+            buffers[index]->pop();
+            ++written;
+            push_if(index);
+        }
+        return written;
+    }
+
+    // Frees the buffers of threads that have exited once everything they logged has been written
+    void reclaim_buffers() {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        auto reclaimable = [](const std::shared_ptr<detail::ThreadBuffer> & buffer) { return buffer->reclaimable(); };
+        auto first       = std::partition(buffers_.begin(), buffers_.end(), std::not_fn(reclaimable));
+        if (first == buffers_.end()) {
+            return;
+        }
+        for (auto it = first; it != buffers_.end(); ++it) {
+            retired_records_ += (*it)->records();
+            ++reclaimed_buffers_;
+        }
+        buffers_.erase(first, buffers_.end());
+        buffers_version_.fetch_add(1, std::memory_order_release);
+    }
+
+    void run() {
+        std::vector<std::shared_ptr<detail::ThreadBuffer>> buffers;
+        std::size_t                                        version = ~std::size_t{ 0 };
+
+        for (;;) {
+            const std::size_t current_version = buffers_version_.load(std::memory_order_acquire);
+            if (current_version != version) {
+                buffers = snapshot_buffers();
+                version = current_version;
+            }
+
+            if (tsc_clock_) {
+                tsc_clock_->maybe_recalibrate(TscClock::ticks());
+            }
+
+            const bool          stopping = stopped_.load(std::memory_order_acquire);
+            const bool          flushing = flush_waiters_.load(std::memory_order_acquire) > 0;
+            const std::uint64_t cutoff   = (stopping || flushing) ? max_timestamp : merge_cutoff();
+            if (merge(buffers, cutoff) > 0) {
+                continue;
+            }
+
+            reclaim_buffers();
+            if (stopping) {
+                // Pick up buffers registered since the last snapshot, then drain everything. The fence pairs
+                // with the one in end_record(), so every commit that did not see stopped_ is drained here.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                buffers = snapshot_buffers();
+                while (merge(buffers, max_timestamp) > 0) {
+                }
+                return;
+            }
+
+            bool pending = false;
+            for (const auto & buffer : buffers) {
+                pending = pending || buffer->front() != nullptr;
+            }
+            if (pending) {
+                // Only records younger than the ordering window are left
+                std::this_thread::sleep_for(ordering_window);
+                continue;
+            }
+            wakeup_.wait([&] {
+                if (stopped_.load(std::memory_order_acquire) ||
+                    buffers_version_.load(std::memory_order_acquire) != version) {
+                    return true;
+                }
+                for (const auto & buffer : buffers) {
+                    if (buffer->read() != buffer->written()) {
+                        return true;
+                    }
+                }
+                return false;
+            });
+        }
+    }
+};
+
+}  // namespace tt
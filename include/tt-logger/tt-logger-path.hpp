@@ -0,0 +1,157 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-path.hpp
+ * @brief Expansion of {pid}, {tid}, {host}, {rank} and {time} in log file paths
+ *
+ * Several processes given the same TT_LOGGER_FILE would truncate and overwrite each other's file.
+ * TT_LOGGER_FILE=logs/run-{host}-{rank}.log gives every process a file of its own instead. The rank comes
+ * from the environment of the common MPI and job launchers. {pid} and {host} are filled in on POSIX systems
+ * and Windows, and kept as written elsewhere.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#if defined(_WIN32)
+#    include <process.h>
+#    include <spdlog/details/windows_include.h>
+#    define TT_LOGGER_HAS_PROCESS_FIELDS 1
+#elif defined(__unix__) || defined(__APPLE__)
+#    include <unistd.h>
+#    define TT_LOGGER_HAS_PROCESS_FIELDS 1
+#    if defined(__linux__)
+#        include <sys/syscall.h>
+#    endif
+#else
+#    define TT_LOGGER_HAS_PROCESS_FIELDS 0
+#endif
+
+namespace tt {
+
+// Variables holding the rank of a process, in the order they are checked
+inline constexpr const char * rank_env_vars[] = {
+    "OMPI_COMM_WORLD_RANK",  // Open MPI
+    "PMIX_RANK",             // PMIx launchers
+    "PMI_RANK",              // MPICH, Intel MPI
+    "MV2_COMM_WORLD_RANK",   // MVAPICH2
+    "PALS_RANK",             // HPE Cray PALS
+    "SLURM_PROCID",          // srun
+    "RANK",                  // torchrun and other PyTorch launchers
+};
+
+// Rank of this process from the launcher's environment, or "0" when it was not started by one
+inline std::string detect_rank() {
+    for (const char * name : rank_env_vars) {
+        const char * value = std::getenv(name);
+        if (value && *value) {
+            return value;
+        }
+    }
+    return "0";
+}
+
+// Values substituted for the placeholders of a log file path
+struct LogPathFields {
+    std::string pid;
+    std::string tid;   // Thread that opened the log
+    std::string host;  // Host name without the domain
+    std::string rank;
+    std::string time;  // Local time the log was opened, YYYYMMDD-HHMMSS
+
+    // Values of the calling process and thread, right now. Fields the platform cannot provide stay empty.
+    static LogPathFields current() {
+        LogPathFields fields;
+#if defined(_WIN32)
+        fields.pid = std::to_string(::_getpid());
+        fields.tid = std::to_string(::GetCurrentThreadId());
+        char  host[MAX_COMPUTERNAME_LENGTH + 1] = {};
+        DWORD host_size                         = sizeof(host);
+        if (::GetComputerNameA(host, &host_size)) {
+            fields.host = host;
+        }
+#elif TT_LOGGER_HAS_PROCESS_FIELDS
+        fields.pid = std::to_string(::getpid());
+#    if defined(__linux__)
+        fields.tid = std::to_string(::syscall(SYS_gettid));
+#    else
+        fields.tid = std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+#    endif
+        char host[256] = {};
+        if (::gethostname(host, sizeof(host) - 1) == 0) {
+            fields.host = std::string_view(host).substr(0, std::string_view(host).find('.'));
+        }
+#else
+        fields.tid = std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+#endif
+        fields.rank = detect_rank();
+
+        const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::tm           local{};
+#if defined(_WIN32)
+        ::localtime_s(&local, &now);
+#elif TT_LOGGER_HAS_PROCESS_FIELDS
+        ::localtime_r(&now, &local);
+#else
+        if (const std::tm * shared = std::localtime(&now)) {
+            local = *shared;
+        }
+#endif
+        char time[32] = {};
+        std::strftime(time, sizeof(time), "%Y%m%d-%H%M%S", &local);
+        fields.time = time;
+        return fields;
+    }
+};
+
+/**
+ * @brief Replaces {pid}, {tid}, {host}, {rank} and {time} in a log file path
+ *
+ * {type} is left for the per-LogType file split, and {pid} and {host} are kept when their field is empty. Any
+ * other placeholder is kept as written after calling on_error(const char * problem, std::string_view placeholder).
+ */
+template <typename OnError>
+std::string expand_log_path(std::string_view path, const LogPathFields & fields, OnError && on_error) {
+    std::string result;
+    while (!path.empty()) {
+        const std::size_t open  = path.find('{');
+        const std::size_t close = open == std::string_view::npos ? open : path.find('}', open);
+        if (close == std::string_view::npos) {
+            break;
+        }
+        result += path.substr(0, open);
+        const std::string_view placeholder = path.substr(open, close - open + 1);
+        const std::string_view name        = placeholder.substr(1, placeholder.size() - 2);
+        if (name == "pid" && !fields.pid.empty()) {
+            result += fields.pid;
+        } else if (name == "tid") {
+            result += fields.tid;
+        } else if (name == "host" && !fields.host.empty()) {
+            result += fields.host;
+        } else if (name == "rank") {
+            result += fields.rank;
+        } else if (name == "time") {
+            result += fields.time;
+        } else {
+            if (name != "type" && name != "pid" && name != "host") {
+                on_error("unknown placeholder", placeholder);
+            }
+            result += placeholder;
+        }
+        path.remove_prefix(close + 1);
+    }
+    result += path;
+    return result;
+}
+
+}  // namespace tt
@@ -0,0 +1,536 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-recorder.hpp
+ * @brief Flight recorder: per-thread rings of recent messages, written out when the process crashes
+ *
+ * With TT_LOGGER_FLIGHT_RECORDER=debug every log call at debug or above is also stored in a fixed-size ring
+ * owned by the calling thread, whatever the output level. A record holds the fields of a binary message
+ * record (tt-logger-binary.hpp) and the typed arguments, so storing one is a memcpy into the ring without
+ * formatting or I/O. Records are timestamped with the cycle counter, which the dump converts to wall-clock
+ * time. Once a ring is full its oldest records are overwritten.
+ *
+ * On SIGSEGV, SIGABRT or SIGBUS the rings are written to a .ttlog file using only open(2), write(2) and
+ * close(2), after which the signal's previous handler runs. A thread that gets a ring also gets an alternate
+ * signal stack unless it has one, so that the handler still runs after the thread overflowed its stack.
+ * dump() writes the same file on demand, for example from a hung process through tt-logger-ctl.
+ * tt-logger-decode prints the file, one thread after the other, each thread's messages oldest first.
+ */
+
+#pragma once
+
+#include <fmt/format.h>
+#include <spdlog/common.h>
+#include <spdlog/details/os.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tt-logger/tt-logger-binary.hpp>
+#include <tt-logger/tt-logger-clock.hpp>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#    include <fcntl.h>
+#    include <signal.h>
+#    include <unistd.h>
+#    define TT_LOGGER_HAS_FLIGHT_RECORDER 1
+#else
+#    define TT_LOGGER_HAS_FLIGHT_RECORDER 0
+#endif
+
+namespace tt {
+
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+
+// Flight recorder file when TT_LOGGER_FLIGHT_RECORDER_FILE is not set, in the working directory
+inline constexpr const char * default_flight_recorder_path = "tt-logger-flight-{pid}.ttlog";
+
+namespace detail {
+
+// Header of a record in a flight recorder ring, followed by the encoded arguments
+struct RecorderRecord {
+    static constexpr std::uint32_t padding = 0xffffffffu;  // In place of size: the rest of the ring is unused
+
+    std::uint32_t size;  // Of the whole record, header included, a multiple of 8
+    std::uint32_t call_site;
+    std::uint32_t thread_id;
+    std::uint8_t  logger;
+    std::uint8_t  level;
+    std::uint16_t args_size;
+    std::uint64_t ticks;  // TscClock::ticks() when the message was recorded
+};
+
+/**
+ * @brief Overwriting ring of records, written by the thread that owns it
+ *
+ * Positions count bytes written since the ring was created; a record never wraps around the end of the
+ * buffer. Before overwriting old records the writer moves `tail` past them, so a reader that copies a record
+ * and then still finds `tail` at or before it knows its copy is intact, even while the writer runs.
+ */
+class RecorderRing {
+  public:
+    RecorderRing *    next = nullptr;  // Next ring of the same recorder, fixed once published
+    std::atomic<bool> owned{ true };   // A running thread writes to this ring
+
+    explicit RecorderRing(std::size_t capacity) : capacity_(capacity), data_(new char[capacity]) {}
+
+    void push(RecorderRecord record, const char * args) noexcept {
+        record.size          = static_cast<std::uint32_t>((sizeof(record) + record.args_size + 7) & ~std::size_t{ 7 });
+        std::uint64_t head   = head_.load(std::memory_order_relaxed);
+        std::size_t   offset = static_cast<std::size_t>(head & (capacity_ - 1));
+        if (capacity_ - offset < record.size) {
+            make_room(head + (capacity_ - offset));
+            const std::uint32_t padding = RecorderRecord::padding;
+            std::memcpy(data_.get() + offset, &padding, sizeof(padding));
+            head += capacity_ - offset;
+            offset = 0;
+        }
+        make_room(head + record.size);
+        std::memcpy(data_.get() + offset, &record, sizeof(record));
+        std::memcpy(data_.get() + offset + sizeof(record), args, record.args_size);
+        head_.store(head + record.size, std::memory_order_release);
+    }
+
+    // Calls emit(const RecorderRecord &, const char * args) for every intact record, oldest first. Each record
+    // is first copied to `scratch`, which holds max_size bytes. Lock-free and async-signal-safe.
+    template <typename Emit> void read(char * scratch, std::size_t max_size, Emit && emit) const noexcept {
+        std::uint64_t       position = tail_.load(std::memory_order_acquire);
+        const std::uint64_t head     = head_.load(std::memory_order_acquire);
+        while (position < head) {
+            const std::size_t offset = static_cast<std::size_t>(position & (capacity_ - 1));
+            RecorderRecord    record;
+            std::memcpy(&record, data_.get() + offset, sizeof(record));
+            const bool        padding = record.size == RecorderRecord::padding;
+            const std::size_t size    = padding ? capacity_ - offset : record.size;
+            const bool        valid   = padding || (size >= sizeof(record) && size <= capacity_ - offset &&
+                                            size <= max_size && sizeof(record) + record.args_size <= size);
+            if (valid && !padding) {
+                std::memcpy(scratch, data_.get() + offset, size);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail > position) {
+                position = tail;  // Overwritten while it was copied
+                continue;
+            }
+            if (!valid) {
+                return;
+            }
+            if (!padding) {
+                std::memcpy(&record, scratch, sizeof(record));
+                emit(static_cast<const RecorderRecord &>(record), static_cast<const char *>(scratch + sizeof(record)));
+            }
+            position += size;
+        }
+    }
+
+  private:
+    std::size_t                capacity_;  // A power of two
+    std::unique_ptr<char[]>    data_;
+    std::atomic<std::uint64_t> head_{ 0 };  // End of the newest record
+    std::atomic<std::uint64_t> tail_{ 0 };  // Start of the oldest intact record
+
+    // Drops the oldest records until the bytes up to `end` fit in the ring
+    void make_room(std::uint64_t end) noexcept {
+        std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (end - tail <= capacity_) {
+            return;
+        }
+        while (end - tail > capacity_) {
+            const std::size_t offset = static_cast<std::size_t>(tail & (capacity_ - 1));
+            std::uint32_t     size;
+            std::memcpy(&size, data_.get() + offset, sizeof(size));
+            tail += size == RecorderRecord::padding ? capacity_ - offset : size;
+        }
+        // Publishes the new tail before any of the bytes it gives up are overwritten
+        tail_.store(tail, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+};
+
+// Writes through a fixed buffer with write(2) only, for use in signal handlers
+class RawFileWriter {
+  public:
+    RawFileWriter(int fd, char * buffer, std::size_t capacity) : fd_(fd), buffer_(buffer), capacity_(capacity) {}
+
+    void put(const void * data, std::size_t size) noexcept {
+        const char * bytes = static_cast<const char *>(data);
+        while (size > 0) {
+            if (used_ == capacity_) {
+                flush();
+            }
+            const std::size_t chunk = size < capacity_ - used_ ? size : capacity_ - used_;
+            std::memcpy(buffer_ + used_, bytes, chunk);
+            used_ += chunk;
+            bytes += chunk;
+            size -= chunk;
+        }
+    }
+
+    void put_byte(std::uint8_t value) noexcept { put(&value, 1); }
+
+    void put_varint(std::uint64_t value) noexcept {
+        while (value >= 0x80) {
+            put_byte(static_cast<std::uint8_t>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        put_byte(static_cast<std::uint8_t>(value));
+    }
+
+    void put_string(const char * value) noexcept {
+        const std::size_t size = value ? std::strlen(value) : 0;
+        put_varint(size);
+        put(value, size);
+    }
+
+    // Writes out the buffer; false if any write failed
+    bool flush() noexcept {
+        std::size_t written = 0;
+        while (ok_ && written < used_) {
+            const ssize_t result = ::write(fd_, buffer_ + written, used_ - written);
+            if (result > 0) {
+                written += static_cast<std::size_t>(result);
+            } else if (result < 0 && errno != EINTR) {
+                ok_ = false;
+            }
+        }
+        used_ = 0;
+        return ok_;
+    }
+
+  private:
+    int         fd_;
+    char *      buffer_;
+    std::size_t capacity_;
+    std::size_t used_ = 0;
+    bool        ok_   = true;
+};
+
+inline constexpr int flight_recorder_signals[] = { SIGSEGV, SIGABRT, SIGBUS };
+
+}  // namespace detail
+
+/**
+ * @brief Per-thread rings of recent messages that can be written out at any time, even from a crash
+ *
+ * Every thread that records gets a ring of ring_size bytes on its first message; the ring of a thread that
+ * exits is handed to the next new thread. Messages refer to call sites by the dense IDs of CallSite, whose
+ * descriptions are published with add_call_site(). Recorders are never destroyed, so that a crash can dump
+ * them at any time and exiting threads can always return their ring.
+ */
+class FlightRecorder {
+  public:
+    static constexpr std::size_t default_ring_size = 64 * 1024;
+    static constexpr std::size_t min_ring_size     = 4096;
+    static constexpr std::size_t max_record_size   = 1024;   // Longer messages are stored as cut-short text
+    static constexpr std::size_t max_call_sites    = 16384;  // Sites with higher IDs are not recorded
+    static constexpr std::size_t write_buffer_size = 64 * 1024;
+
+    // ring_size is rounded up to a power of two of at least min_ring_size
+    static FlightRecorder & create(std::vector<std::string> logger_names, std::size_t ring_size = default_ring_size) {
+        return *new FlightRecorder(std::move(logger_names), ring_size);
+    }
+
+    FlightRecorder(const FlightRecorder &)             = delete;
+    FlightRecorder & operator=(const FlightRecorder &) = delete;
+
+    std::size_t ring_size() const { return ring_size_; }
+
+    // Publishes the description of call site `id`. Strings must stay valid for the life of the process.
+    void add_call_site(std::uint32_t id, const char * file, int line, const char * function, const char * format) {
+        if (id >= max_call_sites) {
+            return;
+        }
+        CallSiteEntry & entry = call_sites_[id];
+        entry.file            = file;
+        entry.line            = line;
+        entry.function        = function;
+        entry.format.store(format, std::memory_order_release);
+        std::uint32_t count = call_site_count_.load(std::memory_order_relaxed);
+        while (count <= id && !call_site_count_.compare_exchange_weak(count, id + 1, std::memory_order_release)) {
+        }
+    }
+
+    // Stores a message of call site `call_site` whose format string has been published with add_call_site().
+    // The arguments are stored typed when they all have a binary encoding, and formatted to text otherwise.
+    template <typename... Args>
+    void record(std::uint32_t call_site, std::size_t logger, spdlog::level::level_enum level, fmt::string_view format,
+                Args &&... args) noexcept {
+        if (call_site >= max_call_sites) {
+            return;
+        }
+        spdlog::memory_buf_t encoded;
+        try {
+            BinaryArgWriter writer(encoded);
+            if constexpr ((detail::binary_encodable_v<std::decay_t<Args>> && ...) &&
+                          sizeof...(Args) <= detail::max_binary_args) {
+                writer.begin(sizeof...(Args));
+                (writer.template write<std::decay_t<Args>>(args), ...);
+            } else {
+                spdlog::memory_buf_t text;
+                fmt::vformat_to(fmt::appender(text), format, fmt::make_format_args(args...));
+                writer.write_message(std::string_view(text.data(), text.size()));
+            }
+            if (encoded.size() > max_args_size) {
+                spdlog::memory_buf_t text;
+                fmt::vformat_to(fmt::appender(text), format, fmt::make_format_args(args...));
+                encoded.clear();
+                write_cut_short(writer, std::string_view(text.data(), text.size()));
+            }
+        } catch (const std::exception &) {
+            return;  // The output path reports the format error
+        }
+        push(call_site, logger, level, encoded);
+    }
+
+    // Stores a message that has no arguments and is not a format string
+    void record_text(std::uint32_t call_site, std::size_t logger, spdlog::level::level_enum level,
+                     std::string_view text) noexcept {
+        if (call_site >= max_call_sites) {
+            return;
+        }
+        spdlog::memory_buf_t encoded;
+        BinaryArgWriter      writer(encoded);
+        write_cut_short(writer, text);
+        push(call_site, logger, level, encoded);
+    }
+
+    // Writes every ring to a binary log at `path`; false if the file cannot be written. Safe to call while other
+    // threads record: records they overwrite during the dump are left out.
+    bool dump(const std::string & path) const {
+        std::vector<char> scratch(write_buffer_size + max_record_size);
+        return dump(path.c_str(), scratch.data());
+    }
+
+    // Writes the rings to `path` on SIGSEGV, SIGABRT and SIGBUS, then hands the signal to the handler that was
+    // installed before. Only one recorder is written on a crash: the last one passed here.
+    void install_crash_handlers(const std::string & path) {
+        crash_path_.assign(path.begin(), path.end());
+        crash_path_.push_back('\0');
+        crash_scratch_.resize(write_buffer_size + max_record_size);
+        crash_recorder().store(this, std::memory_order_release);
+
+        static const bool installed = [] {
+            for (std::size_t index = 0; index < std::size(detail::flight_recorder_signals); ++index) {
+                struct sigaction action = {};
+                action.sa_handler       = &FlightRecorder::on_fatal_signal;
+                action.sa_flags         = SA_ONSTACK;
+                sigemptyset(&action.sa_mask);
+                ::sigaction(detail::flight_recorder_signals[index], &action, &previous_actions()[index]);
+            }
+            return true;
+        }();
+        (void) installed;
+    }
+
+  private:
+    struct CallSiteEntry {
+        const char *              file     = "";
+        int                       line     = 0;
+        const char *              function = "";
+        std::atomic<const char *> format{ nullptr };  // Stored last: the entry is complete once it is set
+    };
+
+    // Exits with the thread and returns its ring to the recorder
+    struct ThreadRing {
+        const FlightRecorder *  recorder = nullptr;
+        detail::RecorderRing *  ring     = nullptr;
+        std::unique_ptr<char[]> signal_stack;  // Alternate signal stack installed for the thread, if any
+
+        ~ThreadRing() {
+            if (ring) {
+                ring->owned.store(false, std::memory_order_release);
+            }
+            stack_t current = {};
+            if (signal_stack && ::sigaltstack(nullptr, &current) == 0 && current.ss_sp == signal_stack.get()) {
+                stack_t disabled  = {};
+                disabled.ss_flags = SS_DISABLE;
+                ::sigaltstack(&disabled, nullptr);
+            }
+        }
+
+        // Gives the thread an alternate signal stack unless it already has one
+        void install_signal_stack() {
+            stack_t current = {};
+            if (signal_stack || ::sigaltstack(nullptr, &current) != 0 || !(current.ss_flags & SS_DISABLE)) {
+                return;
+            }
+            const std::size_t size = std::max<std::size_t>(SIGSTKSZ, signal_stack_size);
+            signal_stack.reset(new char[size]);
+            stack_t stack = {};
+            stack.ss_sp   = signal_stack.get();
+            stack.ss_size = size;
+            if (::sigaltstack(&stack, nullptr) != 0) {
+                signal_stack.reset();
+            }
+        }
+    };
+
+    static constexpr std::size_t signal_stack_size = 64 * 1024;
+
+    static constexpr std::size_t max_args_size = max_record_size - sizeof(detail::RecorderRecord);
+
+    std::vector<std::string>            logger_names_;
+    std::size_t                         ring_size_;
+    TscClock                            clock_;  // Calibrated when the recorder is created
+    std::unique_ptr<CallSiteEntry[]>    call_sites_;
+    std::atomic<std::uint32_t>          call_site_count_{ 0 };
+    std::atomic<detail::RecorderRing *> rings_{ nullptr };  // Push-only list, newest first
+    std::vector<char>                   crash_path_;
+    mutable std::vector<char>           crash_scratch_;
+
+    FlightRecorder(std::vector<std::string> logger_names, std::size_t ring_size) :
+        logger_names_(std::move(logger_names)),
+        ring_size_(min_ring_size),
+        call_sites_(new CallSiteEntry[max_call_sites]) {
+        while (ring_size_ < ring_size) {
+            ring_size_ *= 2;
+        }
+    }
+
+    static std::atomic<FlightRecorder *> & crash_recorder() {
+        static std::atomic<FlightRecorder *> recorder{ nullptr };
+        return recorder;
+    }
+
+    static struct sigaction * previous_actions() {
+        static struct sigaction actions[std::size(detail::flight_recorder_signals)];
+        return actions;
+    }
+
+    // Keeps the start of a message that does not fit in one record
+    static void write_cut_short(BinaryArgWriter & writer, std::string_view text) {
+        constexpr std::size_t max_text = max_args_size - 16;  // Room for the marker and the length
+        writer.write_message(text.size() > max_text ? text.substr(0, max_text) : text);
+    }
+
+    void push(std::uint32_t call_site, std::size_t logger, spdlog::level::level_enum level,
+              const spdlog::memory_buf_t & encoded) noexcept {
+        detail::RecorderRecord record{};
+        record.call_site = call_site;
+        record.thread_id = static_cast<std::uint32_t>(spdlog::details::os::thread_id());
+        record.logger    = static_cast<std::uint8_t>(logger);
+        record.level     = static_cast<std::uint8_t>(level);
+        record.args_size = static_cast<std::uint16_t>(encoded.size());
+        record.ticks     = TscClock::ticks();
+        thread_ring().push(record, encoded.data());
+    }
+
+    detail::RecorderRing & thread_ring() {
+        thread_local ThreadRing slot;
+        if (slot.recorder != this) {
+            if (slot.ring) {
+                slot.ring->owned.store(false, std::memory_order_release);
+            }
+            slot.ring     = acquire_ring();
+            slot.recorder = this;
+            slot.install_signal_stack();
+        }
+        return *slot.ring;
+    }
+
+    // A ring left behind by an exited thread, or a new one
+    detail::RecorderRing * acquire_ring() {
+        for (auto * ring = rings_.load(std::memory_order_acquire); ring; ring = ring->next) {
+            if (!ring->owned.load(std::memory_order_relaxed) &&
+                !ring->owned.exchange(true, std::memory_order_acquire)) {
+                return ring;
+            }
+        }
+        auto * ring = new detail::RecorderRing(ring_size_);
+        ring->next  = rings_.load(std::memory_order_relaxed);
+        while (!rings_.compare_exchange_weak(ring->next, ring, std::memory_order_release)) {
+        }
+        return ring;
+    }
+
+    // scratch holds write_buffer_size + max_record_size bytes. Async-signal-safe.
+    bool dump(const char * path, char * scratch) const noexcept {
+        const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        detail::RawFileWriter out(fd, scratch, write_buffer_size);
+        out.put(detail::binary_log_magic, sizeof(detail::binary_log_magic));
+        out.put_byte(detail::binary_log_version);
+        for (std::size_t id = 0; id < logger_names_.size(); ++id) {
+            out.put_byte(static_cast<std::uint8_t>(detail::BinaryRecordTag::logger));
+            out.put_varint(id);
+            out.put_string(logger_names_[id].c_str());
+        }
+        // Sites registered but not yet published are written empty, so that the IDs stay dense
+        const std::uint32_t call_site_count = call_site_count_.load(std::memory_order_acquire);
+        for (std::uint32_t id = 0; id < call_site_count; ++id) {
+            const CallSiteEntry & entry  = call_sites_[id];
+            const char *          format = entry.format.load(std::memory_order_acquire);
+            out.put_byte(static_cast<std::uint8_t>(detail::BinaryRecordTag::call_site));
+            out.put_varint(id);
+            out.put_string(format ? entry.file : "");
+            out.put_varint(format ? static_cast<std::uint64_t>(entry.line) : 0);
+            out.put_string(format ? entry.function : "");
+            out.put_string(format ? format : "");
+        }
+
+        // A copy calibrated now converts with the tick rate measured since the recorder was created
+        TscClock clock = clock_;
+        clock.recalibrate();
+        std::int64_t last_time_ns = 0;
+        for (const auto * ring = rings_.load(std::memory_order_acquire); ring; ring = ring->next) {
+            ring->read(scratch + write_buffer_size, max_record_size,
+                       [&](const detail::RecorderRecord & record, const char * args) {
+                           if (record.call_site >= call_site_count || record.logger >= logger_names_.size()) {
+                               return;  // Site published after the definitions above were written
+                           }
+                           const std::int64_t time_ns = clock.to_ns(record.ticks);
+                           out.put_byte(static_cast<std::uint8_t>(detail::BinaryRecordTag::message));
+                           out.put_varint(detail::zigzag_encode(time_ns - last_time_ns));
+                           out.put_varint(record.logger);
+                           out.put_byte(record.level);
+                           out.put_varint(record.call_site);
+                           out.put_varint(record.thread_id);
+                           out.put(args, record.args_size);
+                           last_time_ns = time_ns;
+                       });
+        }
+        const bool written = out.flush();
+        return ::close(fd) == 0 && written;
+    }
+
+    static void on_fatal_signal(int signal) {
+        static std::atomic<bool> dumped{ false };
+        const FlightRecorder *   recorder = crash_recorder().load(std::memory_order_acquire);
+        if (recorder && !dumped.exchange(true)) {
+            const char * path = recorder->crash_path_.data();
+            if (recorder->dump(path, recorder->crash_scratch_.data())) {
+                static constexpr char message[] = "tt-logger: flight recorder written to ";
+                (void) !::write(STDERR_FILENO, message, sizeof(message) - 1);
+                (void) !::write(STDERR_FILENO, path, std::strlen(path));
+                (void) !::write(STDERR_FILENO, "\n", 1);
+            }
+        }
+        // The signal stays blocked until this handler returns, and is then delivered to the previous handler
+        for (std::size_t index = 0; index < std::size(detail::flight_recorder_signals); ++index) {
+            if (detail::flight_recorder_signals[index] == signal) {
+                ::sigaction(signal, &previous_actions()[index], nullptr);
+            }
+        }
+        ::raise(signal);
+    }
+};
+
+#endif  // TT_LOGGER_HAS_FLIGHT_RECORDER
+
+}  // namespace tt
@@ -0,0 +1,315 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-rotating.hpp
+ * @brief File sink that starts a new segment file after a size or time threshold
+ *
+ * TT_LOGGER_FILE=run.log with TT_LOGGER_ROTATE_SIZE or TT_LOGGER_ROTATE_INTERVAL set writes run.0.log,
+ * run.1.log, ... A background thread creates the next segment, and on Linux reserves its disk space,
+ * before it is needed, and closes finished segments, so the thread whose message crosses the threshold
+ * only swaps file handles.
+ */
+
+#pragma once
+
+#include <spdlog/common.h>
+#include <spdlog/details/log_msg.h>
+#include <spdlog/sinks/base_sink.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#    include <fcntl.h>
+#    include <unistd.h>
+#endif
+
+namespace tt {
+
+struct RotationPolicy {
+    std::uint64_t        max_size  = 0;     // Bytes per segment, 0 for no size limit
+    std::chrono::seconds interval  = {};    // Time per segment, 0 for no time limit
+    bool                 precreate = true;  // Create the next segment on the background thread
+};
+
+struct RotatingFileSinkStats {
+    std::uint64_t rotations = 0;
+    std::uint64_t waits     = 0;  // Rotations that had to wait for the next segment to be created
+};
+
+namespace detail {
+
+inline std::optional<std::uint64_t> parse_unsigned(std::string_view text) {
+    if (text.empty() || text.size() > 12 || text.find_first_not_of("0123456789") != std::string_view::npos) {
+        return std::nullopt;
+    }
+    std::uint64_t value = 0;
+    for (const char digit : text) {
+        value = value * 10 + static_cast<std::uint64_t>(digit - '0');
+    }
+    return value;
+}
+
+// Parses a number with an optional suffix, one of `suffixes`, that multiplies it by the matching multiplier
+inline std::optional<std::uint64_t> parse_with_suffix(std::string_view text, std::string_view suffixes,
+                                                      const std::uint64_t * multipliers) {
+    std::uint64_t multiplier = 1;
+    if (!text.empty()) {
+        const std::size_t suffix = suffixes.find(text.back());
+        if (suffix != std::string_view::npos) {
+            multiplier = multipliers[suffix];
+            text.remove_suffix(1);
+        }
+    }
+    const auto value = parse_unsigned(text);
+    return value ? std::optional<std::uint64_t>(*value * multiplier) : std::nullopt;
+}
+
+// Byte count with an optional K, M or G suffix (powers of 1024)
+inline std::optional<std::uint64_t> parse_byte_size(std::string_view text) {
+    static constexpr std::uint64_t multipliers[] = { 1ull << 10, 1ull << 20, 1ull << 30 };
+    return parse_with_suffix(text, "KMG", multipliers);
+}
+
+// Duration with an optional s, m, h or d suffix; seconds without one
+inline std::optional<std::chrono::seconds> parse_interval(std::string_view text) {
+    static constexpr std::uint64_t multipliers[] = { 1, 60, 3600, 86400 };
+    const auto                     seconds       = parse_with_suffix(text, "smhd", multipliers);
+    return seconds ? std::optional<std::chrono::seconds>(*seconds) : std::nullopt;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Text file sink that rotates to a new segment file by size and/or age
+ *
+ * The size limit is checked before each message, so a segment only exceeds max_size when a single message
+ * is larger. The age limit counts from the first message of a segment, using the message timestamps.
+ */
+class RotatingFileSink final : public spdlog::sinks::base_sink<std::mutex> {
+  public:
+    // run.log -> run.<index>.log
+    static std::string segment_path(const std::string & filename, std::size_t index) {
+        const std::filesystem::path path(filename);
+        std::filesystem::path       segment = path.parent_path() / path.stem();
+        segment += "." + std::to_string(index);
+        segment += path.extension();
+        return segment.string();
+    }
+
+    RotatingFileSink(std::string filename, RotationPolicy policy) :
+        filename_(std::move(filename)), policy_(policy) {
+        current_ = open_segment(segment_path(filename_, 0), policy_.max_size);
+        if (!current_.file) {
+            spdlog::throw_spdlog_ex("Failed opening file " + current_.path + " for writing", errno);
+        }
+        if (policy_.precreate) {
+            preparer_ = std::thread([this] { prepare(); });
+        }
+    }
+
+    ~RotatingFileSink() override {
+        {
+            std::lock_guard<std::mutex> lock(prepare_mutex_);
+            stopping_ = true;
+        }
+        prepare_cv_.notify_all();
+        if (preparer_.joinable()) {
+            preparer_.join();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        close_segment(current_);
+        if (next_.file) {
+            // Created ahead of time but never used
+            close_segment(next_);
+            std::remove(next_.path.c_str());
+        }
+    }
+
+    RotatingFileSinkStats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    // Path of the segment being written
+    std::string current_path() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return current_.path;
+    }
+
+  protected:
+    void sink_it_(const spdlog::details::log_msg & msg) override {
+        spdlog::memory_buf_t formatted;
+        formatter_->format(msg, formatted);
+
+        if (current_.size == 0) {
+            segment_deadline_ = msg.time + policy_.interval;
+        } else if ((policy_.max_size > 0 && current_.size + formatted.size() > policy_.max_size) ||
+                   (policy_.interval.count() > 0 && msg.time >= segment_deadline_)) {
+            rotate();
+            segment_deadline_ = msg.time + policy_.interval;
+        }
+
+        if (std::fwrite(formatted.data(), 1, formatted.size(), current_.file) != formatted.size()) {
+            spdlog::throw_spdlog_ex("Failed writing to file " + current_.path, errno);
+        }
+        current_.size += formatted.size();
+    }
+
+    void flush_() override { std::fflush(current_.file); }
+
+  private:
+    struct Segment {
+        std::FILE *   file = nullptr;
+        std::string   path;
+        std::uint64_t size = 0;
+    };
+
+    std::string           filename_;
+    RotationPolicy        policy_;
+    RotatingFileSinkStats stats_;
+
+    // Written under mutex_, by the thread that logs
+    Segment                       current_;
+    std::size_t                   index_ = 0;
+    spdlog::log_clock::time_point segment_deadline_;
+
+    // Shared with the preparer thread under prepare_mutex_
+    std::mutex              prepare_mutex_;
+    std::condition_variable prepare_cv_;
+    Segment                 next_;        // Segment index_ + 1 once created
+    std::string             next_error_;  // Why creating next_ failed
+    std::vector<Segment>    retired_;     // Finished segments waiting to be closed
+    bool                    stopping_ = false;
+    std::thread             preparer_;
+
+    static Segment open_segment(const std::string & path, std::uint64_t reserve) {
+        Segment segment;
+        segment.path = path;
+#if defined(__linux__)
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            // Reserve the blocks without changing the file size, so readers never see the unused tail
+            if (reserve > 0) {
+                (void) ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(reserve));
+            }
+            segment.file = ::fdopen(fd, "w");
+            if (!segment.file) {
+                ::close(fd);
+            }
+        }
+#else
+        (void) reserve;
+        segment.file = std::fopen(path.c_str(), "w");
+#endif
+        return segment;
+    }
+
+    // Writes out and closes a segment, giving back space reserved beyond what was written
+    static void close_segment(Segment & segment) {
+        if (!segment.file) {
+            return;
+        }
+        std::fflush(segment.file);
+#if defined(__linux__)
+        (void) ::ftruncate(::fileno(segment.file), static_cast<off_t>(segment.size));
+#endif
+        std::fclose(segment.file);
+        segment.file = nullptr;
+    }
+
+    // Switches to segment index_ + 1. Called under mutex_.
+    void rotate() {
+        Segment next;
+        if (policy_.precreate) {
+            std::unique_lock<std::mutex> lock(prepare_mutex_);
+            if (!next_.file && next_error_.empty()) {
+                ++stats_.waits;
+                prepare_cv_.wait(lock, [&] { return next_.file || !next_error_.empty(); });
+            }
+            if (!next_.file) {
+                const std::string error = std::exchange(next_error_, std::string());
+                lock.unlock();
+                prepare_cv_.notify_all();  // Try again at the next rotation
+                spdlog::throw_spdlog_ex(error);
+            }
+            next = std::exchange(next_, Segment{});
+            retired_.push_back(current_);
+        } else {
+            const std::string path = segment_path(filename_, index_ + 1);
+            next                   = open_segment(path, policy_.max_size);
+            if (!next.file) {
+                spdlog::throw_spdlog_ex("Failed opening file " + path + " for writing", errno);
+            }
+            close_segment(current_);
+        }
+
+        current_ = next;
+        ++index_;
+        ++stats_.rotations;
+        if (policy_.precreate) {
+            prepare_cv_.notify_all();
+        }
+    }
+
+    // Background thread: keeps segment index_ + 1 created and closes retired segments. After a failure it
+    // waits for the logging thread to take the error before trying again.
+    void prepare() {
+        std::size_t                  prepared = 0;  // Index of the last segment created
+        std::unique_lock<std::mutex> lock(prepare_mutex_);
+        for (;;) {
+            prepare_cv_.wait(lock, [&] {
+                return stopping_ || !retired_.empty() || (!next_.file && next_error_.empty());
+            });
+            if (stopping_) {
+                break;
+            }
+
+            std::vector<Segment> retired = std::move(retired_);
+            retired_.clear();
+            const bool create = !next_.file && next_error_.empty();
+            lock.unlock();
+
+            for (auto & segment : retired) {
+                close_segment(segment);
+            }
+            Segment     segment;
+            std::string error;
+            if (create) {
+                const std::string path = segment_path(filename_, ++prepared);
+                segment                = open_segment(path, policy_.max_size);
+                if (!segment.file) {
+                    error = "Failed opening file " + path + " for writing: " + std::strerror(errno);
+                    --prepared;
+                }
+            }
+
+            lock.lock();
+            if (create) {
+                next_       = segment;
+                next_error_ = error;
+            }
+            prepare_cv_.notify_all();
+        }
+        for (auto & segment : retired_) {
+            close_segment(segment);
+        }
+        retired_.clear();
+    }
+};
+
+}  // namespace tt
@@ -0,0 +1,240 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-shm.hpp
+ * @brief Per-LogType level table shared by every process of a job through POSIX shared memory
+ *
+ * The level table checked by the log_* macros fills exactly one page. A process attaching to a job's
+ * segment maps the segment read-only over that page, so the check stays the same relaxed load and now
+ * reads a level that one external writer (tt-logger-ctl --job) can change for the whole job at once.
+ *
+ * The first process to attach creates the segment "/tt-logger-<job id>" from its own levels. Segments
+ * outlive the processes using them and are removed with remove_shared_levels().
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#if defined(__linux__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#    define TT_LOGGER_HAS_SHARED_LEVELS 1
+#else
+#    define TT_LOGGER_HAS_SHARED_LEVELS 0
+#endif
+
+namespace tt {
+
+namespace detail {
+
+constexpr std::size_t   level_page_size     = 4096;
+constexpr std::uint32_t shared_levels_magic = 0x5454'4c56;  // "TTLV"
+
+// Page holding the runtime level of every LogType. The levels come first so the hot path indexes the page
+// directly; magic and type_count are only meaningful in a shared segment, where magic is stored last by
+// the creating process.
+template <std::size_t N> struct alignas(level_page_size) LevelPage {
+    std::array<std::atomic<std::uint8_t>, N> levels;
+    std::atomic<std::uint32_t>               magic;
+    std::uint32_t                            type_count;
+};
+
+}  // namespace detail
+
+#if TT_LOGGER_HAS_SHARED_LEVELS
+
+namespace detail {
+
+inline std::string shared_levels_name(std::string_view job_id) {
+    if (job_id.empty() || job_id.find('/') != std::string_view::npos) {
+        throw std::runtime_error("tt-logger: invalid job ID '" + std::string(job_id) + "' for shared levels");
+    }
+    return "/tt-logger-" + std::string(job_id);
+}
+
+inline std::runtime_error shared_levels_error(const char * what, const std::string & name) {
+    return std::runtime_error(std::string("tt-logger: cannot ") + what + " shared levels '" + name +
+                              "': " + std::strerror(errno));
+}
+
+// Maps a segment, throwing with `name` in the message on failure
+template <std::size_t N> LevelPage<N> * map_level_page(int fd, int protection, const std::string & name) {
+    void * page = ::mmap(nullptr, level_page_size, protection, MAP_SHARED, fd, 0);
+    if (page == MAP_FAILED) {
+        throw shared_levels_error("map", name);
+    }
+    return static_cast<LevelPage<N> *>(page);
+}
+
+// Waits for the creator of a segment to finish initializing it, then checks it describes N types
+template <std::size_t N> void validate_level_page(const LevelPage<N> & page, const std::string & name) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (page.magic.load(std::memory_order_acquire) != shared_levels_magic) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw std::runtime_error("tt-logger: shared levels '" + name + "' were never initialized");
+        }
+        std::this_thread::yield();
+    }
+    if (page.type_count != N) {
+        throw std::runtime_error("tt-logger: shared levels '" + name + "' hold " + std::to_string(page.type_count) +
+                                 " log types, expected " + std::to_string(N));
+    }
+}
+
+// Opens the job's segment read-only, first creating it with `initial` levels if it does not exist. The
+// segment is created readable and writable by its owner only: a job runs as one user, and anyone who can
+// write it can change the levels of every process of the job.
+template <std::size_t N>
+int open_shared_levels(std::string_view job_id, const std::array<std::uint8_t, N> & initial) {
+    const std::string name = shared_levels_name(job_id);
+
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd >= 0) {
+        if (::ftruncate(fd, level_page_size) < 0) {
+            const auto error = shared_levels_error("size", name);
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw error;
+        }
+        LevelPage<N> * page = map_level_page<N>(fd, PROT_READ | PROT_WRITE, name);
+        for (std::size_t index = 0; index < N; ++index) {
+            page->levels[index].store(initial[index], std::memory_order_relaxed);
+        }
+        page->type_count = static_cast<std::uint32_t>(N);
+        page->magic.store(shared_levels_magic, std::memory_order_release);
+        ::munmap(page, level_page_size);
+        ::close(fd);
+    } else if (errno != EEXIST) {
+        throw shared_levels_error("create", name);
+    }
+
+    fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        throw shared_levels_error("open", name);
+    }
+    try {
+        // A segment created by another process may not have been sized yet
+        struct stat info {};
+        const auto  deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (::fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) < level_page_size &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        if (static_cast<std::size_t>(info.st_size) < level_page_size) {
+            throw std::runtime_error("tt-logger: shared levels '" + name + "' are too small");
+        }
+        LevelPage<N> * page = map_level_page<N>(fd, PROT_READ, name);
+        try {
+            validate_level_page(*page, name);
+        } catch (...) {
+            ::munmap(page, level_page_size);
+            throw;
+        }
+        ::munmap(page, level_page_size);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    return fd;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Replaces `table` with a read-only mapping of the job's shared segment
+ *
+ * The segment is created from `initial` if this is the first process of the job to attach. The table
+ * must fill whole pages of the running system, so this fails on systems with pages larger than
+ * level_page_size. Throws std::runtime_error on failure, leaving `table` untouched.
+ */
+template <std::size_t N>
+void attach_shared_levels(detail::LevelPage<N> & table, std::string_view job_id,
+                          const std::array<std::uint8_t, N> & initial) {
+    if (static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)) > detail::level_page_size) {
+        throw std::runtime_error("tt-logger: shared levels need a page size of at most " +
+                                 std::to_string(detail::level_page_size) + " bytes");
+    }
+    const int fd        = detail::open_shared_levels(job_id, initial);
+    void *    mapped    = ::mmap(&table, detail::level_page_size, PROT_READ, MAP_SHARED | MAP_FIXED, fd, 0);
+    const int map_errno = errno;
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        errno = map_errno;
+        throw detail::shared_levels_error("map", detail::shared_levels_name(job_id));
+    }
+}
+
+// Gives `table` back its own private, writable page. The caller fills in the levels again.
+template <std::size_t N> void detach_shared_levels(detail::LevelPage<N> & table) {
+    if (::mmap(&table, detail::level_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1,
+               0) == MAP_FAILED) {
+        std::perror("tt-logger: cannot restore the private level table");
+        std::abort();
+    }
+}
+
+// Removes a job's segment. Processes that are attached keep their mapping.
+inline bool remove_shared_levels(std::string_view job_id) {
+    return ::shm_unlink(detail::shared_levels_name(job_id).c_str()) == 0;
+}
+
+/**
+ * @brief Writable view of a job's shared levels, for the process that changes them
+ */
+template <std::size_t N> class SharedLevelsWriter {
+  public:
+    // Opens an existing segment; throws std::runtime_error if there is none or it does not match
+    explicit SharedLevelsWriter(std::string_view job_id) {
+        const std::string name = detail::shared_levels_name(job_id);
+        const int         fd   = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        if (fd < 0) {
+            throw detail::shared_levels_error("open", name);
+        }
+        try {
+            page_ = detail::map_level_page<N>(fd, PROT_READ | PROT_WRITE, name);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+        try {
+            detail::validate_level_page(*page_, name);
+        } catch (...) {
+            ::munmap(page_, detail::level_page_size);
+            throw;
+        }
+    }
+
+    SharedLevelsWriter(const SharedLevelsWriter &)             = delete;
+    SharedLevelsWriter & operator=(const SharedLevelsWriter &) = delete;
+
+    ~SharedLevelsWriter() { ::munmap(page_, detail::level_page_size); }
+
+    std::uint8_t get(std::size_t type) const { return page_->levels[type].load(std::memory_order_relaxed); }
+
+    void set(std::size_t type, std::uint8_t level) { page_->levels[type].store(level, std::memory_order_relaxed); }
+
+  private:
+    detail::LevelPage<N> * page_ = nullptr;
+};
+
+#endif  // TT_LOGGER_HAS_SHARED_LEVELS
+
+}  // namespace tt
@@ -0,0 +1,176 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-split.hpp
+ * @brief Sink that writes every LogType, or group of LogTypes, to a file of its own
+ *
+ * TT_LOGGER_FILE=run-{type}.log, or TT_LOGGER_FILE_PER_TYPE=1 with TT_LOGGER_FILE=run.log, writes
+ * run-Op.log, run-Device.log, ... Every file has its own sink and lock, so threads logging independent
+ * types never wait for each other. tt-logger-merge interleaves the files again by timestamp.
+ */
+
+#pragma once
+
+#include <spdlog/details/log_msg.h>
+#include <spdlog/formatter.h>
+#include <spdlog/pattern_formatter.h>
+#include <spdlog/sinks/sink.h>
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tt {
+
+// Placeholder in TT_LOGGER_FILE replaced by the name of the LogType or group a file belongs to
+inline constexpr std::string_view type_placeholder = "{type}";
+
+// "dir/run.log.gz" -> "dir/run-{type}.log.gz"; a path that already holds {type} is returned unchanged
+inline std::string per_type_path_template(std::string_view path) {
+    if (path.find(type_placeholder) != std::string_view::npos) {
+        return std::string(path);
+    }
+    const std::size_t name_start = path.rfind('/') == std::string_view::npos ? 0 : path.rfind('/') + 1;
+    const std::size_t extension  = path.find('.', name_start + 1);
+    std::string       result(path.substr(0, extension));
+    result += "-";
+    result += type_placeholder;
+    if (extension != std::string_view::npos) {
+        result += path.substr(extension);
+    }
+    return result;
+}
+
+// Replaces every {type} in a path template with `name`
+inline std::string expand_type_placeholder(std::string_view path_template, std::string_view name) {
+    std::string result;
+    for (;;) {
+        const std::size_t placeholder = path_template.find(type_placeholder);
+        result += path_template.substr(0, placeholder);
+        if (placeholder == std::string_view::npos) {
+            return result;
+        }
+        result += name;
+        path_template.remove_prefix(placeholder + type_placeholder.size());
+    }
+}
+
+/**
+ * @brief Routes every message to the file of its logger
+ *
+ * Each route maps a logger name to a file name; loggers with the same file name share one file. A file is
+ * opened through open_file(file_name) when its first message arrives, so types that never log leave no
+ * empty files behind. Messages of loggers without a route go to default_file.
+ */
+class SplitSink final : public spdlog::sinks::sink {
+  public:
+    using OpenFile = std::function<std::shared_ptr<spdlog::sinks::sink>(const std::string & file_name)>;
+
+    SplitSink(const std::vector<std::pair<std::string, std::string>> & routes, const std::string & default_file,
+              OpenFile open_file) :
+        open_file_(std::move(open_file)) {
+        default_ = &file_named(default_file);
+        for (const auto & [logger_name, file_name] : routes) {
+            routes_.emplace(logger_name, &file_named(file_name));
+        }
+    }
+
+    void log(const spdlog::details::log_msg & msg) override {
+        file_sink(std::string_view(msg.logger_name.data(), msg.logger_name.size()))->log(msg);
+    }
+
+    // Sink of the file that messages of a logger go to, opening the file if it is not yet. Lets a backend
+    // hand records to a file sink directly, for example the typed arguments of a deferred record to a
+    // BinarySink.
+    spdlog::sinks::sink * file_sink(std::string_view logger_name) {
+        const auto            route = routes_.find(logger_name);
+        File &                file  = route == routes_.end() ? *default_ : *route->second;
+        spdlog::sinks::sink * sink  = file.sink.load(std::memory_order_acquire);
+        return sink ? sink : open(file);
+    }
+
+    void flush() override {
+        for_each_file([](spdlog::sinks::sink & file_sink) { file_sink.flush(); });
+    }
+
+    void set_pattern(const std::string & pattern) override {
+        set_formatter(std::make_unique<spdlog::pattern_formatter>(pattern));
+    }
+
+    void set_formatter(std::unique_ptr<spdlog::formatter> formatter) override {
+        std::lock_guard<std::mutex> lock(open_mutex_);
+        formatter_ = std::move(formatter);
+        for (const auto & file : files_) {
+            if (file->owner) {
+                file->owner->set_formatter(formatter_->clone());
+            }
+        }
+    }
+
+    // Calls f(spdlog::sinks::sink &) for every file opened so far
+    template <typename F> void for_each_file(F && f) {
+        std::lock_guard<std::mutex> lock(open_mutex_);
+        for (const auto & file : files_) {
+            if (file->owner) {
+                f(*file->owner);
+            }
+        }
+    }
+
+    // Names of the files opened so far, in the order they were first needed
+    std::vector<std::string> open_files() {
+        std::lock_guard<std::mutex> lock(open_mutex_);
+        return opened_;
+    }
+
+  private:
+    struct File {
+        std::string                          name;
+        std::atomic<spdlog::sinks::sink *>   sink{ nullptr };  // owner once opened, read without the lock
+        std::shared_ptr<spdlog::sinks::sink> owner;
+    };
+
+    OpenFile                                   open_file_;
+    std::vector<std::unique_ptr<File>>         files_;
+    std::map<std::string, File *, std::less<>> routes_;  // Fixed after construction
+    File *                                     default_ = nullptr;
+    std::mutex                                 open_mutex_;
+    std::unique_ptr<spdlog::formatter>         formatter_;
+    std::vector<std::string>                   opened_;
+
+    File & file_named(const std::string & name) {
+        for (const auto & file : files_) {
+            if (file->name == name) {
+                return *file;
+            }
+        }
+        files_.push_back(std::make_unique<File>());
+        files_.back()->name = name;
+        return *files_.back();
+    }
+
+    spdlog::sinks::sink * open(File & file) {
+        std::lock_guard<std::mutex> lock(open_mutex_);
+        if (!file.owner) {
+            auto file_sink = open_file_(file.name);
+            if (formatter_) {
+                file_sink->set_formatter(formatter_->clone());
+            }
+            file.owner = std::move(file_sink);
+            opened_.push_back(file.name);
+            file.sink.store(file.owner.get(), std::memory_order_release);
+        }
+        return file.owner.get();
+    }
+};
+
+}  // namespace tt
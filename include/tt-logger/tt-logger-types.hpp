@@ -0,0 +1,58 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-types.hpp
+ * @brief The LogType categories, shared by tt-logger.hpp and tt-logger-compiled.hpp
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#define TT_LOGGER_TYPES \
+    X(Always)           \
+    X(Test)             \
+    X(Timer)            \
+    X(Device)           \
+    X(Distributed)      \
+    X(LLRuntime)        \
+    X(Loader)           \
+    X(BuildKernels)     \
+    X(Verif)            \
+    X(Op)               \
+    X(Dispatch)         \
+    X(Fabric)           \
+    X(Metal)            \
+    X(TTNN)             \
+    X(MetalTrace)       \
+    X(Inspector)        \
+    X(SiliconDriver)    \
+    X(EmulationDriver)
+
+namespace tt {
+
+enum LogType {
+
+#define X(name) Log##name,
+    TT_LOGGER_TYPES
+#undef X
+};
+
+constexpr std::array<const char *, std::size_t(LogType::LogEmulationDriver) + 1> log_type_names = {
+#define X(name) #name,
+    TT_LOGGER_TYPES
+#undef X
+};
+
+constexpr const char * logtype_to_string(LogType logtype) noexcept {
+    return static_cast<std::size_t>(logtype) < log_type_names.size() ?
+               log_type_names[static_cast<std::size_t>(logtype)] :
+               "UnknownType";
+}
+
+}  // namespace tt
+
+#undef TT_LOGGER_TYPES
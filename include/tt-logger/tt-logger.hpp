@@ -4,19 +4,59 @@
 
 #pragma once
 
+#include <spdlog/details/backtracer.h>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cctype>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <tt-logger/tt-logger-async.hpp>
+#include <tt-logger/tt-logger-binary.hpp>
+#include <tt-logger/tt-logger-compressed.hpp>
+#include <tt-logger/tt-logger-config.hpp>
+#include <tt-logger/tt-logger-control.hpp>
+#include <tt-logger/tt-logger-dedup.hpp>
+#include <tt-logger/tt-logger-deferred.hpp>
+#include <tt-logger/tt-logger-path.hpp>
+#include <tt-logger/tt-logger-recorder.hpp>
+#include <tt-logger/tt-logger-rotating.hpp>
+#include <tt-logger/tt-logger-shm.hpp>
+#include <tt-logger/tt-logger-split.hpp>
+#include <tt-logger/tt-logger-types.hpp>
+#include <vector>
+
+#if defined(__cpp_constinit)
+#    define TT_LOGGER_CONSTINIT constinit
+#else
+#    define TT_LOGGER_CONSTINIT
+#endif
+
+// Out-of-line path of the log_* macros: never inlined into the caller, and on GCC and Clang placed in
+// .text.unlikely with the branch to it in the caller's cold section
+#if defined(__GNUC__)
+#    define TT_LOGGER_COLD [[gnu::cold, gnu::noinline]]
+#elif defined(_MSC_VER)
+#    define TT_LOGGER_COLD __declspec(noinline)
+#else
+#    define TT_LOGGER_COLD
+#endif
 
 #ifdef _WIN32
 #    include <io.h>
@@ -26,207 +66,2171 @@
 #    include <unistd.h>
 #endif
 
-#define TT_LOGGER_TYPES \
-    X(Always)           \
-    X(Test)             \
-    X(Timer)            \
-    X(Device)           \
-    X(Distributed)      \
-    X(LLRuntime)        \
-    X(Loader)           \
-    X(BuildKernels)     \
-    X(Verif)            \
-    X(Op)               \
-    X(Dispatch)         \
-    X(Fabric)           \
-    X(Metal)            \
-    X(TTNN)             \
-    X(MetalTrace)       \
-    X(Inspector)        \
-    X(SiliconDriver)    \
-    X(EmulationDriver)
+namespace tt {
+
+namespace detail {
+
+constexpr std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// Calls f(entry) for every non-empty entry of a comma- or semicolon-separated list
+template <typename F> constexpr void for_each_list_entry(std::string_view list, F && f) {
+    while (!list.empty()) {
+        const std::size_t end   = list.find_first_of(",;");
+        const auto        entry = trim(list.substr(0, end));
+        if (!entry.empty()) {
+            f(entry);
+        }
+        list.remove_prefix(end == std::string_view::npos ? list.size() : end + 1);
+    }
+}
+
+constexpr bool equals_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t index = 0; index < a.size(); ++index) {
+        char x = a[index], y = b[index];
+        x      = (x >= 'A' && x <= 'Z') ? static_cast<char>(x - 'A' + 'a') : x;
+        y      = (y >= 'A' && y <= 'Z') ? static_cast<char>(y - 'A' + 'a') : y;
+        if (x != y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// SPDLOG_LEVEL_* value of a level name (case-insensitive), or -1
+constexpr int level_from_name(std::string_view name) {
+    if (equals_ignore_case(name, "trace")) {
+        return SPDLOG_LEVEL_TRACE;
+    }
+    if (equals_ignore_case(name, "debug")) {
+        return SPDLOG_LEVEL_DEBUG;
+    }
+    if (equals_ignore_case(name, "info")) {
+        return SPDLOG_LEVEL_INFO;
+    }
+    if (equals_ignore_case(name, "warn") || equals_ignore_case(name, "warning")) {
+        return SPDLOG_LEVEL_WARN;
+    }
+    if (equals_ignore_case(name, "error")) {
+        return SPDLOG_LEVEL_ERROR;
+    }
+    if (equals_ignore_case(name, "critical") || equals_ignore_case(name, "fatal")) {
+        return SPDLOG_LEVEL_CRITICAL;
+    }
+    if (equals_ignore_case(name, "off")) {
+        return SPDLOG_LEVEL_OFF;
+    }
+    return -1;
+}
+
+// Index into log_type_names, or -1
+constexpr int log_type_from_name(std::string_view name) {
+    for (std::size_t index = 0; index < log_type_names.size(); ++index) {
+        if (name == log_type_names[index]) {
+            return static_cast<int>(index);
+        }
+    }
+    return -1;
+}
+
+using LogTypeLevels = std::array<int, log_type_names.size()>;
+
+// Parses "level,Type:level,..." into a minimum level per LogType. A bare level applies to every type
+// without an entry of its own; types without any entry get default_level. Invalid entries are skipped
+// after calling on_error(const char * problem, std::string_view entry).
+template <typename OnError>
+constexpr LogTypeLevels parse_log_type_levels(std::string_view spec, int default_level, OnError && on_error) {
+    for_each_list_entry(spec, [&](std::string_view entry) {
+        if (entry.find_first_of(":=") == std::string_view::npos) {
+            const int level = level_from_name(entry);
+            if (level < 0) {
+                on_error("unknown log level", entry);
+                return;
+            }
+            default_level = level;
+        }
+    });
+    LogTypeLevels levels{};
+    for (auto & level : levels) {
+        level = default_level;
+    }
+    for_each_list_entry(spec, [&](std::string_view entry) {
+        const std::size_t separator = entry.find_first_of(":=");
+        if (separator == std::string_view::npos) {
+            return;
+        }
+        const int type  = log_type_from_name(trim(entry.substr(0, separator)));
+        const int level = level_from_name(trim(entry.substr(separator + 1)));
+        if (type < 0) {
+            on_error("unknown LogType", entry);
+        } else if (level < 0) {
+            on_error("unknown log level", entry);
+        } else {
+            levels[static_cast<std::size_t>(type)] = level;
+        }
+    });
+    return levels;
+}
+
+// One bit per LogType
+using LogTypeMask = std::uint64_t;
+static_assert(log_type_names.size() <= 64, "LogTypeMask needs a bit for every LogType");
+
+constexpr LogTypeMask log_type_bit(std::size_t index) {
+    return LogTypeMask{ 1 } << index;
+}
+
+constexpr LogTypeMask all_log_types =
+    log_type_names.size() == 64 ? ~LogTypeMask{ 0 } : log_type_bit(log_type_names.size()) - 1;
+
+// Parses "Device,Op", "All,-MetalTrace,-Verif" or "-Verif" into the set of enabled types. Entries are
+// exact type names or All, optionally negated, applied left to right. A list that starts with an
+// exclusion starts from every type, any other list from Always alone, which stays on unless excluded.
+// Unknown names are skipped after calling on_error(const char * problem, std::string_view entry).
+template <typename OnError> constexpr LogTypeMask parse_log_type_mask(std::string_view spec, OnError && on_error) {
+    LogTypeMask mask  = 0;
+    bool        first = true;
+    for_each_list_entry(spec, [&](std::string_view entry) {
+        const bool             negate = entry.front() == '-';
+        const std::string_view name   = trim(negate ? entry.substr(1) : entry);
+        if (first) {
+            mask  = negate ? all_log_types : log_type_bit(static_cast<std::size_t>(LogAlways));
+            first = false;
+        }
+
+        LogTypeMask bits = all_log_types;
+        if (name != "All") {
+            const int type = log_type_from_name(name);
+            if (type < 0) {
+                on_error("unknown LogType", entry);
+                return;
+            }
+            bits = log_type_bit(static_cast<std::size_t>(type));
+        }
+        mask = negate ? (mask & ~bits) : (mask | bits);
+    });
+    return first ? all_log_types : mask;
+}
+
+using LogTypeRates = std::array<std::uint32_t, log_type_names.size()>;
+
+// Parses "1000,Fabric:100" into a maximum number of messages per second per LogType, with 0 for no limit.
+// A bare number applies to every type without an entry of its own. Invalid entries are skipped after
+// calling on_error(const char * problem, std::string_view entry).
+template <typename OnError> LogTypeRates parse_log_type_rates(std::string_view spec, OnError && on_error) {
+    const auto parse_rate = [](std::string_view text) -> long long {
+        if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string_view::npos) {
+            return -1;
+        }
+        long long value = 0;
+        for (const char digit : text) {
+            value = value * 10 + (digit - '0');
+        }
+        return value;
+    };
+
+    LogTypeRates rates{};
+    for_each_list_entry(spec, [&](std::string_view entry) {
+        if (entry.find_first_of(":=") == std::string_view::npos) {
+            const long long rate = parse_rate(entry);
+            if (rate < 0) {
+                on_error("invalid rate", entry);
+                return;
+            }
+            rates.fill(static_cast<std::uint32_t>(rate));
+        }
+    });
+    for_each_list_entry(spec, [&](std::string_view entry) {
+        const std::size_t separator = entry.find_first_of(":=");
+        if (separator == std::string_view::npos) {
+            return;
+        }
+        const int       type = log_type_from_name(trim(entry.substr(0, separator)));
+        const long long rate = parse_rate(trim(entry.substr(separator + 1)));
+        if (type < 0) {
+            on_error("unknown LogType", entry);
+        } else if (rate < 0) {
+            on_error("invalid rate", entry);
+        } else {
+            rates[static_cast<std::size_t>(type)] = static_cast<std::uint32_t>(rate);
+        }
+    });
+    return rates;
+}
+
+using LogTypeFiles = std::array<std::string_view, log_type_names.size()>;
+
+// Parses TT_LOGGER_FILE_PER_TYPE, "1" or "Device:io,SiliconDriver:io,Op:ops", into the name that replaces
+// {type} in the file of each LogType. Types given the same group name share a file; every other type gets
+// a file named after itself. Invalid entries are skipped after calling on_error(const char * problem,
+// std::string_view entry).
+template <typename OnError> LogTypeFiles parse_log_type_files(std::string_view spec, OnError && on_error) {
+    LogTypeFiles files{};
+    for (std::size_t index = 0; index < files.size(); ++index) {
+        files[index] = log_type_names[index];
+    }
+    for_each_list_entry(spec, [&](std::string_view entry) {
+        const std::size_t separator = entry.find_first_of(":=");
+        if (separator == std::string_view::npos) {
+            if (entry != "1") {
+                on_error("expected 1 or Type:group", entry);
+            }
+            return;
+        }
+        const int              type  = log_type_from_name(trim(entry.substr(0, separator)));
+        const std::string_view group = trim(entry.substr(separator + 1));
+        if (type < 0) {
+            on_error("unknown LogType", entry);
+        } else if (group.empty() || group.find_first_of("/{}") != std::string_view::npos) {
+            on_error("invalid group name", entry);
+        } else {
+            files[static_cast<std::size_t>(type)] = group;
+        }
+    });
+    return files;
+}
+
+// Message count of one LogType in the current one-second window of its rate limit
+struct alignas(cache_line_size) RateWindow {
+    std::atomic<std::int64_t>  start_ns{ 0 };
+    std::atomic<std::uint32_t> count{ 0 };
+    std::atomic<std::uint32_t> dropped{ 0 };
+
+    // Whether one more message fits in the window. The thread that opens a new window gets the number of
+    // messages dropped in the previous one in `reported`.
+    bool admit(std::uint32_t limit, std::int64_t now_ns, std::uint32_t & reported) noexcept {
+        std::int64_t start = start_ns.load(std::memory_order_relaxed);
+        if (now_ns - start >= 1'000'000'000 && start_ns.compare_exchange_strong(start, now_ns)) {
+            count.store(0, std::memory_order_relaxed);
+            reported = dropped.exchange(0, std::memory_order_relaxed);
+        }
+        if (count.fetch_add(1, std::memory_order_relaxed) < limit) {
+            return true;
+        }
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+};
+
+// Calls of one log_*_every_n, log_*_first_n or log_*_every_ms expansion. Each check costs one atomic increment,
+// plus a clock read for every_ms, and returns `suppressed` to drop the message or else the number of calls
+// dropped since the last message that got through.
+struct SiteThrottle {
+    static constexpr std::uint64_t suppressed = ~std::uint64_t{ 0 };
+
+    std::atomic<std::uint64_t> calls{ 0 };
+    std::atomic<std::uint64_t> emitted_at{ 0 };  // Calls up to the last message that got through, for every_ms
+    std::atomic<std::int64_t>  next_ns{ 0 };     // Earliest steady clock time of the next message, for every_ms
+
+    // The first call and every n-th one after it
+    std::uint64_t every_n(std::uint64_t n) noexcept {
+        const std::uint64_t call = calls.fetch_add(1, std::memory_order_relaxed);
+        if (n <= 1) {
+            return 0;
+        }
+        return call % n != 0 ? suppressed : call == 0 ? 0 : n - 1;
+    }
+
+    // The first n calls
+    std::uint64_t first_n(std::uint64_t n) noexcept {
+        return calls.fetch_add(1, std::memory_order_relaxed) < n ? 0 : suppressed;
+    }
+
+    // The first call and then at most one per interval of ms milliseconds
+    std::uint64_t every_ms(std::uint64_t ms) noexcept {
+        const std::uint64_t call = calls.fetch_add(1, std::memory_order_relaxed) + 1;
+        const std::int64_t  now_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        std::int64_t next = next_ns.load(std::memory_order_relaxed);
+        if (now_ns < next || !next_ns.compare_exchange_strong(next, now_ns + static_cast<std::int64_t>(ms) * 1'000'000,
+                                                              std::memory_order_relaxed)) {
+            return suppressed;
+        }
+        const std::uint64_t previous = emitted_at.exchange(call, std::memory_order_relaxed);
+        return previous < call ? call - previous - 1 : 0;
+    }
+};
+
+// Next value of the calling thread's xorshift64* generator, which decides what trace and debug messages are
+// sampled. Seeded from the thread's own address and the clock on first use.
+inline std::uint64_t sample_random() noexcept {
+    thread_local std::uint64_t state = 0;
+    if (state == 0) {
+        state = (reinterpret_cast<std::uintptr_t>(&state) * 0x9e3779b97f4a7c15ull) ^
+                static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        state |= 1;
+    }
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dull;
+}
+
+// Invalid entries in a compile-time level list stop compilation
+constexpr auto reject_entry = [](const char * problem, std::string_view) { throw std::invalid_argument(problem); };
+
+// Per-type compile-time minimum levels. One definition for the whole program: TT_LOGGER_COMPILED_LEVELS must
+// be the same in every translation unit that includes this header.
+#ifdef TT_LOGGER_COMPILED_LEVELS
+inline constexpr LogTypeLevels compiled_levels =
+    parse_log_type_levels(TT_LOGGER_COMPILED_LEVELS, SPDLOG_ACTIVE_LEVEL, reject_entry);
+#else
+inline constexpr LogTypeLevels compiled_levels = parse_log_type_levels("", SPDLOG_ACTIVE_LEVEL, reject_entry);
+#endif
+
+// Runtime minimum level of every LogType, mirrored from the loggers by the LoggerRegistry so that the
+// log_* macros can reject a message with one relaxed load before touching the registry. Starts at trace,
+// which lets the first log call through to construct the registry and fill in the real levels. The table
+// fills its own page so that a job-wide shared segment can be mapped in its place, see tt-logger-shm.hpp.
+using LogTypeLevelTable = LevelPage<log_type_names.size()>;
+
+inline TT_LOGGER_CONSTINIT LogTypeLevelTable log_type_levels{};
+
+}  // namespace detail
+
+// Whether log calls of this type and level are compiled in. Folds to a constant when type is one.
+inline constexpr bool is_compiled_in(LogType type, spdlog::level::level_enum level) noexcept {
+    return static_cast<std::size_t>(type) >= detail::compiled_levels.size() ||
+           static_cast<int>(level) >= detail::compiled_levels[static_cast<std::size_t>(type)];
+}
+
+// Whether the current runtime level of type lets level through
+inline bool should_log(LogType type, spdlog::level::level_enum level) noexcept {
+    return static_cast<int>(level) >=
+           detail::log_type_levels.levels[static_cast<std::size_t>(type)].load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Static descriptor of one log_* macro expansion
+ *
+ * Every expansion owns a constant-initialized CallSite, so the descriptor costs nothing until the site
+ * first emits a message. At that point the LoggerRegistry fills in the LogType, function name and
+ * format string and assigns the next dense ID, which stays fixed for the life of the process.
+ */
+struct alignas(detail::cache_line_size) CallSite {
+    static constexpr std::uint32_t unregistered = 0xffffffffu;
+
+    // Values of `state`
+    static constexpr std::uint8_t disabled = 0;  // Never written
+    static constexpr std::uint8_t by_level = 1;  // Written when the level of its type lets it through
+    static constexpr std::uint8_t forced   = 2;  // Written whatever the level of its type
+
+    constexpr CallSite(const char * file, int line, spdlog::level::level_enum level) :
+        file(file), line(line), level(level) {}
+
+    CallSite(const CallSite &)             = delete;
+    CallSite & operator=(const CallSite &) = delete;
+
+    const char *              file;
+    int                       line;
+    spdlog::level::level_enum level;
+
+    // Set by the rules of LoggerRegistry::set_site_rules() and read by every call of the site, which is why the
+    // whole descriptor is one cache line
+    mutable std::atomic<std::uint8_t> state{ by_level };
+
+    // Valid once id is no longer unregistered
+    std::atomic<std::uint32_t> id{ unregistered };
+    LogType                    type     = LogAlways;
+    const char *               function = "";
+    const char *               format   = "";  // Format string, or the message text for log calls without arguments
+
+    spdlog::source_loc loc(const char * caller) const { return spdlog::source_loc{ file, line, caller }; }
+};
+
+namespace detail {
+
+// Whether text matches pattern, where * stands for any run of characters and ? for any one character
+constexpr bool glob_match(std::string_view pattern, std::string_view text) {
+    std::size_t p = 0, t = 0;
+    std::size_t star = std::string_view::npos, star_text = 0;  // Last * seen and where its match ends for now
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+            ++p, ++t;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star      = p++;
+            star_text = t;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            t = ++star_text;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+// One rule of TT_LOGGER_SITES: the call sites it selects, empty patterns selecting all, and their new state
+struct SiteRule {
+    std::string  file;      // Full path or base name
+    std::string  function;
+    std::string  format;
+    int          first_line = 0;
+    int          last_line  = std::numeric_limits<int>::max();
+    int          type       = -1;  // Every type when negative
+    std::uint8_t state      = CallSite::by_level;
+
+    bool matches(const CallSite & site) const {
+        const std::string_view path(site.file);
+        const std::string_view base = path.substr(path.find_last_of('/') + 1);
+        return site.line >= first_line && site.line <= last_line &&
+               (type < 0 || type == static_cast<int>(site.type)) &&
+               (file.empty() || glob_match(file, path) || glob_match(file, base)) &&
+               (function.empty() || glob_match(function, site.function)) &&
+               (format.empty() || glob_match(format, site.format));
+    }
+};
+
+// Parses rules such as "type Dispatch file dispatch.cpp line 100-200 +; func *poll* -; format 'Retry*' =",
+// separated by ';' or new lines. A rule selects the sites that match all of its "file", "line", "func", "format"
+// and "type" keywords and ends with + to force them on, - to switch them off or = to leave them to their level.
+// A + rule needs a "type". Values with spaces are quoted. Invalid rules are skipped after calling
+// on_error(const char * problem, std::string_view rule).
+template <typename OnError> std::vector<SiteRule> parse_site_rules(std::string_view spec, OnError && on_error) {
+    const auto parse_line = [](std::string_view text) -> int {
+        if (text.empty() || text.size() > 9 || text.find_first_not_of("0123456789") != std::string_view::npos) {
+            return -1;
+        }
+        int value = 0;
+        for (const char digit : text) {
+            value = value * 10 + (digit - '0');
+        }
+        return value;
+    };
+
+    std::vector<SiteRule> rules;
+    std::size_t           index = 0;
+    while (index < spec.size()) {
+        std::vector<std::string> words;
+        std::string              word;
+        bool                     in_word = false;
+        char                     quote   = 0;
+        const std::size_t        start   = index;
+        for (; index < spec.size(); ++index) {
+            const char c = spec[index];
+            if (quote) {
+                if (c == quote) {
+                    quote = 0;
+                } else {
+                    word += c;
+                }
+            } else if (c == ';' || c == '\n') {
+                break;
+            } else if (c == '"' || c == '\'') {
+                quote   = c;
+                in_word = true;
+            } else if (c == ' ' || c == '\t' || c == '\r') {
+                if (in_word) {
+                    words.push_back(std::move(word));
+                    word.clear();
+                    in_word = false;
+                }
+            } else {
+                word += c;
+                in_word = true;
+            }
+        }
+        if (in_word) {
+            words.push_back(std::move(word));
+        }
+        const std::string_view rule = trim(spec.substr(start, index - start));
+        ++index;
+        if (words.empty()) {
+            continue;
+        }
+        if (quote) {
+            on_error("unterminated quote in rule", rule);
+            continue;
+        }
+
+        SiteRule               parsed;
+        const std::string_view flag = words.back();
+        if (flag == "+") {
+            parsed.state = CallSite::forced;
+        } else if (flag == "-") {
+            parsed.state = CallSite::disabled;
+        } else if (flag != "=") {
+            on_error("rule not ending in +, - or =", rule);
+            continue;
+        }
+        if (words.size() % 2 == 0) {
+            on_error("keyword without a value in rule", rule);
+            continue;
+        }
+        const char * problem = nullptr;
+        for (std::size_t word_index = 0; word_index + 1 < words.size() && !problem; word_index += 2) {
+            const std::string_view keyword = words[word_index];
+            std::string &          value   = words[word_index + 1];
+            if (keyword == "file") {
+                parsed.file = std::move(value);
+            } else if (keyword == "func") {
+                parsed.function = std::move(value);
+            } else if (keyword == "format") {
+                parsed.format = std::move(value);
+            } else if (keyword == "type") {
+                parsed.type = log_type_from_name(value);
+                problem     = parsed.type < 0 ? "unknown LogType in rule" : nullptr;
+            } else if (keyword == "line") {
+                const std::string_view range = value;
+                const std::size_t      dash  = range.find('-');
+                parsed.first_line            = parse_line(range.substr(0, dash));
+                parsed.last_line             = dash == std::string_view::npos ? parsed.first_line
+                                                                              : parse_line(range.substr(dash + 1));
+                if (parsed.first_line < 0 || parsed.last_line < parsed.first_line) {
+                    problem = "invalid line range in rule";
+                }
+            } else {
+                problem = "unknown keyword in rule";
+            }
+        }
+        // Sites register when they first log, so one below the level of its type is only known to a rule that
+        // names the type
+        if (!problem && parsed.state == CallSite::forced && parsed.type < 0) {
+            problem = "+ without a type in rule";
+        }
+        if (problem) {
+            on_error(problem, rule);
+            continue;
+        }
+        rules.push_back(std::move(parsed));
+    }
+    return rules;
+}
+
+}  // namespace detail
+
+// Output patterns of the text sinks, shared with tt-logger-decode
+inline constexpr const char * plain_pattern =
+    "%Y-%m-%d %H:%M:%S.%e | "  // Timestamp
+    "%-8l | "                  // Log level, left-aligned, 8 chars wide
+    "%15n | "                  // Logger name, right-aligned, 15 chars wide
+    "%v "                      // Message
+    "(%s:%#)";                 // Source location
+
+inline constexpr const char * colored_pattern =
+    "\033[90m%Y-%m-%d %H:%M:%S.%e\033[0m | "  // Dark gray timestamp, plain separator
+    "%^%-8l%$ | "                             // Auto-colored log level, plain separator
+    "\033[35m%15n\033[0m | "                  // Purple logger name, plain separator
+    "\033[37m%v\033[0m "                      // White message
+    "\033[90m(%s:%#)\033[0m";                 // Dark gray source location
+
+// Log files with this extension are written in the compact binary format, see tt-logger-binary.hpp
+inline constexpr std::string_view binary_log_extension = ".ttlog";
+
+class LoggerRegistry {
+  private:
+    std::array<std::shared_ptr<spdlog::logger>, log_type_names.size()> loggers;
+
+    // Sink that performs the actual I/O, the async wrapper in front of it when async mode is on, and the stage
+    // in front of both that folds repeated messages when TT_LOGGER_DEDUP is on
+    std::shared_ptr<spdlog::sinks::sink> sink;
+    std::shared_ptr<AsyncSink>           async_sink;
+    std::shared_ptr<DuplicateFilterSink> duplicate_filter;
+
+    // Backend thread that formats records in deferred mode, writing straight to `sink`
+    std::unique_ptr<DeferredBackend> deferred;
+
+    // Configured level of every type, and the types that are switched on. A logger runs at its configured
+    // level when its type is enabled and at off otherwise.
+    std::mutex            levels_mutex;
+    detail::LogTypeLevels levels{};
+    detail::LogTypeMask   enabled_types = detail::all_log_types;
+
+    // Call sites that have emitted at least one message, indexed by CallSite::id, and the rules that set their
+    // state, the last matching rule winning
+    mutable std::mutex            call_sites_mutex;
+    std::vector<const CallSite *> call_sites;
+    std::deque<std::string>       call_site_formats;  // Owns the strings CallSite::format points to
+    std::vector<detail::SiteRule> site_rules;
+
+    // Level from which each type is kept in the flight recorder, and in its backtrace while below the output
+    // level; off for every type while these are not enabled. Trace for the types a rule forces sites of on,
+    // so that their calls reach the site's state. The table checked by the log_* macros holds the lowest of
+    // the output, recorder, backtrace and site levels of every type.
+    std::array<std::atomic<std::uint8_t>, log_type_names.size()> recorder_levels;
+    std::array<std::atomic<std::uint8_t>, log_type_names.size()> backtrace_levels;
+    std::array<std::atomic<std::uint8_t>, log_type_names.size()> site_levels;
+    std::array<spdlog::details::backtracer, log_type_names.size()> backtraces;
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+    std::atomic<FlightRecorder *> recorder{ nullptr };
+    std::string                   recorder_path;  // Written on fatal signals
+#endif
+
+#if TT_LOGGER_HAS_CONTROL_SOCKET
+    // Listener for tt-logger-ctl commands
+    std::unique_ptr<ControlServer> control;
+#endif
+
+    // Whether detail::log_type_levels is mapped from a job-wide shared segment. The segment is then the only
+    // level check: loggers run at trace and the registry's own level changes wait for detach_shared_levels().
+    bool shared_levels         = false;
+    bool warned_lowered_levels = false;  // warn_lowered_levels() has written its warning
+
+    // Settings of the TT_LOGGER_CONFIG file, read by setting() before the environment. A snapshot is never
+    // changed once published: a reload publishes a new one. Log calls read the current snapshot without a
+    // lock, so replaced snapshots are kept until exit rather than freed while a call may still use them.
+    struct ConfigSnapshot {
+        ConfigValues         values;
+        detail::LogTypeRates rate_limits{};
+    };
+    std::atomic<const ConfigSnapshot *>                    config{ nullptr };
+    std::mutex                                             config_mutex;  // Serializes reloads
+    std::vector<std::unique_ptr<const ConfigSnapshot>>     config_snapshots;
+    std::string                                            config_path;
+    std::array<detail::RateWindow, log_type_names.size()> rate_windows;
+
+    // Trace and debug messages of every type are sampled 1 in N, the type's entry; 0 and 1 write them all
+    std::array<std::atomic<std::uint32_t>, log_type_names.size()> sample_rates{};
+#if TT_LOGGER_HAS_CONFIG_WATCH
+    std::unique_ptr<ConfigWatcher> config_watcher;
+#endif
+
+    // Pattern of `sink` when the configuration does not set one
+    const char * default_pattern = plain_pattern;
+
+    LoggerRegistry() {
+        for (std::size_t index = 0; index < log_type_names.size(); ++index) {
+            recorder_levels[index].store(SPDLOG_LEVEL_OFF, std::memory_order_relaxed);
+            backtrace_levels[index].store(SPDLOG_LEVEL_OFF, std::memory_order_relaxed);
+            site_levels[index].store(SPDLOG_LEVEL_OFF, std::memory_order_relaxed);
+        }
+        if (const char * path = std::getenv("TT_LOGGER_CONFIG"); path && *path) {
+            config_path = path;
+        }
+        try {
+            publish_config(read_config_file());
+        } catch (const std::runtime_error & error) {
+            std::fprintf(stderr, "%s; using the environment only\n", error.what());
+            publish_config({});
+        }
+
+        levels        = get_log_levels();
+        enabled_types = get_enabled_types();
+
+        sink = create_sink();
+        if (const char * pattern = setting("TT_LOGGER_PATTERN")) {
+            sink->set_pattern(pattern);
+        }
+
+        // Initialize loggers for each LogType
+        for (std::size_t index = 0; index < loggers.size(); ++index) {
+            loggers[index] = std::make_shared<spdlog::logger>(log_type_names[index], sink);
+            loggers[index]->flush_on(spdlog::level::critical);
+        }
+
+        if (env_flag("TT_LOGGER_DEDUP")) {
+            duplicate_filter = std::make_shared<DuplicateFilterSink>(sink, get_dedup_timeout());
+            set_active_sink(sink);
+            register_exit_handler();
+        }
+        apply_levels();
+
+        if (const char * sites = setting("TT_LOGGER_SITES"); sites && *sites) {
+            store_site_rules(parse_sites(sites, "TT_LOGGER_SITES"));
+        }
+        if (const char * backtrace = setting("TT_LOGGER_BACKTRACE");
+            backtrace && *backtrace && std::strcmp(backtrace, "0") != 0) {
+            enable_backtrace(env_flag("TT_LOGGER_BACKTRACE") ? "debug" : backtrace,
+                             env_size("TT_LOGGER_BACKTRACE_SIZE", default_backtrace_size));
+        }
+        if (env_flag("TT_LOGGER_ASYNC")) {
+            enable_async(env_size("TT_LOGGER_ASYNC_QUEUE_SIZE", AsyncSink::default_queue_size),
+                         get_async_overflow_policy());
+        }
+        if (env_flag("TT_LOGGER_DEFERRED")) {
+            enable_deferred(env_size("TT_LOGGER_DEFERRED_BUFFER_SIZE", DeferredBackend::default_buffer_size),
+                            get_async_overflow_policy(), get_timestamp_source());
+        }
+#if TT_LOGGER_HAS_SHARED_LEVELS
+        if (const char * job_id = std::getenv("TT_LOGGER_SHARED_LEVELS"); job_id && *job_id) {
+            try {
+                attach_shared_levels(job_id);
+            } catch (const std::runtime_error & error) {
+                std::fprintf(stderr, "%s\n", error.what());
+            }
+        }
+#endif
+#if TT_LOGGER_HAS_CONTROL_SOCKET
+        if (const char * socket_path = std::getenv("TT_LOGGER_CONTROL_SOCKET"); socket_path && *socket_path) {
+            try {
+                enable_control(env_flag("TT_LOGGER_CONTROL_SOCKET") ? default_control_socket_path(::getpid())
+                                                                     : socket_path);
+            } catch (const std::runtime_error & error) {
+                std::fprintf(stderr, "%s\n", error.what());
+            }
+        }
+#endif
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+        if (const char * recorded = setting("TT_LOGGER_FLIGHT_RECORDER");
+            recorded && *recorded && std::strcmp(recorded, "0") != 0) {
+            const char * dump_path = setting("TT_LOGGER_FLIGHT_RECORDER_FILE");
+            enable_flight_recorder(env_flag("TT_LOGGER_FLIGHT_RECORDER") ? "debug" : recorded,
+                                   dump_path ? dump_path : default_flight_recorder_path, get_recorder_ring_size());
+        }
+#endif
+#if TT_LOGGER_HAS_CONFIG_WATCH
+        if (!config_path.empty()) {
+            watch_config();
+        }
+#endif
+    }
+
+    LoggerRegistry(const LoggerRegistry &)             = delete;
+    LoggerRegistry & operator=(const LoggerRegistry &) = delete;
+
+    // TT_LOGGER_LEVEL holds a global level, per-type levels, or both: "debug", "Device:debug,Op:trace" or
+    // "warning,Dispatch:trace". Types without an entry get the global level, which defaults to info.
+    detail::LogTypeLevels get_log_levels() const {
+        const char * env_level = setting("TT_LOGGER_LEVEL", "TT_METAL_LOGGER_LEVEL");
+        return parse_levels(env_level ? env_level : "", SPDLOG_LEVEL_INFO, "TT_LOGGER_LEVEL");
+    }
+
+    // Parses a level list, warning about invalid entries on stderr
+    static detail::LogTypeLevels parse_levels(std::string_view spec, int default_level, const char * source) {
+        return detail::parse_log_type_levels(spec, default_level, [&](const char * problem, std::string_view entry) {
+            std::fprintf(stderr, "tt-logger: ignoring %s '%.*s' in %s\n", problem, static_cast<int>(entry.size()),
+                         entry.data(), source);
+        });
+    }
+
+    // Value of a setting: from the configuration file if it sets the key (the variable name without the
+    // TT_LOGGER_ prefix, in lower case), else from the environment variable itself or its legacy name
+    const char * setting(const char * env_name, const char * legacy_env_name = nullptr) const {
+        const ConfigSnapshot * snapshot = config.load(std::memory_order_acquire);
+        return setting(snapshot ? &snapshot->values : nullptr, env_name, legacy_env_name);
+    }
+
+    static const char * setting(const ConfigValues * values, const char * env_name, const char * legacy_env_name) {
+        if (values) {
+            std::string key(env_name + std::strlen("TT_LOGGER_"));
+            std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+            if (const auto value = values->find(key); value != values->end()) {
+                return value->second.c_str();
+            }
+        }
+        const char * value = std::getenv(env_name);
+        return value || !legacy_env_name ? value : std::getenv(legacy_env_name);
+    }
+
+    bool env_flag(const char * name) const {
+        const char * value = setting(name);
+        if (!value) {
+            return false;
+        }
+        std::string value_str = value;
+        std::transform(value_str.begin(), value_str.end(), value_str.begin(), ::tolower);
+        return value_str == "1" || value_str == "true" || value_str == "on" || value_str == "yes";
+    }
+
+    std::size_t env_size(const char * name, std::size_t default_value) const {
+        const char * value = setting(name);
+        if (value) {
+            char *             end  = nullptr;
+            unsigned long long size = std::strtoull(value, &end, 10);
+            if (end != value && size > 0) {
+                return static_cast<std::size_t>(size);
+            }
+        }
+        return default_value;
+    }
+
+    AsyncOverflowPolicy get_async_overflow_policy() const {
+        const char * env_policy = setting("TT_LOGGER_ASYNC_OVERFLOW");
+        if (env_policy && std::string(env_policy) == "drop") {
+            return AsyncOverflowPolicy::drop;
+        }
+        return AsyncOverflowPolicy::block;
+    }
+
+    // TT_LOGGER_ROTATE_SIZE ("512M") and TT_LOGGER_ROTATE_INTERVAL ("1h") of the rotating file sink
+    RotationPolicy get_rotation_policy() const {
+        RotationPolicy policy;
+        if (const char * size = setting("TT_LOGGER_ROTATE_SIZE")) {
+            if (const auto bytes = detail::parse_byte_size(size)) {
+                policy.max_size = *bytes;
+            } else {
+                std::fprintf(stderr, "tt-logger: ignoring invalid TT_LOGGER_ROTATE_SIZE '%s'\n", size);
+            }
+        }
+        if (const char * interval = setting("TT_LOGGER_ROTATE_INTERVAL")) {
+            if (const auto seconds = detail::parse_interval(interval)) {
+                policy.interval = *seconds;
+            } else {
+                std::fprintf(stderr, "tt-logger: ignoring invalid TT_LOGGER_ROTATE_INTERVAL '%s'\n", interval);
+            }
+        }
+        return policy;
+    }
+
+    // TT_LOGGER_DEDUP_TIMEOUT ("30s"), after which a run of repeated messages is summarized even if it goes on
+    std::chrono::milliseconds get_dedup_timeout() const {
+        if (const char * timeout = setting("TT_LOGGER_DEDUP_TIMEOUT")) {
+            if (const auto seconds = detail::parse_interval(timeout)) {
+                return *seconds;
+            }
+            std::fprintf(stderr, "tt-logger: ignoring invalid TT_LOGGER_DEDUP_TIMEOUT '%s'\n", timeout);
+        }
+        return DuplicateFilterSink::default_timeout;
+    }
+
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+    // TT_LOGGER_FLIGHT_RECORDER_SIZE ("256K"), the size of each thread's flight recorder ring
+    std::size_t get_recorder_ring_size() const {
+        if (const char * size = setting("TT_LOGGER_FLIGHT_RECORDER_SIZE")) {
+            if (const auto bytes = detail::parse_byte_size(size)) {
+                return static_cast<std::size_t>(*bytes);
+            }
+            std::fprintf(stderr, "tt-logger: ignoring invalid TT_LOGGER_FLIGHT_RECORDER_SIZE '%s'\n", size);
+        }
+        return FlightRecorder::default_ring_size;
+    }
+#endif
+
+    TimestampSource get_timestamp_source() const {
+        const char * env_source = setting("TT_LOGGER_TIMESTAMP");
+        if (env_source && std::string(env_source) == "tsc") {
+            return TimestampSource::tsc;
+        }
+        return TimestampSource::system_clock;
+    }
+
+    static void shutdown_at_exit() {
+#if TT_LOGGER_HAS_CONFIG_WATCH
+        instance().config_watcher.reset();
+#endif
+#if TT_LOGGER_HAS_CONTROL_SOCKET
+        instance().disable_control();
+#endif
+        // Other threads may still be logging, so the backends stay in place and only drain; what is logged
+        // after this is written on the calling thread
+        if (instance().deferred) {
+            instance().deferred->stop();
+        }
+        if (instance().async_sink) {
+            instance().async_sink->stop();
+        }
+        if (instance().duplicate_filter) {
+            instance().duplicate_filter->end_runs();
+        }
+        // The registry is never destroyed, so a sink that buffers whole blocks has to be flushed here
+        instance().sink->flush();
+    }
+
+    static void register_exit_handler() {
+        // Thread-safe, as files of a SplitSink are created from whichever thread logs first
+        static const bool registered = std::atexit(&LoggerRegistry::shutdown_at_exit) == 0;
+        (void) registered;
+    }
+
+    // Points the loggers at active_sink, through the duplicate filter when that is on
+    void set_active_sink(const std::shared_ptr<spdlog::sinks::sink> & active_sink) {
+        std::shared_ptr<spdlog::sinks::sink> front = active_sink;
+        if (duplicate_filter) {
+            duplicate_filter->set_inner(active_sink);
+            front = duplicate_filter;
+        }
+        for (auto & logger : loggers) {
+            logger->sinks().assign(1, front);
+        }
+    }
+
+    static bool has_extension(std::string_view path, std::string_view extension) {
+        return path.size() >= extension.size() && path.substr(path.size() - extension.size()) == extension;
+    }
+
+    static bool is_binary_log_path(std::string_view path) { return has_extension(path, binary_log_extension); }
+
+    // TT_LOGGER_FILE with {pid}, {tid}, {host}, {rank} and {time} filled in, or null when unset
+    std::optional<std::string> get_log_path() const {
+        const char * file_path = setting("TT_LOGGER_FILE", "TT_METAL_LOGGER_FILE");
+        if (!file_path) {
+            return std::nullopt;
+        }
+        return expand_log_path(file_path, LogPathFields::current(), [&](const char * problem, std::string_view name) {
+            std::fprintf(stderr, "tt-logger: keeping %s '%.*s' in TT_LOGGER_FILE '%s'\n", problem,
+                         static_cast<int>(name.size()), name.data(), file_path);
+        });
+    }
+
+    std::shared_ptr<spdlog::sinks::sink> create_sink() {
+        const auto   log_path  = get_log_path();
+        const char * file_path = log_path ? log_path->c_str() : nullptr;
+        const char * per_type  = setting("TT_LOGGER_FILE_PER_TYPE");
+        const bool   split     = file_path && strlen(file_path) > 0 &&
+                           ((per_type && strcmp(per_type, "0") != 0) ||
+                            std::string_view(file_path).find(type_placeholder) != std::string_view::npos);
+        if (split) {
+            return create_split_sink(file_path, per_type ? per_type : "");
+        }
+        return create_file_sink(file_path);
+    }
+
+    // One file per LogType or group of LogTypes, each created on its first message
+    std::shared_ptr<spdlog::sinks::sink> create_split_sink(const char * file_path, std::string_view per_type) {
+        const auto files = detail::parse_log_type_files(per_type, [](const char * problem, std::string_view entry) {
+            std::fprintf(stderr, "tt-logger: ignoring %s '%.*s' in TT_LOGGER_FILE_PER_TYPE\n", problem,
+                         static_cast<int>(entry.size()), entry.data());
+        });
+        std::vector<std::pair<std::string, std::string>> routes;
+        for (std::size_t index = 0; index < files.size(); ++index) {
+            routes.emplace_back(log_type_names[index], files[index]);
+        }
+        const std::string path_template = per_type_path_template(file_path);
+        const std::string default_file(files[LogAlways]);
+        register_exit_handler();
+        return std::make_shared<SplitSink>(routes, default_file, [this, path_template](const std::string & name) {
+            return create_file_sink(expand_type_placeholder(path_template, name).c_str());
+        });
+    }
+
+    // Sink for one log file chosen by its extension and the rotation settings, or stdout without a path
+    std::shared_ptr<spdlog::sinks::sink> create_file_sink(const char * file_path) {
+        const RotationPolicy policy   = get_rotation_policy();
+        const bool           rotating = policy.max_size > 0 || policy.interval.count() > 0;
+        std::string          plain_path;
+        if (file_path && has_extension(file_path, compressed_log_extension)) {
+#if TT_LOGGER_HAS_COMPRESSION
+            if (rotating) {
+                std::fprintf(stderr, "tt-logger: compressed log file '%s' is not rotated\n", file_path);
+            }
+            auto sink = std::make_shared<CompressedFileSink>(file_path);
+            sink->set_pattern(default_pattern);
+            register_exit_handler();
+            return sink;
+#else
+            plain_path.assign(file_path, strlen(file_path) - compressed_log_extension.size());
+            std::fprintf(stderr, "tt-logger: built without zlib, writing '%s' uncompressed to '%s'\n", file_path,
+                         plain_path.c_str());
+            file_path = plain_path.c_str();
+#endif
+        }
+        if (file_path && is_binary_log_path(file_path)) {
+            register_exit_handler();
+            return std::make_shared<BinarySink>(file_path);
+        } else if (file_path && strlen(file_path) > 0 && rotating) {
+            auto sink = std::make_shared<RotatingFileSink>(file_path, policy);
+            sink->set_pattern(default_pattern);
+            return sink;
+        } else if (file_path && strlen(file_path) > 0) {
+            auto sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(file_path, true);
+            if (!sink) {
+                std::fprintf(stderr, "tt-logger failed to create log file '%s'\n", file_path);
+                std::abort();
+            }
+
+            sink->set_pattern(default_pattern);
+            return sink;
+        } else {
+            auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+
+            // Check if output should be colored:
+            // 1. Traditional terminal detection
+            // 2. CI environments that support ANSI colors (GitHub Actions, etc.)
+            bool is_terminal = isatty(STDOUT_FILENO) != 0;
+            bool is_ci_with_colors = std::getenv("GITHUB_ACTIONS") != nullptr || std::getenv("CI") != nullptr ||
+                                     std::getenv("CONTINUOUS_INTEGRATION") != nullptr;
+
+            default_pattern = (is_terminal || is_ci_with_colors) ? colored_pattern : plain_pattern;
+            sink->set_pattern(default_pattern);
+
+            return sink;
+        }
+    }
+
+    // TT_LOGGER_TYPES selects the enabled types, see detail::parse_log_type_mask. Unset means all types.
+    detail::LogTypeMask get_enabled_types() const {
+        const char * types_env = setting("TT_LOGGER_TYPES", "TT_METAL_LOGGER_TYPES");
+        if (!types_env) {
+            return detail::all_log_types;
+        }
+
+        std::string unknown;
+        const auto  mask = detail::parse_log_type_mask(types_env, [&](const char *, std::string_view entry) {
+            unknown += unknown.empty() ? "'" : ", '";
+            unknown.append(entry.data(), entry.size());
+            unknown += "'";
+        });
+        if (!unknown.empty()) {
+            std::fprintf(stderr, "tt-logger: ignoring unknown log types %s in TT_LOGGER_TYPES\n", unknown.c_str());
+        }
+        return mask;
+    }
+
+    // Sets every logger to its effective level and mirrors it into the table checked by the log_* macros,
+    // lowered to the flight recorder, backtrace or site level where that is lower. Called with levels_mutex
+    // held, or from the constructor.
+    void apply_levels() {
+        if (shared_levels) {
+            warn_lowered_levels();
+            return;
+        }
+        const auto effective = effective_levels();
+        for (std::size_t index = 0; index < loggers.size(); ++index) {
+            loggers[index]->set_level(static_cast<spdlog::level::level_enum>(effective[index]));
+            const std::uint8_t recorded = std::min({ recorder_levels[index].load(std::memory_order_relaxed),
+                                                     backtrace_levels[index].load(std::memory_order_relaxed),
+                                                     site_levels[index].load(std::memory_order_relaxed) });
+            detail::log_type_levels.levels[index].store(std::min(effective[index], recorded),
+                                                        std::memory_order_relaxed);
+        }
+    }
+
+    // The shared segment is mapped read-only over the table the macros check, so calls that only the flight
+    // recorder, the backtrace or a "+" site rule would take are rejected there. Called with levels_mutex held.
+    void warn_lowered_levels() {
+        for (std::size_t index = 0; index < loggers.size() && !warned_lowered_levels; ++index) {
+            const std::uint8_t lowered = std::min({ recorder_levels[index].load(std::memory_order_relaxed),
+                                                    backtrace_levels[index].load(std::memory_order_relaxed),
+                                                    site_levels[index].load(std::memory_order_relaxed) });
+            if (lowered < detail::log_type_levels.levels[index].load(std::memory_order_relaxed)) {
+                std::fprintf(stderr, "tt-logger: shared levels are attached, so the flight recorder, backtrace "
+                                     "and '+' site rules only see messages at the job's levels\n");
+                warned_lowered_levels = true;
+            }
+        }
+    }
+
+    // Configured level of every enabled type, off for the others
+    std::array<std::uint8_t, log_type_names.size()> effective_levels() const {
+        std::array<std::uint8_t, log_type_names.size()> effective{};
+        for (std::size_t index = 0; index < effective.size(); ++index) {
+            const bool enabled = (enabled_types & detail::log_type_bit(index)) != 0;
+            effective[index]   = static_cast<std::uint8_t>(enabled ? levels[index] : SPDLOG_LEVEL_OFF);
+        }
+        return effective;
+    }
+
+    // Collects the types in a list such as "Fabric,Op" or "All"; unknown names are added to `unknown`
+    static detail::LogTypeMask parse_type_list(std::string_view list, std::string & unknown) {
+        detail::LogTypeMask mask = 0;
+        detail::for_each_list_entry(list, [&](std::string_view name) {
+            const int type = detail::log_type_from_name(name);
+            if (name == "All") {
+                mask = detail::all_log_types;
+            } else if (type >= 0) {
+                mask |= detail::log_type_bit(static_cast<std::size_t>(type));
+            } else {
+                unknown += unknown.empty() ? "'" : ", '";
+                unknown.append(name.data(), name.size());
+                unknown += "'";
+            }
+        });
+        return mask;
+    }
+
+    // Runs one control command. Each command is validated as a whole and applied under one lock, so a
+    // rejected command changes nothing and log calls never see half of one.
+    std::string handle_control_command(std::string_view line) {
+        line                            = detail::trim(line);
+        const std::size_t      space    = std::min(line.find(' '), line.size());
+        const std::string_view command  = line.substr(0, space);
+        const std::string_view argument = detail::trim(line.substr(space));
+
+        if (command == "set-level") {
+            std::string                 invalid;
+            const detail::LogTypeLevels parsed =
+                detail::parse_log_type_levels(argument, -1, [&](const char * problem, std::string_view entry) {
+                    invalid += invalid.empty() ? "" : ", ";
+                    invalid += problem;
+                    invalid += " '";
+                    invalid.append(entry.data(), entry.size());
+                    invalid += "'";
+                });
+            if (!invalid.empty()) {
+                return "error: " + invalid + "\n";
+            }
+            if (argument.empty()) {
+                return "error: set-level needs a level list\n";
+            }
+            std::lock_guard<std::mutex> lock(levels_mutex);
+            for (std::size_t index = 0; index < levels.size(); ++index) {
+                if (parsed[index] >= 0) {
+                    levels[index] = parsed[index];
+                }
+            }
+            apply_levels();
+        } else if (command == "enable-type" || command == "disable-type") {
+            std::string               unknown;
+            const detail::LogTypeMask mask = parse_type_list(argument, unknown);
+            if (!unknown.empty()) {
+                return "error: unknown log types " + unknown + "\n";
+            }
+            if (mask == 0) {
+                return "error: " + std::string(command) + " needs a list of log types\n";
+            }
+            std::lock_guard<std::mutex> lock(levels_mutex);
+            enabled_types = command == "enable-type" ? (enabled_types | mask) : (enabled_types & ~mask);
+            apply_levels();
+        } else if (command == "set-sampling") {
+            std::string                invalid;
+            const detail::LogTypeRates parsed =
+                detail::parse_log_type_rates(argument, [&](const char * problem, std::string_view entry) {
+                    invalid += invalid.empty() ? "" : ", ";
+                    invalid += problem;
+                    invalid += " '";
+                    invalid.append(entry.data(), entry.size());
+                    invalid += "'";
+                });
+            if (!invalid.empty()) {
+                return "error: " + invalid + "\n";
+            }
+            if (argument.empty()) {
+                return "error: set-sampling needs a list of rates\n";
+            }
+            std::lock_guard<std::mutex> lock(config_mutex);
+            store_sample_rates(parsed);
+        } else if (command == "set-sites") {
+            std::string invalid;
+            auto        parsed = detail::parse_site_rules(argument, [&](const char * problem, std::string_view rule) {
+                invalid += invalid.empty() ? "" : ", ";
+                invalid += problem;
+                invalid += " '";
+                invalid.append(rule.data(), rule.size());
+                invalid += "'";
+            });
+            if (!invalid.empty()) {
+                return "error: " + invalid + "\n";
+            }
+            if (parsed.empty()) {
+                return "error: set-sites needs a list of rules\n";
+            }
+            store_site_rules(std::move(parsed));
+        } else if (command == "list-sites") {
+            std::lock_guard<std::mutex> lock(call_sites_mutex);
+            std::string                 reply = "ok\n";
+            for (const CallSite * site : call_sites) {
+                const auto level = spdlog::level::to_string_view(site->level);
+                reply += fmt::format("{} {}:{} {} {} {} \"{}\"\n", "-=+"[site->state.load(std::memory_order_relaxed)],
+                                     site->file, site->line, site->function, log_type_names[site->type],
+                                     fmt::string_view(level.data(), level.size()), site->format);
+            }
+            return reply;
+        } else if (command == "flush") {
+            flush();
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+        } else if (command == "dump-recorder") {
+            if (!recorder.load(std::memory_order_acquire)) {
+                return "error: the flight recorder is not enabled\n";
+            }
+            const std::string path(argument);
+            if (!dump_flight_recorder(path)) {
+                return "error: cannot write " + (path.empty() ? recorder_path : path) + "\n";
+            }
+#endif
+        } else if (command == "status") {
+            std::lock_guard<std::mutex> lock(levels_mutex);
+            std::string                 reply = "ok\n";
+            if (shared_levels) {
+                reply += "Levels below are overridden by the job's shared levels\n";
+            }
+            for (std::size_t index = 0; index < levels.size(); ++index) {
+                const auto name = spdlog::level::to_string_view(static_cast<spdlog::level::level_enum>(levels[index]));
+                reply += fmt::format("{:<16} {}{}", log_type_names[index], fmt::string_view(name.data(), name.size()),
+                                     (enabled_types & detail::log_type_bit(index)) ? "" : " (disabled)");
+                if (const std::uint32_t rate = sample_rates[index].load(std::memory_order_relaxed); rate > 1) {
+                    reply += fmt::format(", trace and debug 1 in {}", rate);
+                }
+                reply += "\n";
+            }
+            return reply;
+        } else {
+            return "error: unknown command '" + std::string(command) +
+                   "', expected set-level, enable-type, disable-type, set-sampling, set-sites, list-sites, flush, "
+                   "dump-recorder or status\n";
+        }
+        return "ok\n";
+    }
+
+    // Reads config_path, warning about invalid lines. Empty settings when there is no file.
+    ConfigValues read_config_file() const {
+        if (config_path.empty()) {
+            return {};
+        }
+        return read_config(config_path, [&](const char * problem, std::string_view line) {
+            std::fprintf(stderr, "tt-logger: ignoring %s '%.*s' in %s\n", problem, static_cast<int>(line.size()),
+                         line.data(), config_path.c_str());
+        });
+    }
+
+    // Makes `values` the current settings. Called with config_mutex held, or from the constructor.
+    void publish_config(ConfigValues values) {
+        auto snapshot    = std::make_unique<ConfigSnapshot>();
+        snapshot->values = std::move(values);
+
+        const char * rate_limit = setting(&snapshot->values, "TT_LOGGER_RATE_LIMIT", nullptr);
+        snapshot->rate_limits   = detail::parse_log_type_rates(
+            rate_limit ? rate_limit : "", [&](const char * problem, std::string_view entry) {
+                std::fprintf(stderr, "tt-logger: ignoring %s '%.*s' in TT_LOGGER_RATE_LIMIT\n", problem,
+                             static_cast<int>(entry.size()), entry.data());
+            });
+
+        config.store(snapshot.get(), std::memory_order_release);
+        config_snapshots.push_back(std::move(snapshot));
+
+        const char * sample_rate = setting("TT_LOGGER_SAMPLE_RATE");
+        store_sample_rates(parse_rates(sample_rate ? sample_rate : "", "TT_LOGGER_SAMPLE_RATE"));
+    }
+
+    static detail::LogTypeRates parse_rates(std::string_view spec, const char * source) {
+        return detail::parse_log_type_rates(spec, [&](const char * problem, std::string_view entry) {
+            std::fprintf(stderr, "tt-logger: ignoring %s '%.*s' in %s\n", problem, static_cast<int>(entry.size()),
+                         entry.data(), source);
+        });
+    }
+
+    void store_sample_rates(const detail::LogTypeRates & rates) {
+        for (std::size_t index = 0; index < rates.size(); ++index) {
+            sample_rates[index].store(rates[index], std::memory_order_relaxed);
+        }
+    }
+
+    static std::vector<detail::SiteRule> parse_sites(std::string_view spec, const char * source) {
+        return detail::parse_site_rules(spec, [&](const char * problem, std::string_view rule) {
+            std::fprintf(stderr, "tt-logger: ignoring %s '%.*s' in %s\n", problem, static_cast<int>(rule.size()),
+                         rule.data(), source);
+        });
+    }
+
+    // State of a registered site under the current rules. Called with call_sites_mutex held.
+    std::uint8_t site_state(const CallSite & site) const {
+        std::uint8_t state = CallSite::by_level;
+        for (const detail::SiteRule & rule : site_rules) {
+            if (rule.matches(site)) {
+                state = rule.state;
+            }
+        }
+        return state;
+    }
+
+    // Lowest levels the macros must let through for the sites the rules force on. Every "+" rule has a type and
+    // covers sites of that type that have not logged yet, so the type goes to trace. Called with
+    // call_sites_mutex held.
+    std::array<std::uint8_t, log_type_names.size()> forced_levels() const {
+        std::array<std::uint8_t, log_type_names.size()> lowered;
+        lowered.fill(SPDLOG_LEVEL_OFF);
+        for (const detail::SiteRule & rule : site_rules) {
+            if (rule.state == CallSite::forced) {
+                lowered[static_cast<std::size_t>(rule.type)] = SPDLOG_LEVEL_TRACE;
+            }
+        }
+        return lowered;
+    }
 
-namespace tt {
+    // Replaces the site rules, sets the state of every registered site from them, and lowers the level table
+    // of the types they force sites of on
+    void store_site_rules(std::vector<detail::SiteRule> rules) {
+        std::lock_guard<std::mutex> lock(call_sites_mutex);
+        site_rules = std::move(rules);
+        for (const CallSite * site : call_sites) {
+            site->state.store(site_state(*site), std::memory_order_relaxed);
+        }
+        const auto                  lowered = forced_levels();
+        std::lock_guard<std::mutex> levels_lock(levels_mutex);  // Always taken after call_sites_mutex
+        for (std::size_t index = 0; index < site_levels.size(); ++index) {
+            site_levels[index].store(lowered[index], std::memory_order_relaxed);
+        }
+        apply_levels();
+    }
 
-enum LogType {
+    // Re-reads the configuration file and applies what can change at runtime: levels, types, the pattern, rate
+    // limits, sampling rates and site rules. Sinks and backends are only set up at startup; changes to them are
+    // reported instead.
+    void reload_config() {
+        std::lock_guard<std::mutex> config_lock(config_mutex);
+        const ConfigValues          previous = config.load(std::memory_order_relaxed)->values;
+        publish_config(read_config_file());
 
-#define X(name) Log##name,
-    TT_LOGGER_TYPES
-#undef X
-};
+        const ConfigValues & current  = config.load(std::memory_order_relaxed)->values;
+        const auto           value_of = [](const ConfigValues & values, const char * key) {
+            const auto value = values.find(key);
+            return value == values.end() ? std::optional<std::string>{} : value->second;
+        };
+        for (const char * key : { "file", "file_per_type", "rotate_size", "rotate_interval", "async",
+                                  "async_queue_size", "async_overflow", "deferred", "deferred_buffer_size",
+                                  "timestamp", "backtrace", "backtrace_size", "dedup", "dedup_timeout",
+                                  "flight_recorder", "flight_recorder_file", "flight_recorder_size" }) {
+            if (value_of(previous, key) != value_of(current, key)) {
+                std::fprintf(stderr, "tt-logger: '%s' changed in %s, restart to apply it\n", key,
+                             config_path.c_str());
+            }
+        }
 
-constexpr std::array<const char *, std::size_t(LogType::LogEmulationDriver) + 1> log_type_names = {
-#define X(name) #name,
-    TT_LOGGER_TYPES
-#undef X
-};
+        const char * pattern = setting("TT_LOGGER_PATTERN");
+        sink->set_pattern(pattern ? pattern : default_pattern);
 
-constexpr const char * logtype_to_string(LogType logtype) noexcept {
-    return static_cast<std::size_t>(logtype) < log_type_names.size() ?
-               log_type_names[static_cast<std::size_t>(logtype)] :
-               "UnknownType";
-}
+        const char * sites = setting("TT_LOGGER_SITES");
+        store_site_rules(parse_sites(sites ? sites : "", "TT_LOGGER_SITES"));
 
-class LoggerRegistry {
-  private:
-    std::array<std::shared_ptr<spdlog::logger>, log_type_names.size()> loggers;
+        std::lock_guard<std::mutex> levels_lock(levels_mutex);
+        levels        = get_log_levels();
+        enabled_types = get_enabled_types();
+        apply_levels();
+    }
 
-    LoggerRegistry() {
-        spdlog::level::level_enum default_level = get_default_log_level();
+#if TT_LOGGER_HAS_CONFIG_WATCH
+    void watch_config() {
+        try {
+            config_watcher = std::make_unique<ConfigWatcher>(config_path, [this] {
+                try {
+                    reload_config();
+                } catch (const std::runtime_error & error) {
+                    std::fprintf(stderr, "%s\n", error.what());
+                }
+            });
+            register_exit_handler();
+        } catch (const std::runtime_error & error) {
+            std::fprintf(stderr, "%s\n", error.what());
+        }
+    }
+#endif
+
+    // Whether a message of `type` fits in its rate limit. Messages dropped in the previous second are reported
+    // at the location of the first message of the next one.
+    bool within_rate_limit(LogType type, spdlog::logger & logger, spdlog::source_loc loc) {
+        const std::size_t   index = static_cast<std::size_t>(type);
+        const std::uint32_t limit = config.load(std::memory_order_acquire)->rate_limits[index];
+        if (limit == 0) {
+            return true;
+        }
+        const std::int64_t now_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        std::uint32_t dropped  = 0;
+        const bool    admitted = rate_windows[index].admit(limit, now_ns, dropped);
+        if (dropped > 0 && tt::should_log(type, spdlog::level::warn) && logger.should_log(spdlog::level::warn)) {
+            dispatch(logger, loc, spdlog::level::warn,
+                     "Dropped {} messages over the rate limit of {} per second", dropped, limit);
+        }
+        return admitted;
+    }
 
-        // Create sink using the static method
-        auto sink = create_sink();
+    void register_call_site(CallSite & site, LogType type, const char * function, std::string_view format) {
+        std::lock_guard<std::mutex> lock(call_sites_mutex);
+        if (site.id.load(std::memory_order_relaxed) != CallSite::unregistered) {
+            return;
+        }
+        site.type     = type;
+        site.function = function;
+        site.format   = call_site_formats.emplace_back(format).c_str();
+        site.state.store(site_state(site), std::memory_order_relaxed);
+        site.id.store(static_cast<std::uint32_t>(call_sites.size()), std::memory_order_release);
+        call_sites.push_back(&site);
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+        if (FlightRecorder * flight_recorder = recorder.load(std::memory_order_relaxed)) {
+            flight_recorder->add_call_site(site.id, site.file, site.line, site.function, site.format);
+        }
+#endif
+    }
 
-        // Initialize loggers for each LogType
-        std::size_t index = 0;
-#define X(name)                                                     \
-    loggers[index] = std::make_shared<spdlog::logger>(#name, sink); \
-    loggers[index].get()->set_level(default_level);                 \
-    loggers[index++].get()->flush_on(spdlog::level::critical);
-        TT_LOGGER_TYPES
-#undef X
+    // Keeps a message of a registered call site in the flight recorder if its type is recorded at that level
+    template <typename... Args>
+    void record(const CallSite & site, LogType type, fmt::string_view format, const Args &... args) {
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+        const std::size_t index = static_cast<std::size_t>(type);
+        if (static_cast<int>(site.level) < recorder_levels[index].load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (FlightRecorder * flight_recorder = recorder.load(std::memory_order_acquire)) {
+            flight_recorder->record(site.id.load(std::memory_order_relaxed), index, site.level, format, args...);
+        }
+#else
+        (void) site, (void) type, (void) format, ((void) args, ...);
+#endif
+    }
 
-        apply_log_type_filtering(default_level);
+    // Number of messages a trace or debug message stands for when it is written: 1 without sampling, the
+    // sampling rate when it is picked, and 0 when it is sampled out
+    std::uint32_t sample_weight(LogType type, spdlog::level::level_enum level) const {
+        if (level > spdlog::level::debug) {
+            return 1;
+        }
+        const std::uint32_t rate = sample_rates[static_cast<std::size_t>(type)].load(std::memory_order_relaxed);
+        if (rate <= 1) {
+            return 1;
+        }
+        return ((detail::sample_random() >> 32) * rate) >> 32 == 0 ? rate : 0;
     }
 
-    LoggerRegistry(const LoggerRegistry &)             = delete;
-    LoggerRegistry & operator=(const LoggerRegistry &) = delete;
+    // Formats a message into text, which gets the format string itself when the arguments do not fit it
+    template <typename... Args>
+    static void format_message(spdlog::memory_buf_t & text, fmt::string_view format, const Args &... args) {
+        try {
+            if constexpr (sizeof...(Args) == 0) {
+                text.append(format.data(), format.data() + format.size());
+            } else {
+                fmt::vformat_to(fmt::appender(text), format, fmt::make_format_args(args...));
+            }
+        } catch (const std::exception &) {
+            text.clear();
+            text.append(format.data(), format.data() + format.size());
+        }
+    }
 
-    static spdlog::level::level_enum get_default_log_level() {
-        const char * env_level = std::getenv("TT_LOGGER_LEVEL");
-        if (!env_level) {
-            env_level = std::getenv("TT_METAL_LOGGER_LEVEL");
+    static void vformat_message(spdlog::memory_buf_t & text, fmt::string_view format, fmt::format_args args) {
+        try {
+            fmt::vformat_to(fmt::appender(text), format, args);
+        } catch (const std::exception &) {
+            text.clear();
+            text.append(format.data(), format.data() + format.size());
         }
+    }
 
-        if (env_level) {
-            std::string level_str = env_level;
-            std::transform(level_str.begin(), level_str.end(), level_str.begin(), ::tolower);
+    // Writes a sampled message with its weight appended
+    template <typename... Args>
+    void dispatch_sampled(spdlog::logger & logger, spdlog::source_loc loc, spdlog::level::level_enum level,
+                          std::uint32_t weight, fmt::string_view format, const Args &... args) {
+        spdlog::memory_buf_t text;
+        format_message(text, format, args...);
+        fmt::format_to(fmt::appender(text), " [sample_weight={}]", weight);
+        dispatch(logger, loc, level, std::string_view(text.data(), text.size()));
+    }
 
-            if (level_str == "trace") {
-                return spdlog::level::trace;
-            }
-            if (level_str == "debug") {
-                return spdlog::level::debug;
-            }
-            if (level_str == "info") {
-                return spdlog::level::info;
-            }
-            if (level_str == "warn") {
-                return spdlog::level::warn;
+    template <typename T>
+    void dispatch_message_sampled(spdlog::logger & logger, spdlog::source_loc loc, spdlog::level::level_enum level,
+                                  std::uint32_t weight, const T & msg) {
+        if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+            const std::string_view text = msg;
+            dispatch_sampled(logger, loc, level, weight, fmt::string_view(text.data(), text.size()));
+        } else {
+            dispatch_sampled(logger, loc, level, weight, "{}", msg);
+        }
+    }
+
+    // Writes a message of a site forced on below the level of its logger, which would drop it
+    template <typename... Args>
+    void dispatch_forced(spdlog::logger & logger, spdlog::source_loc loc, spdlog::level::level_enum level,
+                         fmt::string_view format, const Args &... args) {
+        spdlog::memory_buf_t text;
+        format_message(text, format, args...);
+        if (deferred) {
+            deferred->log_formatted(logger, loc, level, fmt::string_view(text.data(), text.size()));
+        } else {
+            write_to_sinks(logger, spdlog::details::log_msg(loc, logger.name(), level,
+                                                            spdlog::string_view_t(text.data(), text.size())));
+        }
+    }
+
+    template <typename T>
+    void dispatch_message_forced(spdlog::logger & logger, spdlog::source_loc loc, spdlog::level::level_enum level,
+                                 const T & msg) {
+        if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+            const std::string_view text = msg;
+            dispatch_forced(logger, loc, level, fmt::string_view(text.data(), text.size()));
+        } else {
+            dispatch_forced(logger, loc, level, "{}", msg);
+        }
+    }
+
+    // Writes a message past the level check of the logger, to every sink that takes its level
+    static void write_to_sinks(spdlog::logger & logger, const spdlog::details::log_msg & msg) {
+        for (const auto & logger_sink : logger.sinks()) {
+            if (logger_sink->should_log(msg.level)) {
+                logger_sink->log(msg);
             }
-            if (level_str == "error") {
-                return spdlog::level::err;
+        }
+    }
+
+    // Keeps a message below the output level in the backtrace of its type if it is kept at that level
+    template <typename... Args>
+    void keep_for_backtrace(spdlog::logger & logger, LogType type, spdlog::source_loc loc,
+                            spdlog::level::level_enum level, fmt::string_view format, const Args &... args) {
+        const std::size_t index = static_cast<std::size_t>(type);
+        if (static_cast<int>(level) < backtrace_levels[index].load(std::memory_order_relaxed)) {
+            return;
+        }
+        spdlog::memory_buf_t text;
+        try {
+            if constexpr (sizeof...(Args) == 0) {
+                text.append(format.data(), format.data() + format.size());
+            } else {
+                fmt::vformat_to(fmt::appender(text), format, fmt::make_format_args(args...));
             }
-            if (level_str == "critical") {
-                return spdlog::level::critical;
+        } catch (const std::exception &) {
+            return;  // Reported by the output path if the level is ever lowered
+        }
+        backtraces[index].push_back(spdlog::details::log_msg(loc, logger.name(), level,
+                                                             spdlog::string_view_t(text.data(), text.size())));
+    }
+
+    template <typename T>
+    void keep_message_for_backtrace(spdlog::logger & logger, LogType type, spdlog::source_loc loc,
+                                    spdlog::level::level_enum level, const T & msg) {
+        if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+            const std::string_view text = msg;
+            keep_for_backtrace(logger, type, loc, level, fmt::string_view(text.data(), text.size()));
+        } else {
+            keep_for_backtrace(logger, type, loc, level, "{}", msg);
+        }
+    }
+
+    // Writes out the backtrace of a type before an error or critical message, between spdlog's usual markers
+    // that carry the location of that message
+    void write_backtrace(LogType type, spdlog::logger & logger, spdlog::source_loc loc,
+                         spdlog::level::level_enum level) {
+        spdlog::details::backtracer & backtrace = backtraces[static_cast<std::size_t>(type)];
+        if (level < spdlog::level::err || !backtrace.enabled()) {
+            return;
+        }
+        if (deferred) {
+            deferred->flush();  // Messages logged before the backtrace was kept come first
+        }
+        const auto write = [&](const spdlog::details::log_msg & msg) { write_to_sinks(logger, msg); };
+        bool started = false;
+        backtrace.foreach_pop([&](const spdlog::details::log_msg & msg) {
+            if (!started) {
+                write(spdlog::details::log_msg(loc, logger.name(), spdlog::level::info,
+                                               "****************** Backtrace Start ******************"));
+                started = true;
             }
-            if (level_str == "fatal") {
-                return spdlog::level::critical;
+            write(msg);
+        });
+        if (started) {
+            write(spdlog::details::log_msg(loc, logger.name(), spdlog::level::info,
+                                           "****************** Backtrace End ********************"));
+        }
+    }
+
+    void log_with_suppressed(CallSite & site, LogType type, const char * function, spdlog::memory_buf_t & text,
+                             std::uint64_t suppressed) {
+        fmt::format_to(fmt::appender(text), " ({} suppressed)", suppressed);
+        log(site, type, function, std::string_view(text.data(), text.size()));
+    }
+
+    template <typename T> void record_message(const CallSite & site, LogType type, const T & msg) {
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+        const std::size_t index = static_cast<std::size_t>(type);
+        if (static_cast<int>(site.level) < recorder_levels[index].load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (FlightRecorder * flight_recorder = recorder.load(std::memory_order_acquire)) {
+            const std::uint32_t id = site.id.load(std::memory_order_relaxed);
+            if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+                flight_recorder->record_text(id, index, site.level, msg);
+            } else {
+                flight_recorder->record(id, index, site.level, "{}", msg);
             }
-            if (level_str == "off") {
-                return spdlog::level::off;
+        }
+#else
+        (void) site, (void) type, (void) msg;
+#endif
+    }
+
+    template <typename... Args>
+    void dispatch(spdlog::logger & logger, spdlog::source_loc loc, spdlog::level::level_enum level,
+                  spdlog::format_string_t<Args...> fmt, Args &&... args) {
+        if (deferred) {
+            deferred->log(logger, loc, level, fmt, std::forward<Args>(args)...);
+        } else {
+            logger.log(loc, level, fmt, std::forward<Args>(args)...);
+        }
+    }
+
+    template <typename T>
+    void dispatch(spdlog::logger & logger, spdlog::source_loc loc, spdlog::level::level_enum level, const T & msg) {
+        if (deferred) {
+            deferred->log(logger, loc, level, "{}", msg);
+        } else {
+            logger.log(loc, level, msg);
+        }
+    }
+
+  public:
+    // Messages kept per type by enable_backtrace() when no size is given
+    static constexpr std::size_t default_backtrace_size = 32;
+
+    static LoggerRegistry & instance() {
+        static LoggerRegistry * registry = new LoggerRegistry();
+        return *registry;
+    }
+
+    // Change levels through set_level() rather than on the returned logger: the log_* macros check a copy
+    // of each level that only the registry updates
+    std::shared_ptr<spdlog::logger> get(LogType type) { return loggers[static_cast<std::size_t>(type)]; }
+
+    void set_level(spdlog::level::level_enum level) {
+        std::lock_guard<std::mutex> lock(levels_mutex);
+        levels.fill(static_cast<int>(level));
+        apply_levels();
+    }
+
+    void set_level(LogType type, spdlog::level::level_enum level) {
+        std::lock_guard<std::mutex> lock(levels_mutex);
+        levels[static_cast<std::size_t>(type)] = static_cast<int>(level);
+        apply_levels();
+    }
+
+    // Applies a level list in TT_LOGGER_LEVEL syntax. Types the list does not mention keep their level
+    // unless it contains a bare level.
+    void set_levels(std::string_view spec) {
+        const detail::LogTypeLevels parsed = parse_levels(spec, -1, "level list");
+        std::lock_guard<std::mutex> lock(levels_mutex);
+        for (std::size_t index = 0; index < levels.size(); ++index) {
+            if (parsed[index] >= 0) {
+                levels[index] = parsed[index];
             }
         }
-        return spdlog::level::info;
+        apply_levels();
     }
 
-    static std::shared_ptr<spdlog::sinks::sink> create_sink() {
-        // Define patterns once
-        std::string plain_pattern =
-            "%Y-%m-%d %H:%M:%S.%e | "  // Timestamp
-            "%-8l | "                  // Log level, left-aligned, 8 chars wide
-            "%15n | "                  // Logger name, right-aligned, 15 chars wide
-            "%v "                      // Message
-            "(%s:%#)";                 // Source location
+    // Switch a type on or off without losing its configured level
+    void enable_type(LogType type) {
+        std::lock_guard<std::mutex> lock(levels_mutex);
+        enabled_types |= detail::log_type_bit(static_cast<std::size_t>(type));
+        apply_levels();
+    }
 
-        std::string colored_pattern =
-            "\033[90m%Y-%m-%d %H:%M:%S.%e\033[0m | "  // Dark gray timestamp, plain separator
-            "%^%-8l%$ | "                             // Auto-colored log level, plain separator
-            "\033[35m%15n\033[0m | "                  // Purple logger name, plain separator
-            "\033[37m%v\033[0m "                      // White message
-            "\033[90m(%s:%#)\033[0m";                 // Dark gray source location
+    void disable_type(LogType type) {
+        std::lock_guard<std::mutex> lock(levels_mutex);
+        enabled_types &= ~detail::log_type_bit(static_cast<std::size_t>(type));
+        apply_levels();
+    }
 
-        const char * file_path = std::getenv("TT_LOGGER_FILE");
-        if (!file_path) {
-            file_path = std::getenv("TT_METAL_LOGGER_FILE");
+    bool is_type_enabled(LogType type) {
+        std::lock_guard<std::mutex> lock(levels_mutex);
+        return (enabled_types & detail::log_type_bit(static_cast<std::size_t>(type))) != 0;
+    }
+
+    // Route all loggers through an AsyncSink so log calls only enqueue the formatted record.
+    // Swapping sinks is not synchronized with in-flight log calls: call this during startup,
+    // before other threads log. Pending records are written out at exit.
+    void enable_async(std::size_t         queue_size = AsyncSink::default_queue_size,
+                      AsyncOverflowPolicy policy     = AsyncOverflowPolicy::block) {
+        if (async_sink) {
+            return;
         }
+        async_sink = std::make_shared<AsyncSink>(sink, queue_size, policy);
+        set_active_sink(async_sink);
+        register_exit_handler();
+    }
 
-        if (file_path && strlen(file_path) > 0) {
-            auto sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(file_path, true);
-            if (!sink) {
-                std::fprintf(stderr, "tt-logger failed to create log file '%s'\n", file_path);
-                std::abort();
-            }
+    // Drain the async queue, stop the backend thread and go back to synchronous writes.
+    // Same threading restrictions as enable_async().
+    void disable_async() {
+        if (!async_sink) {
+            return;
+        }
+        set_active_sink(sink);
+        async_sink->stop();
+        async_sink.reset();
+    }
 
-            sink->set_pattern(plain_pattern);
-            return sink;
+    bool is_async() const { return async_sink != nullptr; }
+
+    // Enqueue latency and queue depth of the async backend; all zeros when async mode is off
+    AsyncStats async_stats() const { return async_sink ? async_sink->stats() : AsyncStats{}; }
+
+    // Capture raw arguments on the calling thread and leave all formatting to a backend thread.
+    // Each thread gets its own buffer of buffer_size bytes. With TimestampSource::tsc log calls read the
+    // cycle counter instead of the system clock. Same threading restrictions as enable_async().
+    void enable_deferred(std::size_t         buffer_size = DeferredBackend::default_buffer_size,
+                         AsyncOverflowPolicy policy      = AsyncOverflowPolicy::block,
+                         TimestampSource     timestamps  = TimestampSource::system_clock) {
+        if (deferred) {
+            return;
+        }
+        // Repeats are folded after the backend thread has formatted them
+        const std::shared_ptr<spdlog::sinks::sink> target =
+            duplicate_filter ? std::shared_ptr<spdlog::sinks::sink>(duplicate_filter) : sink;
+        deferred = std::make_unique<DeferredBackend>(target, buffer_size, policy, timestamps);
+        register_exit_handler();
+    }
+
+    // Drain the thread buffers, stop the backend thread and format on the calling thread again.
+    // Same threading restrictions as enable_async().
+    void disable_deferred() {
+        if (!deferred) {
+            return;
+        }
+        auto backend = std::move(deferred);
+        backend->stop();
+    }
+
+    bool is_deferred() const { return deferred != nullptr; }
+
+    DeferredStats deferred_stats() const { return deferred ? deferred->stats() : DeferredStats{}; }
+
+#if TT_LOGGER_HAS_COMPRESSION
+    // Throughput and CPU time of the compression thread; all zeros unless TT_LOGGER_FILE ends in .gz.
+    // Summed over every file when the log is split by LogType.
+    CompressionStats compression_stats() const {
+        CompressionStats total;
+        const auto       add = [&](spdlog::sinks::sink & file_sink) {
+            if (auto * compressed = dynamic_cast<CompressedFileSink *>(&file_sink)) {
+                total += compressed->stats();
+            }
+        };
+        if (const auto split = std::dynamic_pointer_cast<SplitSink>(sink)) {
+            split->for_each_file(add);
         } else {
-            auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+            add(*sink);
+        }
+        return total;
+    }
+#endif
 
-            // Check if output should be colored:
-            // 1. Traditional terminal detection
-            // 2. CI environments that support ANSI colors (GitHub Actions, etc.)
-            bool is_terminal = isatty(STDOUT_FILENO) != 0;
-            bool is_ci_with_colors = std::getenv("GITHUB_ACTIONS") != nullptr || std::getenv("CI") != nullptr ||
-                                     std::getenv("CONTINUOUS_INTEGRATION") != nullptr;
+    // Block until every record logged so far has been written, then flush the sink
+    void flush() {
+        if (deferred) {
+            deferred->flush();
+        }
+        (async_sink ? async_sink : sink)->flush();
+    }
 
-            sink->set_pattern((is_terminal || is_ci_with_colors) ? colored_pattern : plain_pattern);
+#if TT_LOGGER_HAS_CONTROL_SOCKET
+    // Accept tt-logger-ctl commands on a Unix socket at path, served by a background thread. Only clients of
+    // the same user are served. Throws std::runtime_error if the socket cannot be created or something other
+    // than a socket is at path. Set TT_LOGGER_CONTROL_SOCKET to do this at startup.
+    void enable_control(const std::string & path) {
+        if (control) {
+            return;
+        }
+        control = std::make_unique<ControlServer>(path, [this](std::string_view line) {
+            return handle_control_command(line);
+        });
+        register_exit_handler();
+    }
 
-            return sink;
+    // Stop the listener and remove the socket file
+    void disable_control() { control.reset(); }
+
+    // Path of the control socket, empty when the control plane is off
+    std::string control_socket_path() const { return control ? control->path() : std::string(); }
+#endif
+
+    // Read settings from a configuration file (see tt-logger-config.hpp) in place of TT_LOGGER_CONFIG and
+    // reload it whenever it changes. Throws std::runtime_error if the file cannot be read.
+    void load_config(const std::string & path) {
+#if TT_LOGGER_HAS_CONFIG_WATCH
+        config_watcher.reset();
+#endif
+        {
+            std::lock_guard<std::mutex> lock(config_mutex);
+            config_path = path;
         }
+        reload_config();
+#if TT_LOGGER_HAS_CONFIG_WATCH
+        watch_config();
+#endif
     }
 
-    void apply_log_type_filtering(spdlog::level::level_enum default_level) {
-        const char * types_env = std::getenv("TT_LOGGER_TYPES");
-        if (!types_env) {
-            types_env = std::getenv("TT_METAL_LOGGER_TYPES");
+    // Stop watching the configuration file and go back to the settings of the environment
+    void unload_config() {
+#if TT_LOGGER_HAS_CONFIG_WATCH
+        config_watcher.reset();
+#endif
+        {
+            std::lock_guard<std::mutex> lock(config_mutex);
+            config_path.clear();
+        }
+        reload_config();
+    }
+
+#if TT_LOGGER_HAS_SHARED_LEVELS
+    // Take levels from the job's shared segment "/tt-logger-<job_id>", creating it from the current levels
+    // if this is the first process of the job. From then on only the segment's writer (tt-logger-ctl --job)
+    // changes levels. Throws std::runtime_error if the segment cannot be used. Set TT_LOGGER_SHARED_LEVELS
+    // to the job ID to do this at startup.
+    void attach_shared_levels(std::string_view job_id) {
+        std::lock_guard<std::mutex> lock(levels_mutex);
+        if (shared_levels) {
+            return;
+        }
+        tt::attach_shared_levels(detail::log_type_levels, job_id, effective_levels());
+        shared_levels = true;
+        for (auto & logger : loggers) {
+            logger->set_level(spdlog::level::trace);
         }
+        warn_lowered_levels();
+    }
 
-        if (types_env) {
-            std::string types_str = types_env;
+    // Go back to this process's own levels, including changes made while attached
+    void detach_shared_levels() {
+        std::lock_guard<std::mutex> lock(levels_mutex);
+        if (!shared_levels) {
+            return;
+        }
+        tt::detach_shared_levels(detail::log_type_levels);
+        shared_levels = false;
+        apply_levels();
+    }
 
-            if (types_str.find("All") != std::string::npos) {
-                // If "All" is specified, keep all loggers enabled
-                return;
+    bool has_shared_levels() {
+        std::lock_guard<std::mutex> lock(levels_mutex);
+        return shared_levels;
+    }
+#endif
+
+    // Write only 1 in N trace and debug messages of a type, chosen at random, where `rates` is a list such as
+    // "Dispatch:1000,Op:100" or "1000" for every type; 0 and 1 write them all. Each sampled message ends with
+    // its weight, N, so that counts can be scaled back up. Set TT_LOGGER_SAMPLE_RATE to do this at startup;
+    // a reload of the configuration file sets the rates from there again.
+    void set_sample_rates(std::string_view rates) {
+        const detail::LogTypeRates parsed = parse_rates(rates, "sample rates");
+        std::lock_guard<std::mutex> lock(config_mutex);
+        store_sample_rates(parsed);
+    }
+
+    // Switch single call sites on or off by rules such as "type Dispatch file dispatch.cpp line 100-200 +;
+    // func *poll* -", which select sites by file, line, function, format string and LogType; the last rule that
+    // matches a site decides. "+" writes a site's messages whatever the level of its type, "-" never writes them
+    // and "=" leaves them to the level. Sites registered later get their state from the rules when they register.
+    // A "+" rule needs a type, which it reaches down to trace, as sites below the level have never logged and
+    // only a rule naming their type can know of them; "+" rules without one are skipped with a warning.
+    // Set TT_LOGGER_SITES to do this at startup; a reload of the configuration file sets the rules from there
+    // again.
+    void set_site_rules(std::string_view rules) { store_site_rules(parse_sites(rules, "site rules")); }
+
+    // Keep the last `size` messages of every type that are below its output level but at or above its level in
+    // `levels`, a list in TT_LOGGER_LEVEL syntax where types without an entry keep nothing, and write them out
+    // just before the next error or critical message of that type. "off" stops keeping messages. Set
+    // TT_LOGGER_BACKTRACE to do this at startup.
+    void enable_backtrace(std::string_view levels, std::size_t size = default_backtrace_size) {
+        const detail::LogTypeLevels parsed = parse_levels(levels, SPDLOG_LEVEL_OFF, "backtrace levels");
+        std::lock_guard<std::mutex> lock(levels_mutex);
+        for (std::size_t index = 0; index < backtrace_levels.size(); ++index) {
+            backtrace_levels[index].store(static_cast<std::uint8_t>(parsed[index]), std::memory_order_relaxed);
+            if (parsed[index] < SPDLOG_LEVEL_OFF && size > 0) {
+                backtraces[index].enable(size);
             } else {
-                // Disable all loggers first, then enable only the specified ones
-                for (auto & logger : loggers) {
-                    logger->set_level(spdlog::level::off);
+                backtraces[index].disable();
+            }
+        }
+        apply_levels();
+    }
+
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+    // Keep the messages of every type at or above its level in `levels`, a list in TT_LOGGER_LEVEL syntax where
+    // types without an entry are not recorded, in a ring of ring_size bytes per thread, whatever the output
+    // level. The rings are written to dump_path, with {pid}, {host}, ... filled in, on SIGSEGV, SIGABRT and
+    // SIGBUS. Calling it again only changes the levels. Set TT_LOGGER_FLIGHT_RECORDER to do this at startup.
+    void enable_flight_recorder(std::string_view levels, const std::string & dump_path = default_flight_recorder_path,
+                                std::size_t ring_size = FlightRecorder::default_ring_size) {
+        const detail::LogTypeLevels parsed = parse_levels(levels, SPDLOG_LEVEL_OFF, "flight recorder levels");
+        {
+            std::lock_guard<std::mutex> lock(call_sites_mutex);
+            if (!recorder.load(std::memory_order_relaxed)) {
+                FlightRecorder & flight_recorder =
+                    FlightRecorder::create(std::vector<std::string>(log_type_names.begin(), log_type_names.end()),
+                                           ring_size);
+                for (const CallSite * site : call_sites) {
+                    flight_recorder.add_call_site(site->id, site->file, site->line, site->function, site->format);
                 }
+                const auto warn = [&](const char * problem, std::string_view name) {
+                    std::fprintf(stderr, "tt-logger: keeping %s '%.*s' in flight recorder path '%s'\n", problem,
+                                 static_cast<int>(name.size()), name.data(), dump_path.c_str());
+                };
+                recorder_path = expand_log_path(dump_path, LogPathFields::current(), warn);
+                flight_recorder.install_crash_handlers(recorder_path);
+                recorder.store(&flight_recorder, std::memory_order_release);
+            }
+        }
+        std::lock_guard<std::mutex> lock(levels_mutex);
+        for (std::size_t index = 0; index < recorder_levels.size(); ++index) {
+            recorder_levels[index].store(static_cast<std::uint8_t>(parsed[index]), std::memory_order_relaxed);
+        }
+        apply_levels();
+    }
 
-                // Enable LogAlways by default (always keep this enabled)
-                loggers[static_cast<std::size_t>(LogAlways)]->set_level(default_level);
+    bool has_flight_recorder() const { return recorder.load(std::memory_order_acquire) != nullptr; }
 
-                // Check each log type name and enable if found in the environment variable
-                std::size_t type_index = 0;
-                for (const char * type_name : log_type_names) {
-                    if (types_str.find(type_name) != std::string::npos) {
-                        loggers[type_index]->set_level(default_level);
-                    }
-                    type_index++;
-                }
+    // Write the flight recorder's rings to `path`, or to the path used on fatal signals when empty. False if
+    // the recorder is not enabled or the file cannot be written.
+    bool dump_flight_recorder(const std::string & path = {}) const {
+        const FlightRecorder * flight_recorder = recorder.load(std::memory_order_acquire);
+        return flight_recorder && flight_recorder->dump(path.empty() ? recorder_path : path);
+    }
+#endif
+
+    // Snapshot of every call site registered so far, indexed by CallSite::id. Sites register on their first
+    // message that is emitted or kept in the flight recorder or a backtrace. A site stays valid for the life of
+    // the process unless the library defining it is unloaded.
+    std::vector<const CallSite *> registered_call_sites() const {
+        std::lock_guard<std::mutex> lock(call_sites_mutex);
+        return call_sites;
+    }
+
+    // Entry points of the log_* macros. A site switched off by set_site_rules() returns after one relaxed load
+    // of its state; the message arguments have been evaluated by then, as for any log_* call that is not
+    // written. Everything past that load is in emit(), so a call site carries only the two checks and the
+    // call. The format string is checked here and passed on as a string view, and the arguments as const
+    // references to their decayed types, so every site with the same argument types shares one instantiation
+    // of emit() and what it calls, whatever the value categories of its arguments or the lengths of its
+    // string literals.
+    template <typename... Args>
+    static void log_at(CallSite & site, LogType type, const char * function, spdlog::format_string_t<Args...> fmt,
+                       Args &&... args) {
+        if (site.state.load(std::memory_order_relaxed) != CallSite::disabled) {
+            emit<std::decay_t<Args>...>(site, type, function, fmt, args...);
+        }
+    }
+
+    template <typename T> static void log_at(CallSite & site, LogType type, const char * function, const T & msg) {
+        if (site.state.load(std::memory_order_relaxed) != CallSite::disabled) {
+            emit<std::decay_t<const T>>(site, type, function, msg);
+        }
+    }
+
+    template <typename... Args>
+    TT_LOGGER_COLD static void emit(CallSite & site, LogType type, const char * function, fmt::string_view fmt,
+                                    const Args &... args) {
+        instance().log(site, type, function, SPDLOG_FMT_RUNTIME(fmt), args...);
+    }
+
+    template <typename T>
+    TT_LOGGER_COLD static void emit(CallSite & site, LogType type, const char * function, const T & msg) {
+        instance().log(site, type, function, msg);
+    }
+
+    // Entry points of the log_*_every_n, log_*_first_n and log_*_every_ms macros, which check the format string
+    // and decay the arguments like log_at() for the out-of-line emit_throttled()
+    template <typename... Args>
+    static void log_throttled_at(CallSite & site, std::uint64_t suppressed, LogType type, const char * function,
+                                 spdlog::format_string_t<Args...> fmt, Args &&... args) {
+        emit_throttled<std::decay_t<Args>...>(site, suppressed, type, function, fmt, args...);
+    }
+
+    template <typename T>
+    static void log_throttled_at(CallSite & site, std::uint64_t suppressed, LogType type, const char * function,
+                                 const T & msg) {
+        emit_throttled<std::decay_t<const T>>(site, suppressed, type, function, msg);
+    }
+
+    template <typename... Args>
+    TT_LOGGER_COLD static void emit_throttled(CallSite & site, std::uint64_t suppressed, LogType type,
+                                              const char * function, fmt::string_view fmt, const Args &... args) {
+        instance().log_throttled(site, suppressed, type, function, SPDLOG_FMT_RUNTIME(fmt), args...);
+    }
+
+    template <typename T>
+    TT_LOGGER_COLD static void emit_throttled(CallSite & site, std::uint64_t suppressed, LogType type,
+                                              const char * function, const T & msg) {
+        instance().log_throttled(site, suppressed, type, function, msg);
+    }
+
+    // The level check is repeated because the first log call of the process passes the macro's check before
+    // the registry exists. A message that passes it may still only be meant for the flight recorder or a
+    // backtrace, so the logger's own level decides about output, unless a site rule forces the site on. Forced
+    // messages below that level are written without sampling.
+    template <typename... Args>
+    void log(CallSite & site, LogType type, const char * function, spdlog::format_string_t<Args...> fmt,
+             Args &&... args) {
+        spdlog::logger & logger = *loggers[static_cast<std::size_t>(type)];
+        if (!tt::should_log(type, site.level)) {
+            return;
+        }
+        const fmt::string_view fmt_str = fmt;
+        if (site.id.load(std::memory_order_acquire) == CallSite::unregistered) {
+            register_call_site(site, type, function, std::string_view(fmt_str.data(), fmt_str.size()));
+        }
+        const std::uint8_t state = site.state.load(std::memory_order_relaxed);
+        if (state == CallSite::disabled) {
+            return;
+        }
+        record(site, type, fmt_str, args...);
+        const bool below_level = !logger.should_log(site.level);
+        if (below_level && state != CallSite::forced) {
+            keep_for_backtrace(logger, type, site.loc(function), site.level, fmt_str, args...);
+            return;
+        }
+        const std::uint32_t weight = below_level ? 1 : sample_weight(type, site.level);
+        if (weight == 0 || !within_rate_limit(type, logger, site.loc(function))) {
+            return;
+        }
+        write_backtrace(type, logger, site.loc(function), site.level);
+        if (below_level) {
+            dispatch_forced(logger, site.loc(function), site.level, fmt_str, args...);
+            return;
+        }
+        if (weight > 1) {
+            dispatch_sampled(logger, site.loc(function), site.level, weight, fmt_str, args...);
+            return;
+        }
+        dispatch(logger, site.loc(function), site.level, fmt, std::forward<Args>(args)...);
+    }
+
+    template <typename T> void log(CallSite & site, LogType type, const char * function, const T & msg) {
+        spdlog::logger & logger = *loggers[static_cast<std::size_t>(type)];
+        if (!tt::should_log(type, site.level)) {
+            return;
+        }
+        if (site.id.load(std::memory_order_acquire) == CallSite::unregistered) {
+            if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+                register_call_site(site, type, function, msg);
+            } else {
+                register_call_site(site, type, function, "{}");
             }
         }
-        // If TT_LOGGER_TYPES is not set, keep all loggers enabled (default behavior)
+        const std::uint8_t state = site.state.load(std::memory_order_relaxed);
+        if (state == CallSite::disabled) {
+            return;
+        }
+        record_message(site, type, msg);
+        const bool below_level = !logger.should_log(site.level);
+        if (below_level && state != CallSite::forced) {
+            keep_message_for_backtrace(logger, type, site.loc(function), site.level, msg);
+            return;
+        }
+        const std::uint32_t weight = below_level ? 1 : sample_weight(type, site.level);
+        if (weight == 0 || !within_rate_limit(type, logger, site.loc(function))) {
+            return;
+        }
+        write_backtrace(type, logger, site.loc(function), site.level);
+        if (below_level) {
+            dispatch_message_forced(logger, site.loc(function), site.level, msg);
+            return;
+        }
+        if (weight > 1) {
+            dispatch_message_sampled(logger, site.loc(function), site.level, weight, msg);
+            return;
+        }
+        dispatch(logger, site.loc(function), site.level, msg);
     }
 
-  public:
-    static LoggerRegistry & instance() {
-        static LoggerRegistry * registry = new LoggerRegistry();
-        return *registry;
+    // Called for the messages of the log_*_every_n, log_*_first_n and log_*_every_ms macros that get through.
+    // A message that follows suppressed ones of its site ends with their count.
+    template <typename... Args>
+    void log_throttled(CallSite & site, std::uint64_t suppressed, LogType type, const char * function,
+                       spdlog::format_string_t<Args...> fmt, Args &&... args) {
+        if (suppressed == 0) {
+            log(site, type, function, fmt, std::forward<Args>(args)...);
+            return;
+        }
+        const fmt::string_view fmt_str = fmt;
+        spdlog::memory_buf_t   text;
+        try {
+            fmt::vformat_to(fmt::appender(text), fmt_str, fmt::make_format_args(args...));
+        } catch (const std::exception &) {
+            log(site, type, function, fmt, std::forward<Args>(args)...);  // Reports the error as usual
+            return;
+        }
+        if (site.id.load(std::memory_order_acquire) == CallSite::unregistered) {
+            register_call_site(site, type, function, std::string_view(fmt_str.data(), fmt_str.size()));
+        }
+        log_with_suppressed(site, type, function, text, suppressed);
     }
 
-    std::shared_ptr<spdlog::logger> get(LogType type) { return loggers[static_cast<std::size_t>(type)]; }
+    template <typename T>
+    void log_throttled(CallSite & site, std::uint64_t suppressed, LogType type, const char * function,
+                       const T & msg) {
+        if (suppressed == 0) {
+            log(site, type, function, msg);
+            return;
+        }
+        spdlog::memory_buf_t text;
+        if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+            const std::string_view view = msg;
+            text.append(view.data(), view.data() + view.size());
+            if (site.id.load(std::memory_order_acquire) == CallSite::unregistered) {
+                register_call_site(site, type, function, view);
+            }
+        } else {
+            fmt::format_to(fmt::appender(text), "{}", msg);
+            if (site.id.load(std::memory_order_acquire) == CallSite::unregistered) {
+                register_call_site(site, type, function, "{}");
+            }
+        }
+        log_with_suppressed(site, type, function, text, suppressed);
+    }
 
-    void set_level(spdlog::level::level_enum level) {
-        for (auto & logger : loggers) {
-            logger->set_level(level);
+    // Logging without a call site, for code that builds its own source location. These messages are not kept
+    // in the flight recorder.
+    template <typename... Args>
+    void log(LogType type, spdlog::source_loc loc, spdlog::level::level_enum level,
+             spdlog::format_string_t<Args...> fmt, Args &&... args) {
+        spdlog::logger & logger = *loggers[static_cast<std::size_t>(type)];
+        if (!tt::should_log(type, level)) {
+            return;
+        }
+        if (!logger.should_log(level)) {
+            const fmt::string_view fmt_str = fmt;
+            keep_for_backtrace(logger, type, loc, level, fmt_str, args...);
+            return;
+        }
+        const std::uint32_t weight = sample_weight(type, level);
+        if (weight == 0 || !within_rate_limit(type, logger, loc)) {
+            return;
+        }
+        write_backtrace(type, logger, loc, level);
+        if (weight > 1) {
+            dispatch_sampled(logger, loc, level, weight, fmt::string_view(fmt), args...);
+            return;
+        }
+        dispatch(logger, loc, level, fmt, std::forward<Args>(args)...);
+    }
+
+    template <typename T> void log(LogType type, spdlog::source_loc loc, spdlog::level::level_enum level, const T & msg) {
+        spdlog::logger & logger = *loggers[static_cast<std::size_t>(type)];
+        if (!tt::should_log(type, level)) {
+            return;
         }
+        if (!logger.should_log(level)) {
+            keep_message_for_backtrace(logger, type, loc, level, msg);
+            return;
+        }
+        const std::uint32_t weight = sample_weight(type, level);
+        if (weight == 0 || !within_rate_limit(type, logger, loc)) {
+            return;
+        }
+        write_backtrace(type, logger, loc, level);
+        if (weight > 1) {
+            dispatch_message_sampled(logger, loc, level, weight, msg);
+            return;
+        }
+        dispatch(logger, loc, level, msg);
+    }
+
+    // Logging without a call site of type-erased arguments, the entry point of tt-logger-compiled.hpp. Makes
+    // the checks of log() above before formatting, so a message that is below the level, sampled out or over
+    // the rate limit is only formatted when a backtrace keeps it.
+    void vlog(LogType type, spdlog::source_loc loc, spdlog::level::level_enum level, fmt::string_view format,
+              fmt::format_args args) {
+        const std::size_t index  = static_cast<std::size_t>(type);
+        spdlog::logger &  logger = *loggers[index];
+        if (!tt::should_log(type, level)) {
+            return;
+        }
+        spdlog::memory_buf_t text;
+        if (!logger.should_log(level)) {
+            if (static_cast<int>(level) >= backtrace_levels[index].load(std::memory_order_relaxed)) {
+                vformat_message(text, format, args);
+                keep_for_backtrace(logger, type, loc, level, fmt::string_view(text.data(), text.size()));
+            }
+            return;
+        }
+        const std::uint32_t weight = sample_weight(type, level);
+        if (weight == 0 || !within_rate_limit(type, logger, loc)) {
+            return;
+        }
+        write_backtrace(type, logger, loc, level);
+        vformat_message(text, format, args);
+        const std::string_view message(text.data(), text.size());
+        if (weight > 1) {
+            dispatch_message_sampled(logger, loc, level, weight, message);
+            return;
+        }
+        dispatch(logger, loc, level, message);
     }
 };
 
 }  // namespace tt
 
+// Also defined by tt-logger-compiled.hpp
+#ifndef TT_LOGGER_LOGTYPE_FORMATTER
+#    define TT_LOGGER_LOGTYPE_FORMATTER
 namespace fmt {
 template <> struct formatter<tt::LogType> : fmt::formatter<std::string_view> {
     template <typename FormatContext> constexpr auto format(tt::LogType logtype, FormatContext & ctx) const {
@@ -234,48 +2238,148 @@ template <> struct formatter<tt::LogType> : fmt::formatter<std::string_view> {
     }
 };
 }  // namespace fmt
+#endif
+
+// The lambda gives every expansion its own constant-initialized CallSite without turning the macro into a
+// statement. The caller's function name is passed along because inside the lambda it would be operator().
+// Calls of a type compiled out by TT_LOGGER_COMPILED_LEVELS sit in a constant-false branch and are removed;
+// calls below the runtime level cost one relaxed load and a compare, and calls of a site switched off by
+// TT_LOGGER_SITES one more. The rest of the call is the out-of-line LoggerRegistry::emit().
+#define TT_LOGGER_CALL(type, level, ...)                                          \
+    (!tt::is_compiled_in(type, level) || !tt::should_log(type, level) ?           \
+         (void) 0 :                                                               \
+         tt::LoggerRegistry::log_at(                                              \
+             []() -> tt::CallSite & {                                             \
+                 static tt::CallSite tt_logger_site{ __FILE__, __LINE__, level }; \
+                 return tt_logger_site;                                           \
+             }(),                                                                 \
+             type, SPDLOG_FUNCTION, __VA_ARGS__))
+
+// Rate-limited variants of the log_* macros, with state per expansion: log_warning_every_n(type, n, ...) lets
+// the first call and every n-th one after it through, log_warning_first_n(type, n, ...) the first n calls and
+// log_warning_every_ms(type, ms, ...) at most one call per ms milliseconds. A suppressed call costs one atomic
+// increment and leaves the message arguments unevaluated, which is why these expand to statements rather
+// than expressions. The next message that gets through ends with the number of calls suppressed before it.
+#define TT_LOGGER_CALL_THROTTLED(type, level, policy, limit, ...)                                            \
+    do {                                                                                                     \
+        if (tt::is_compiled_in(type, level) && tt::should_log(type, level)) {                                \
+            static tt::CallSite             tt_logger_site{ __FILE__, __LINE__, level };                     \
+            static tt::detail::SiteThrottle tt_logger_throttle;                                              \
+            if (tt_logger_site.state.load(std::memory_order_relaxed) != tt::CallSite::disabled) {            \
+                const std::uint64_t tt_logger_suppressed =                                                   \
+                    tt_logger_throttle.policy(static_cast<std::uint64_t>(limit));                            \
+                if (tt_logger_suppressed != tt::detail::SiteThrottle::suppressed) {                          \
+                    tt::LoggerRegistry::log_throttled_at(tt_logger_site, tt_logger_suppressed, type,         \
+                                                         SPDLOG_FUNCTION, __VA_ARGS__);                      \
+                }                                                                                            \
+            }                                                                                                \
+        }                                                                                                    \
+    } while (0)
+
+// Replace the macros of tt-logger-compiled.hpp when it was included first
+#ifdef TT_LOGGER_COMPILED_CALL
+#    undef log_trace
+#    undef log_debug
+#    undef log_info
+#    undef log_warning
+#    undef log_error
+#    undef log_critical
+#    undef log_fatal
+#endif
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
-#    define log_trace(type, ...) SPDLOG_LOGGER_TRACE(tt::LoggerRegistry::instance().get(type), __VA_ARGS__)
+#    define log_trace(type, ...) TT_LOGGER_CALL(type, spdlog::level::trace, __VA_ARGS__)
+#    define log_trace_every_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::trace, every_n, n, __VA_ARGS__)
+#    define log_trace_first_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::trace, first_n, n, __VA_ARGS__)
+#    define log_trace_every_ms(type, ms, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::trace, every_ms, ms, __VA_ARGS__)
 #else
 #    define log_trace(type, ...) (void) 0
+#    define log_trace_every_n(type, n, ...) (void) 0
+#    define log_trace_first_n(type, n, ...) (void) 0
+#    define log_trace_every_ms(type, ms, ...) (void) 0
 #endif
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
-#    define log_debug(type, ...) SPDLOG_LOGGER_DEBUG(tt::LoggerRegistry::instance().get(type), __VA_ARGS__)
+#    define log_debug(type, ...) TT_LOGGER_CALL(type, spdlog::level::debug, __VA_ARGS__)
+#    define log_debug_every_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::debug, every_n, n, __VA_ARGS__)
+#    define log_debug_first_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::debug, first_n, n, __VA_ARGS__)
+#    define log_debug_every_ms(type, ms, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::debug, every_ms, ms, __VA_ARGS__)
 #else
 #    define log_debug(type, ...) (void) 0
+#    define log_debug_every_n(type, n, ...) (void) 0
+#    define log_debug_first_n(type, n, ...) (void) 0
+#    define log_debug_every_ms(type, ms, ...) (void) 0
 #endif
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
-#    define log_info(type, ...) SPDLOG_LOGGER_INFO(tt::LoggerRegistry::instance().get(type), __VA_ARGS__)
+#    define log_info(type, ...) TT_LOGGER_CALL(type, spdlog::level::info, __VA_ARGS__)
+#    define log_info_every_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::info, every_n, n, __VA_ARGS__)
+#    define log_info_first_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::info, first_n, n, __VA_ARGS__)
+#    define log_info_every_ms(type, ms, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::info, every_ms, ms, __VA_ARGS__)
 #else
 #    define log_info(type, ...) (void) 0
+#    define log_info_every_n(type, n, ...) (void) 0
+#    define log_info_first_n(type, n, ...) (void) 0
+#    define log_info_every_ms(type, ms, ...) (void) 0
 #endif
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
-#    define log_warning(type, ...) SPDLOG_LOGGER_WARN(tt::LoggerRegistry::instance().get(type), __VA_ARGS__)
+#    define log_warning(type, ...) TT_LOGGER_CALL(type, spdlog::level::warn, __VA_ARGS__)
+#    define log_warning_every_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::warn, every_n, n, __VA_ARGS__)
+#    define log_warning_first_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::warn, first_n, n, __VA_ARGS__)
+#    define log_warning_every_ms(type, ms, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::warn, every_ms, ms, __VA_ARGS__)
 #else
 #    define log_warning(type, ...) (void) 0
+#    define log_warning_every_n(type, n, ...) (void) 0
+#    define log_warning_first_n(type, n, ...) (void) 0
+#    define log_warning_every_ms(type, ms, ...) (void) 0
 #endif
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ERROR
-#    define log_error(type, ...) SPDLOG_LOGGER_ERROR(tt::LoggerRegistry::instance().get(type), __VA_ARGS__)
+#    define log_error(type, ...) TT_LOGGER_CALL(type, spdlog::level::err, __VA_ARGS__)
+#    define log_error_every_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::err, every_n, n, __VA_ARGS__)
+#    define log_error_first_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::err, first_n, n, __VA_ARGS__)
+#    define log_error_every_ms(type, ms, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::err, every_ms, ms, __VA_ARGS__)
 #else
 #    define log_error(type, ...) (void) 0
+#    define log_error_every_n(type, n, ...) (void) 0
+#    define log_error_first_n(type, n, ...) (void) 0
+#    define log_error_every_ms(type, ms, ...) (void) 0
 #endif
 
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_CRITICAL
-#    define log_critical(type, ...) SPDLOG_LOGGER_CRITICAL(tt::LoggerRegistry::instance().get(type), __VA_ARGS__)
+#    define log_critical(type, ...) TT_LOGGER_CALL(type, spdlog::level::critical, __VA_ARGS__)
+#    define log_critical_every_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::critical, every_n, n, __VA_ARGS__)
+#    define log_critical_first_n(type, n, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::critical, first_n, n, __VA_ARGS__)
+#    define log_critical_every_ms(type, ms, ...) \
+        TT_LOGGER_CALL_THROTTLED(type, spdlog::level::critical, every_ms, ms, __VA_ARGS__)
 #else
 #    define log_critical(type, ...) (void) 0
+#    define log_critical_every_n(type, n, ...) (void) 0
+#    define log_critical_first_n(type, n, ...) (void) 0
+#    define log_critical_every_ms(type, ms, ...) (void) 0
 #endif
 
 // Eventually deprecate log_fatal and use log_critical instead
 #if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_CRITICAL
-#    define log_fatal(type, ...) SPDLOG_LOGGER_CRITICAL(tt::LoggerRegistry::instance().get(type), __VA_ARGS__)
+#    define log_fatal(type, ...) TT_LOGGER_CALL(type, spdlog::level::critical, __VA_ARGS__)
 #else
 #    define log_fatal(type, ...) (void) 0
 #endif
-
-#undef TT_LOGGER_TYPES
@@ -0,0 +1,26 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-compiled.cpp
+ * @brief The tt-logger::compiled library: the entry point of tt-logger-compiled.hpp over the LoggerRegistry
+ *
+ * The only translation unit that instantiates the registry, spdlog and the fmt formatting code for callers
+ * of tt-logger-compiled.hpp.
+ */
+
+#include <tt-logger/tt-logger.hpp>
+#include <tt-logger/tt-logger-compiled.hpp>
+
+namespace tt::compiled {
+
+const std::atomic<std::uint8_t> * const log_type_levels = detail::log_type_levels.levels.data();
+
+void vlog(LogType type, int level, const char * file, int line, const char * function, fmt::string_view format,
+          fmt::format_args args) {
+    LoggerRegistry::instance().vlog(type, spdlog::source_loc{ file, line, function },
+                                    static_cast<spdlog::level::level_enum>(level), format, args);
+}
+
+}  // namespace tt::compiled
@@ -0,0 +1,778 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-benchmark.cpp
+ * @brief Multi-threaded benchmarks for the tt-logger library
+ *
+ * This file contains benchmarks that compare:
+ * - The synchronous sink path against the async backend at 1, 8 and 64 producer threads
+ * - Caller-side cost of the synchronous, async and deferred formatting paths
+ * - Producer throughput of the shared async queue against per-thread rings as threads are added
+ * - File size and write calls of the text and binary log formats
+ * - Cost of a system clock read against a cycle counter read, alone and on the deferred path
+ * - Cost of a log call rejected by the runtime level
+ * - Tail latency of a file sink across rotations, with and without segments created ahead of time
+ * - Caller-side latency, file size and compression throughput of a block-compressed file sink
+ * - Threads logging different LogTypes to one shared file against a file per LogType
+ * - Cost of a debug call kept only in the flight recorder against a filtered and a written one
+ * - Cost of a suppressed log_*_every_n and log_*_every_ms call against a filtered and a written one
+ * - A retry loop written to a file directly and through the duplicate message filter
+ * - Cost of a trace call sampled 1 in 1000 against a filtered and a written one
+ * - Cost of a call whose site is switched off by a rule against a filtered and a written one
+ * - Code size per log_* call site and instruction cache misses of filtered sites, against spdlog's macros
+ *
+ * Log output goes to TT_LOGGER_FILE, which defaults to a file in the system temp directory
+ * so that terminal I/O does not dominate the measurements.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tt-logger/tt-logger.hpp>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#    include <elf.h>
+#    include <linux/perf_event.h>
+#    include <sys/ioctl.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+#define TT_LOGGER_BENCHMARK_REPEAT_4(...)  __VA_ARGS__, __VA_ARGS__, __VA_ARGS__, __VA_ARGS__
+#define TT_LOGGER_BENCHMARK_REPEAT_16(...)                                                             \
+    TT_LOGGER_BENCHMARK_REPEAT_4(__VA_ARGS__), TT_LOGGER_BENCHMARK_REPEAT_4(__VA_ARGS__),               \
+        TT_LOGGER_BENCHMARK_REPEAT_4(__VA_ARGS__), TT_LOGGER_BENCHMARK_REPEAT_4(__VA_ARGS__)
+
+// Functions with 1 and 17 call sites, whose sizes in the symbol table give the code of 16 sites. C linkage
+// keeps the names easy to look up.
+extern "C" {
+[[gnu::noinline]] void tt_logger_benchmark_sites_1(int i, double x) {
+    log_info(tt::LogOp, "Site {} value {}", i, x);
+}
+
+[[gnu::noinline]] void tt_logger_benchmark_sites_17(int i, double x) {
+    log_info(tt::LogOp, "Site {} value {}", i, x);
+    (void) (TT_LOGGER_BENCHMARK_REPEAT_16(log_info(tt::LogOp, "Site {} value {}", i, x)));
+}
+
+[[gnu::noinline]] void tt_logger_benchmark_spdlog_sites_1(spdlog::logger * logger, int i, double x) {
+    SPDLOG_LOGGER_INFO(logger, "Site {} value {}", i, x);
+}
+
+[[gnu::noinline]] void tt_logger_benchmark_spdlog_sites_17(spdlog::logger * logger, int i, double x) {
+    SPDLOG_LOGGER_INFO(logger, "Site {} value {}", i, x);
+    (void) (TT_LOGGER_BENCHMARK_REPEAT_16(SPDLOG_LOGGER_INFO(logger, "Site {} value {}", i, x)));
+}
+}
+
+namespace {
+
+constexpr int total_messages = 200000;
+
+struct RunResult {
+    double caller_ns_per_call = 0.0;  // Average time a producer spent inside log_info
+    double wall_ms            = 0.0;  // Until the last producer returned
+    double drained_ms         = 0.0;  // Until every record reached the file
+};
+
+RunResult run_producers(int thread_count) {
+    const int                  per_thread = total_messages / thread_count;
+    std::vector<std::thread>   threads;
+    std::vector<std::uint64_t> thread_ns(thread_count, 0);
+    std::atomic<int>           ready{ 0 };
+    std::atomic<bool>          go{ false };
+
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            ready.fetch_add(1);
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < per_thread; ++i) {
+                log_info(tt::LogDevice, "Benchmark thread {} iteration {} value {:.3f}", t, i, i * 0.5);
+            }
+            auto end     = std::chrono::steady_clock::now();
+            thread_ns[t] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        });
+    }
+
+    while (ready.load() < thread_count) {
+        std::this_thread::yield();
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true);
+    for (auto & thread : threads) {
+        thread.join();
+    }
+    auto producers_done = std::chrono::steady_clock::now();
+    tt::LoggerRegistry::instance().flush();
+    auto drained = std::chrono::steady_clock::now();
+
+    std::uint64_t sum_ns = 0;
+    for (auto ns : thread_ns) {
+        sum_ns += ns;
+    }
+
+    RunResult result;
+    result.caller_ns_per_call = static_cast<double>(sum_ns) / (per_thread * thread_count);
+    result.wall_ms            = std::chrono::duration<double, std::milli>(producers_done - start).count();
+    result.drained_ms         = std::chrono::duration<double, std::milli>(drained - start).count();
+    return result;
+}
+
+void print_result(const char * mode, int thread_count, const RunResult & result) {
+    std::cout << std::left << std::setw(6) << mode << " threads=" << std::setw(3) << thread_count << std::right
+              << std::fixed << std::setprecision(1) << "  caller ns/call: " << std::setw(9)
+              << result.caller_ns_per_call << "  producers: " << std::setw(8) << result.wall_ms
+              << " ms  drained: " << std::setw(8) << result.drained_ms << " ms  ("
+              << std::setprecision(2) << total_messages / result.drained_ms / 1000.0 << " M msg/s)" << std::endl;
+}
+
+enum class FileFormat { text, binary, binary_deferred };
+
+// Writes total_messages records in the given format and prints the resulting file size
+void write_log_file(const char * mode, FileFormat format) {
+    const auto path = std::filesystem::temp_directory_path() /
+                      (format == FileFormat::text ? "tt-logger-benchmark-format.log" :
+                                                    "tt-logger-benchmark-format.ttlog");
+    std::shared_ptr<spdlog::sinks::sink> sink;
+    std::shared_ptr<tt::BinarySink>      binary_sink;
+    if (format == FileFormat::text) {
+        sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(path.string(), true);
+        sink->set_pattern(tt::plain_pattern);
+    } else {
+        sink = binary_sink = std::make_shared<tt::BinarySink>(path.string());
+    }
+    spdlog::logger logger("Device", sink);
+
+    auto start = std::chrono::steady_clock::now();
+    if (format == FileFormat::binary_deferred) {
+        tt::DeferredBackend backend(sink, std::size_t(total_messages) * 128);
+        for (int i = 0; i < total_messages; ++i) {
+            backend.log(logger, spdlog::source_loc{ __FILE__, __LINE__, SPDLOG_FUNCTION }, spdlog::level::info,
+                        "Benchmark thread {} iteration {} value {:.3f}", 0, i, i * 0.5);
+        }
+    } else {
+        for (int i = 0; i < total_messages; ++i) {
+            logger.log(spdlog::source_loc{ __FILE__, __LINE__, SPDLOG_FUNCTION }, spdlog::level::info,
+                       "Benchmark thread {} iteration {} value {:.3f}", 0, i, i * 0.5);
+        }
+    }
+    logger.flush();
+    auto end = std::chrono::steady_clock::now();
+
+    const auto bytes = std::filesystem::file_size(path);
+    std::cout << std::left << std::setw(15) << mode << std::right << std::fixed << std::setprecision(1)
+              << "  bytes/msg: " << std::setw(6) << static_cast<double>(bytes) / total_messages
+              << "  file: " << std::setw(6) << bytes / 1024 << " KiB  time: " << std::setw(7)
+              << std::chrono::duration<double, std::milli>(end - start).count() << " ms";
+    if (binary_sink) {
+        std::cout << "  writes: " << binary_sink->stats().write_calls;
+    }
+    std::cout << std::endl;
+    std::filesystem::remove(path);
+}
+
+// Per-call latency percentiles of total_messages writes to one file sink
+void measure_file_latency(const char * mode, const std::shared_ptr<spdlog::sinks::sink> & sink) {
+    sink->set_pattern(tt::plain_pattern);
+    spdlog::logger             logger("Device", sink);
+    std::vector<std::uint64_t> latency_ns(total_messages);
+    for (int i = 0; i < total_messages; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        logger.log(spdlog::source_loc{ __FILE__, __LINE__, SPDLOG_FUNCTION }, spdlog::level::info,
+                   "Benchmark thread {} iteration {} value {:.3f}", 0, i, i * 0.5);
+        auto end      = std::chrono::steady_clock::now();
+        latency_ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+    logger.flush();
+
+    std::sort(latency_ns.begin(), latency_ns.end());
+    auto percentile = [&](double p) { return latency_ns[static_cast<std::size_t>(p * (total_messages - 1))]; };
+    std::cout << std::left << std::setw(20) << mode << std::right << "  p50: " << std::setw(6) << percentile(0.5)
+              << " ns  p99: " << std::setw(6) << percentile(0.99) << " ns  p99.9: " << std::setw(7)
+              << percentile(0.999) << " ns  max: " << std::setw(8) << latency_ns.back() << " ns";
+    if (auto rotating = std::dynamic_pointer_cast<tt::RotatingFileSink>(sink)) {
+        const auto stats = rotating->stats();
+        std::cout << "  rotations: " << stats.rotations << "  waits: " << stats.waits;
+    }
+#if TT_LOGGER_HAS_COMPRESSION
+    if (auto compressed = std::dynamic_pointer_cast<tt::CompressedFileSink>(sink)) {
+        std::cout << "  waits: " << compressed->stats().waits;
+    }
+#endif
+    std::cout << std::endl;
+}
+
+void remove_rotated_files(const std::filesystem::path & directory, const std::string & prefix) {
+    for (const auto & entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().filename().string().rfind(prefix, 0) == 0) {
+            std::filesystem::remove(entry.path());
+        }
+    }
+}
+
+// Throughput in M msg/s of thread_count threads that each log total_messages / thread_count messages with a
+// LogType of their own
+double run_type_threads(const std::shared_ptr<spdlog::sinks::sink> & sink, int thread_count) {
+    std::vector<std::thread> threads;
+    std::atomic<int>         ready{ 0 };
+    std::atomic<bool>        go{ false };
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&, t] {
+            spdlog::logger logger(tt::log_type_names[t], sink);
+            ready.fetch_add(1);
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < total_messages / thread_count; ++i) {
+                logger.log(spdlog::source_loc{ __FILE__, __LINE__, SPDLOG_FUNCTION }, spdlog::level::info,
+                           "Benchmark thread {} iteration {} value {:.3f}", t, i, i * 0.5);
+            }
+        });
+    }
+    while (ready.load() < thread_count) {
+        std::this_thread::yield();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    go.store(true);
+    for (auto & thread : threads) {
+        thread.join();
+    }
+    sink->flush();
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return total_messages / ms / 1000.0;
+}
+
+#if defined(__linux__)
+// Size in bytes of the function `name` in the symbol table of this executable, 0 when the table is stripped
+std::size_t function_size(const char * name) {
+    std::ifstream           file("/proc/self/exe", std::ios::binary);
+    const std::vector<char> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (image.size() < sizeof(Elf64_Ehdr) || std::memcmp(image.data(), ELFMAG, SELFMAG) != 0 ||
+        image[EI_CLASS] != ELFCLASS64) {
+        return 0;
+    }
+    const auto * header   = reinterpret_cast<const Elf64_Ehdr *>(image.data());
+    const auto * sections = reinterpret_cast<const Elf64_Shdr *>(image.data() + header->e_shoff);
+    for (std::size_t index = 0; index < header->e_shnum; ++index) {
+        if (sections[index].sh_type != SHT_SYMTAB) {
+            continue;
+        }
+        const char * names   = image.data() + sections[sections[index].sh_link].sh_offset;
+        const auto * symbols = reinterpret_cast<const Elf64_Sym *>(image.data() + sections[index].sh_offset);
+        for (std::size_t symbol = 0; symbol < sections[index].sh_size / sizeof(Elf64_Sym); ++symbol) {
+            if (std::strcmp(names + symbols[symbol].st_name, name) == 0) {
+                return symbols[symbol].st_size;
+            }
+        }
+    }
+    return 0;
+}
+
+// Counts the L1 instruction cache misses of the calling thread between start() and stop(). Unavailable when
+// the kernel or the machine does not allow the counter, as in most containers and VMs.
+class ICacheMissCounter {
+  public:
+    ICacheMissCounter() {
+        perf_event_attr attr{};
+        attr.type           = PERF_TYPE_HW_CACHE;
+        attr.size           = sizeof(attr);
+        attr.config         = PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        fd_                 = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    ICacheMissCounter(const ICacheMissCounter &)             = delete;
+    ICacheMissCounter & operator=(const ICacheMissCounter &) = delete;
+
+    ~ICacheMissCounter() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    bool available() const { return fd_ >= 0; }
+
+    void start() {
+        ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    long long stop() {
+        ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        long long count = 0;
+        return ::read(fd_, &count, sizeof(count)) == sizeof(count) ? count : -1;
+    }
+
+  private:
+    int fd_ = -1;
+};
+#endif
+
+// One step of a hot loop with 16 filtered log_debug sites in it. Every instantiation has sites of its own, so
+// 64 of them spread the code of 1024 sites over the loop.
+template <int N> [[gnu::noinline]] double hot_step(double x) {
+    (void) (TT_LOGGER_BENCHMARK_REPEAT_16(x = x * 0.999 + N, log_debug(tt::LogOp, "Step {} value {}", N, x)));
+    return x;
+}
+
+template <int N> [[gnu::noinline]] double spdlog_hot_step(spdlog::logger * logger, double x) {
+    (void) (TT_LOGGER_BENCHMARK_REPEAT_16(x = x * 0.999 + N,
+                                          SPDLOG_LOGGER_DEBUG(logger, "Step {} value {}", N, x)));
+    return x;
+}
+
+template <int... N> double run_hot_steps(std::integer_sequence<int, N...>, double x) {
+    ((x = hot_step<N>(x)), ...);
+    return x;
+}
+
+template <int... N> double run_spdlog_hot_steps(std::integer_sequence<int, N...>, spdlog::logger * logger, double x) {
+    ((x = spdlog_hot_step<N>(logger, x)), ...);
+    return x;
+}
+
+}  // namespace
+
+int main() {
+    if (!std::getenv("TT_LOGGER_FILE")) {
+        static std::string log_path = (std::filesystem::temp_directory_path() / "tt-logger-benchmark.log").string();
+        setenv("TT_LOGGER_FILE", log_path.c_str(), 1);
+    }
+    std::cout << "=== TT-Logger Benchmarks ===" << std::endl;
+    std::cout << "Log file: " << std::getenv("TT_LOGGER_FILE") << std::endl;
+    std::cout << std::endl;
+
+    auto & registry = tt::LoggerRegistry::instance();
+    registry.disable_async();
+    registry.set_level(spdlog::level::info);
+
+    // Benchmark 1: synchronous sink vs async backend. With the default queue size producers outrun the
+    // backend thread and end up waiting for free slots; a queue that holds the whole burst shows the
+    // caller-side cost alone.
+    std::cout << "Benchmark 1: sync vs async, " << total_messages << " messages per run" << std::endl;
+    for (int thread_count : { 1, 8, 64 }) {
+        registry.disable_async();
+        print_result("sync", thread_count, run_producers(thread_count));
+
+        for (std::size_t queue_size : { tt::AsyncSink::default_queue_size, std::size_t(total_messages) }) {
+            registry.enable_async(queue_size);
+            auto result = run_producers(thread_count);
+            auto stats  = registry.async_stats();
+            print_result("async", thread_count, result);
+            std::cout << "       queue " << stats.queue_capacity << ": enqueue latency avg " << std::setprecision(1)
+                      << stats.average_enqueue_ns() << " ns, max " << stats.max_enqueue_ns << " ns, max depth "
+                      << stats.max_queue_depth << ", dropped " << stats.dropped << std::endl;
+            registry.disable_async();
+        }
+    }
+
+    std::cout << std::endl;
+
+    // Benchmark 2: time spent on the calling thread. Buffers hold the whole burst so that only the
+    // hot path is measured, not backpressure from the sink.
+    std::cout << "Benchmark 2: caller-side cost, single thread, " << total_messages << " messages" << std::endl;
+    registry.disable_async();
+    print_result("sync", 1, run_producers(1));
+    registry.enable_async(total_messages);
+    print_result("async", 1, run_producers(1));
+    registry.disable_async();
+    registry.enable_deferred(std::size_t(total_messages) * 256);
+    print_result("defer", 1, run_producers(1));
+    registry.disable_deferred();
+
+    std::cout << std::endl;
+
+    // Benchmark 3: aggregate producer throughput while threads are added. Both backends get room for the
+    // whole burst, so the numbers show contention between producers rather than the speed of the sink.
+    std::cout << "Benchmark 3: producer throughput scaling (M msg/s while producers run)" << std::endl;
+    for (int thread_count : { 1, 2, 4, 8, 16, 32, 64 }) {
+        registry.enable_async(total_messages);
+        const double shared = total_messages / run_producers(thread_count).wall_ms / 1000.0;
+        registry.disable_async();
+
+        registry.enable_deferred(std::size_t(total_messages / thread_count) * 128);
+        const double rings = total_messages / run_producers(thread_count).wall_ms / 1000.0;
+        auto         stats = registry.deferred_stats();
+        registry.disable_deferred();
+
+        std::cout << "threads=" << std::left << std::setw(3) << thread_count << std::right << std::setprecision(2)
+                  << "  shared queue: " << std::setw(6) << shared << "  per-thread rings: " << std::setw(6) << rings
+                  << "  (rings reclaimed: " << stats.reclaimed_buffers << ")" << std::endl;
+    }
+
+    std::cout << std::endl;
+
+    // Benchmark 4: the same messages written as text, as binary text payloads (sync path) and as binary
+    // typed arguments (deferred path), which skips formatting entirely
+    std::cout << "Benchmark 4: text vs binary log file, " << total_messages << " messages" << std::endl;
+    write_log_file("text", FileFormat::text);
+    write_log_file("binary", FileFormat::binary);
+    write_log_file("binary+defer", FileFormat::binary_deferred);
+
+    std::cout << std::endl;
+
+    // Benchmark 5: timestamp sources. The raw reads show the clock cost alone; the deferred runs show
+    // what it adds to the caller-side cost of a log call.
+    std::cout << "Benchmark 5: timestamp sources, single thread" << std::endl;
+    constexpr int clock_reads = 10000000;
+    auto time_reads = [](auto && read) {
+        std::uint64_t sink  = 0;
+        auto          start = std::chrono::steady_clock::now();
+        for (int i = 0; i < clock_reads; ++i) {
+            sink += static_cast<std::uint64_t>(read());
+        }
+        auto end = std::chrono::steady_clock::now();
+        volatile std::uint64_t keep = sink;
+        (void) keep;
+        return std::chrono::duration<double, std::nano>(end - start).count() / clock_reads;
+    };
+    std::cout << std::fixed << std::setprecision(1) << "log_clock::now:   " << std::setw(6)
+              << time_reads([] { return spdlog::log_clock::now().time_since_epoch().count(); }) << " ns/read"
+              << std::endl;
+    std::cout << "TscClock::ticks:  " << std::setw(6) << time_reads([] { return tt::TscClock::ticks(); })
+              << " ns/read (cycle counter " << (tt::TscClock::available() ? "available" : "not available") << ")"
+              << std::endl;
+    for (auto source : { tt::TimestampSource::system_clock, tt::TimestampSource::tsc }) {
+        registry.enable_deferred(std::size_t(total_messages) * 256, tt::AsyncOverflowPolicy::block, source);
+        print_result(source == tt::TimestampSource::tsc ? "tsc" : "clock", 1, run_producers(1));
+        registry.disable_deferred();
+    }
+
+    std::cout << std::endl;
+
+    // Benchmark 6: calls below the runtime level. The macro checks the inline level table; calling the
+    // registry directly shows the cost of reaching the logger's own level check instead.
+    constexpr int filtered_calls = 100000000;
+    std::cout << "Benchmark 6: filtered-out log_debug, " << filtered_calls << " calls" << std::endl;
+    registry.set_level(spdlog::level::info);
+    auto time_filtered = [](auto && call) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < filtered_calls; ++i) {
+            call(i);
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / filtered_calls;
+    };
+    std::cout << std::setprecision(2) << "log_debug macro:  " << std::setw(6)
+              << time_filtered([](int i) { log_debug(tt::LogOp, "Filtered {} value {}", i, i * 0.5); })
+              << " ns/call" << std::endl;
+    std::cout << "registry log():   " << std::setw(6) << time_filtered([](int i) {
+        tt::LoggerRegistry::instance().log(tt::LogOp, spdlog::source_loc{ __FILE__, __LINE__, SPDLOG_FUNCTION },
+                                           spdlog::level::debug, "Filtered {} value {}", i, i * 0.5);
+    }) << " ns/call" << std::endl;
+
+    std::cout << std::endl;
+
+    // Benchmark 7: latency of individual calls to a file sink. 64 KiB segments make rotations about 0.2% of
+    // the calls, so they show up in p99.9; opening the next segment on the logging thread is compared with
+    // having it created ahead of time.
+    std::cout << "Benchmark 7: file sink latency across rotations, " << total_messages
+              << " messages, 64 KiB segments" << std::endl;
+    {
+        const auto directory = std::filesystem::temp_directory_path();
+        const auto base      = (directory / "tt-logger-benchmark-rotate.log").string();
+        measure_file_latency("no rotation", std::make_shared<spdlog::sinks::basic_file_sink_mt>(base, true));
+        for (const bool precreate : { false, true }) {
+            tt::RotationPolicy policy;
+            policy.max_size  = 64 * 1024;
+            policy.precreate = precreate;
+            measure_file_latency(precreate ? "rotate, pre-created" : "rotate, inline open",
+                                 std::make_shared<tt::RotatingFileSink>(base, policy));
+            remove_rotated_files(directory, "tt-logger-benchmark-rotate.");
+        }
+    }
+
+#if TT_LOGGER_HAS_COMPRESSION
+    std::cout << std::endl;
+
+    // Benchmark 8: a plain file against a compressed one. Log calls only copy text into a block, so the
+    // latency should match the plain file while the compression thread's cost shows up in its own stats.
+    std::cout << "Benchmark 8: compressed file sink, " << total_messages << " messages" << std::endl;
+    {
+        const auto directory = std::filesystem::temp_directory_path();
+        const auto plain     = directory / "tt-logger-benchmark-compress.log";
+        const auto gzip      = directory / "tt-logger-benchmark-compress.log.gz";
+        measure_file_latency("plain", std::make_shared<spdlog::sinks::basic_file_sink_mt>(plain.string(), true));
+
+        tt::CompressionStats stats;
+        {
+            auto sink = std::make_shared<tt::CompressedFileSink>(gzip.string());
+            measure_file_latency("compressed", sink);
+            stats = sink->stats();
+        }
+        std::cout << std::fixed << std::setprecision(1) << "file: " << std::filesystem::file_size(plain) / 1024
+                  << " KiB plain, " << std::filesystem::file_size(gzip) / 1024 << " KiB compressed ("
+                  << stats.ratio() << "x)  blocks: " << stats.blocks << "  compression: " << stats.throughput_mb_per_s()
+                  << " MB/s, " << stats.cpu_ns / 1e6 << " ms CPU" << std::endl;
+        std::filesystem::remove(plain);
+        std::filesystem::remove(gzip);
+    }
+#endif
+
+    std::cout << std::endl;
+
+    // Benchmark 9: every thread logs its own LogType. With one shared file all threads take the same sink
+    // mutex; with a file per LogType they only share the routing table.
+    std::cout << "Benchmark 9: one file vs a file per LogType (M msg/s)" << std::endl;
+    {
+        const auto directory = std::filesystem::temp_directory_path();
+        const auto shared    = (directory / "tt-logger-benchmark-split.log").string();
+        const auto split     = (directory / "tt-logger-benchmark-split-{type}.log").string();
+        for (int thread_count : { 1, 2, 4, 8 }) {
+            auto one_file = std::make_shared<spdlog::sinks::basic_file_sink_mt>(shared, true);
+            one_file->set_pattern(tt::plain_pattern);
+            std::vector<std::pair<std::string, std::string>> routes;
+            for (const char * name : tt::log_type_names) {
+                routes.emplace_back(name, name);
+            }
+            auto per_type = std::make_shared<tt::SplitSink>(routes, "Always", [&](const std::string & name) {
+                return std::make_shared<spdlog::sinks::basic_file_sink_mt>(tt::expand_type_placeholder(split, name),
+                                                                           true);
+            });
+            per_type->set_pattern(tt::plain_pattern);
+
+            const double one      = run_type_threads(one_file, thread_count);
+            const double separate = run_type_threads(per_type, thread_count);
+            std::cout << "threads=" << std::setw(2) << thread_count << std::fixed << std::setprecision(2)
+                      << "  one file: " << std::setw(6) << one << "  per type: " << std::setw(6) << separate
+                      << std::endl;
+        }
+        std::filesystem::remove(shared);
+        remove_rotated_files(directory, "tt-logger-benchmark-split-");
+    }
+
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+    std::cout << std::endl;
+
+    // Benchmark 10: log_debug at output level info. With the flight recorder on, the call encodes its
+    // arguments and copies them into the thread's ring; an argument without a binary encoding is formatted to
+    // text first. A written info message is the cost the recorder avoids.
+    constexpr int recorded_calls = 2000000;
+    std::cout << "Benchmark 10: flight recorder, " << recorded_calls << " calls" << std::endl;
+    {
+        const auto time_calls = [](auto && call) {
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < recorded_calls; ++i) {
+                call(i);
+            }
+            const auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::nano>(end - start).count() / recorded_calls;
+        };
+        const auto dump_path = (std::filesystem::temp_directory_path() / "tt-logger-benchmark-flight.ttlog").string();
+        std::cout << std::fixed << std::setprecision(1) << "debug, recorder off:         " << std::setw(6)
+                  << time_calls([](int i) { log_debug(tt::LogOp, "Recorded {} value {}", i, i * 0.5); })
+                  << " ns/call" << std::endl;
+        registry.enable_flight_recorder("debug", dump_path);
+        std::cout << "debug, recorded:             " << std::setw(6)
+                  << time_calls([](int i) { log_debug(tt::LogOp, "Recorded {} value {}", i, i * 0.5); })
+                  << " ns/call" << std::endl;
+        std::cout << "debug, recorded as text:     " << std::setw(6)
+                  << time_calls([](int i) { log_debug(tt::LogOp, "Recorded {} type {}", i, tt::LogDevice); })
+                  << " ns/call" << std::endl;
+        std::cout << "info, written and recorded: " << std::setw(6)
+                  << time_calls([](int i) { log_info(tt::LogOp, "Written {} value {}", i, i * 0.5); })
+                  << " ns/call" << std::endl;
+        registry.enable_flight_recorder("off");
+    }
+#endif
+
+    std::cout << std::endl;
+
+    // Benchmark 11: a warning in a polling loop. A suppressed every_n call is one atomic increment and a
+    // suppressed every_ms call adds a clock read; neither formats anything.
+    constexpr int throttled_calls = 2000000;
+    std::cout << "Benchmark 11: rate-limited call sites, " << throttled_calls << " calls" << std::endl;
+    {
+        const auto time_calls = [](auto && call) {
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < throttled_calls; ++i) {
+                call(i);
+            }
+            const auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::nano>(end - start).count() / throttled_calls;
+        };
+        std::cout << std::fixed << std::setprecision(1) << "debug, filtered:             " << std::setw(6)
+                  << time_calls([](int i) { log_debug(tt::LogOp, "Polling {} value {}", i, i * 0.5); })
+                  << " ns/call" << std::endl;
+        std::cout << "warning, every 1000000th:    " << std::setw(6) << time_calls([](int i) {
+            log_warning_every_n(tt::LogOp, 1000000, "Polling {} value {}", i, i * 0.5);
+        }) << " ns/call" << std::endl;
+        std::cout << "warning, every 1000 ms:      " << std::setw(6) << time_calls([](int i) {
+            log_warning_every_ms(tt::LogOp, 1000, "Polling {} value {}", i, i * 0.5);
+        }) << " ns/call" << std::endl;
+        std::cout << "warning, written:            " << std::setw(6)
+                  << time_calls([](int i) { log_warning(tt::LogOp, "Polling {} value {}", i, i * 0.5); })
+                  << " ns/call" << std::endl;
+    }
+
+    std::cout << std::endl;
+
+    // Benchmark 12: a retry loop logging the same text. The duplicate filter hashes each formatted message and
+    // writes only the first of the run and a summary.
+    constexpr int repeated_calls = 1000000;
+    std::cout << "Benchmark 12: duplicate message filter, " << repeated_calls << " repeated messages" << std::endl;
+    {
+        const auto path       = (std::filesystem::temp_directory_path() / "tt-logger-benchmark-dedup.log").string();
+        const auto time_calls = [&](const std::shared_ptr<spdlog::sinks::sink> & sink) {
+            spdlog::logger logger("SiliconDriver", sink);
+            const auto     start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repeated_calls; ++i) {
+                logger.log(spdlog::source_loc{ __FILE__, __LINE__, "" }, spdlog::level::warn,
+                           "Retrying read of core {} at {:#x}", 3, 0x1000);
+            }
+            const auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::nano>(end - start).count() / repeated_calls;
+        };
+        for (const bool filtered : { false, true }) {
+            double ns_per_message = 0;
+            {
+                auto file = std::make_shared<spdlog::sinks::basic_file_sink_mt>(path, true);
+                file->set_pattern(tt::plain_pattern);
+                if (filtered) {
+                    auto filter    = std::make_shared<tt::DuplicateFilterSink>(file);
+                    ns_per_message = time_calls(filter);
+                    filter->end_runs();
+                } else {
+                    ns_per_message = time_calls(file);
+                }
+            }
+            std::cout << std::fixed << std::setprecision(1) << (filtered ? "filtered: " : "written:  ") << std::setw(6)
+                      << ns_per_message << " ns/msg, " << std::filesystem::file_size(path) << " bytes written"
+                      << std::endl;
+        }
+        std::filesystem::remove(path);
+    }
+
+    std::cout << std::endl;
+
+    // Benchmark 13: log_trace with Dispatch at trace. Sampling decides with a thread-local random number
+    // before anything is formatted, so a sampled-out call costs little more than a filtered one.
+    constexpr int sampled_calls = 2000000;
+    std::cout << "Benchmark 13: sampled trace messages, " << sampled_calls << " calls" << std::endl;
+    {
+        const auto time_calls = [] {
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < sampled_calls; ++i) {
+                log_trace(tt::LogDispatch, "Dispatched {} value {}", i, i * 0.5);
+            }
+            const auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::nano>(end - start).count() / sampled_calls;
+        };
+        std::cout << std::fixed << std::setprecision(1) << "filtered:           " << std::setw(6) << time_calls()
+                  << " ns/call" << std::endl;
+        registry.set_level(tt::LogDispatch, spdlog::level::trace);
+        registry.set_sample_rates("Dispatch:1000");
+        std::cout << "sampled 1 in 1000:  " << std::setw(6) << time_calls() << " ns/call" << std::endl;
+        registry.set_sample_rates("0");
+        std::cout << "written:            " << std::setw(6) << time_calls() << " ns/call" << std::endl;
+        registry.set_level(tt::LogDispatch, spdlog::level::info);
+    }
+
+    // Benchmark 14: log_info with Dispatch at info. A site switched off by a rule passes the level check and
+    // returns after one more relaxed load, of the state byte in the site's own cache line.
+    constexpr int site_calls = 2000000;
+    std::cout << "Benchmark 14: call sites switched off by a rule, " << site_calls << " calls" << std::endl;
+    {
+        const auto time_calls = [] {
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < site_calls; ++i) {
+                log_info(tt::LogDispatch, "Site rule benchmark {} value {}", i, i * 0.5);
+            }
+            const auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::nano>(end - start).count() / site_calls;
+        };
+        registry.set_level(tt::LogDispatch, spdlog::level::warn);
+        std::cout << std::fixed << std::setprecision(1) << "filtered by level:  " << std::setw(6) << time_calls()
+                  << " ns/call" << std::endl;
+        registry.set_level(tt::LogDispatch, spdlog::level::info);
+        const double written = time_calls();
+        registry.set_site_rules("format 'Site rule benchmark*' -");
+        std::cout << "site switched off:  " << std::setw(6) << time_calls() << " ns/call" << std::endl;
+        std::cout << "written:            " << std::setw(6) << written << " ns/call" << std::endl;
+        registry.set_site_rules("");
+    }
+
+    std::cout << std::endl;
+
+    // Benchmark 15: code at every call site. Only the level check and the site's state stay inline; the
+    // registry lookup, formatting and output are out of line, shared by every site with the same argument
+    // types. The hot loop runs 1024 filtered sites, whose inline code is all that competes for the
+    // instruction cache.
+    constexpr int hot_loops = 20000;
+    std::cout << "Benchmark 15: code size per call site and filtered sites in a hot loop" << std::endl;
+    {
+#if defined(__linux__)
+        // GCC moves the branches to cold code into a "<function>.cold" part of the caller
+        const auto per_site = [](const std::string & one, const std::string & seventeen) {
+            const std::size_t small = function_size(one.c_str()), large = function_size(seventeen.c_str());
+            if (!small || !large) {
+                return std::string("unavailable");
+            }
+            const std::size_t cold =
+                function_size((seventeen + ".cold").c_str()) - function_size((one + ".cold").c_str());
+            return std::to_string((large - small) / 16) + " bytes inline, " + std::to_string(cold / 16) + " bytes cold";
+        };
+        std::cout << "log_info site:        " << per_site("tt_logger_benchmark_sites_1", "tt_logger_benchmark_sites_17")
+                  << std::endl;
+        std::cout << "SPDLOG_LOGGER_INFO:   "
+                  << per_site("tt_logger_benchmark_spdlog_sites_1", "tt_logger_benchmark_spdlog_sites_17") << std::endl;
+#endif
+        spdlog::logger * op_logger = registry.get(tt::LogOp).get();
+        const auto       time_loop = [&](auto && step) {
+            double x = 1.0;
+#if defined(__linux__)
+            ICacheMissCounter misses;
+            if (misses.available()) {
+                misses.start();
+            }
+#endif
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < hot_loops; ++i) {
+                x = step(x);
+            }
+            const auto   end = std::chrono::steady_clock::now();
+            const double ns  = std::chrono::duration<double, std::nano>(end - start).count();
+            std::cout << std::fixed << std::setprecision(1) << std::setw(6) << ns / hot_loops / 1024 << " ns/site";
+#if defined(__linux__)
+            if (misses.available()) {
+                std::cout << ", " << std::setprecision(3) << static_cast<double>(misses.stop()) / hot_loops / 1024
+                          << " L1i misses/site";
+            } else {
+                std::cout << ", L1i misses unavailable";
+            }
+#endif
+            std::cout << std::endl;
+        };
+        registry.set_level(tt::LogOp, spdlog::level::info);
+        std::cout << "log_debug, filtered:  ";
+        time_loop([](double x) { return run_hot_steps(std::make_integer_sequence<int, 64>{}, x); });
+        std::cout << "SPDLOG_LOGGER_DEBUG:  ";
+        time_loop([&](double x) { return run_spdlog_hot_steps(std::make_integer_sequence<int, 64>{}, op_logger, x); });
+    }
+
+    std::cout << std::endl;
+    std::cout << "=== Benchmarks completed ===" << std::endl;
+
+    return 0;
+}
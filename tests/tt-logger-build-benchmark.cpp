@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-build-benchmark.cpp
+ * @brief Build cost of a logging translation unit with tt-logger.hpp against tt-logger-compiled.hpp
+ *
+ * This file contains benchmarks that compare:
+ * - Size of tt-logger-build-sample.cpp after preprocessing, in lines and bytes
+ * - Time to compile it to an object file, with the flags CMake builds it with
+ *
+ * The compiler and sample path are filled in by tests/CMakeLists.txt, which also writes the flags of both
+ * builds of the sample to <sample target>.flags, one argument per line. Built only with
+ * TT_LOGGER_BUILD_COMPILED=ON, and linked with the compiled-header build of the sample so that a missing
+ * symbol of tt-logger::compiled shows up as a link error.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <tt-logger/tt-logger-compiled.hpp>
+
+namespace {
+
+constexpr int compile_runs = 3;
+
+struct Preprocessed {
+    std::size_t lines = 0;
+    std::size_t bytes = 0;
+};
+
+// Arguments of a .flags file, quoted for the shell
+std::string read_flags(const char * target) {
+    std::ifstream file(std::string(TT_LOGGER_BENCHMARK_FLAGS_DIR) + "/" + target + ".flags");
+    std::string   flags;
+    std::string   argument;
+    while (std::getline(file, argument)) {
+        if (argument.empty()) {
+            continue;
+        }
+        flags += " '";
+        for (const char c : argument) {
+            flags += c == '\'' ? std::string("'\\''") : std::string(1, c);
+        }
+        flags += "'";
+    }
+    return flags;
+}
+
+std::string compile_command(const std::string & flags, const char * action) {
+    return std::string(TT_LOGGER_BENCHMARK_CXX) + flags + " " + action + " " + TT_LOGGER_BENCHMARK_SAMPLE;
+}
+
+bool preprocess(const std::string & flags, Preprocessed & result) {
+    FILE * pipe = ::popen(compile_command(flags, "-E").c_str(), "r");
+    if (!pipe) {
+        return false;
+    }
+    char        chunk[65536];
+    std::size_t read = 0;
+    while ((read = std::fread(chunk, 1, sizeof(chunk), pipe)) > 0) {
+        result.bytes += read;
+        for (std::size_t index = 0; index < read; ++index) {
+            result.lines += chunk[index] == '\n';
+        }
+    }
+    return ::pclose(pipe) == 0;
+}
+
+// Average wall time of a compile to an object file, or a negative value when the compiler failed
+double compile_ms(const std::string & flags) {
+    const std::string command = compile_command(flags, "-c -o /dev/null");
+    double            total   = 0.0;
+    for (int run = 0; run < compile_runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        if (std::system(command.c_str()) != 0) {
+            return -1.0;
+        }
+        const auto end = std::chrono::steady_clock::now();
+        total += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    return total / compile_runs;
+}
+
+void run_variant(const char * name, const char * target) {
+    const std::string flags = read_flags(target);
+    Preprocessed preprocessed;
+    if (!preprocess(flags, preprocessed)) {
+        std::cout << name << "preprocessing failed" << std::endl;
+        return;
+    }
+    const double ms = compile_ms(flags);
+    std::cout << name << std::setw(7) << preprocessed.lines << " lines, " << std::setw(6)
+              << preprocessed.bytes / 1024 << " KiB preprocessed, ";
+    if (ms < 0.0) {
+        std::cout << "compile failed" << std::endl;
+    } else {
+        std::cout << std::fixed << std::setprecision(0) << std::setw(5) << ms << " ms to compile" << std::endl;
+    }
+}
+
+}  // namespace
+
+int main() {
+    std::cout << "=== tt-logger Build Benchmarks ===" << std::endl;
+    std::cout << "Compiler: " << TT_LOGGER_BENCHMARK_CXX << std::endl;
+    std::cout << std::endl;
+
+    // Benchmark 1: the same 30 log calls. The full header pulls in spdlog and fmt's formatting code, and
+    // every call instantiates the registry's templates for its argument types; the compiled header needs
+    // fmt/core.h and instantiates only fmt::make_format_args.
+    std::cout << "Benchmark 1: tt-logger-build-sample.cpp, average of " << compile_runs << " compiles" << std::endl;
+    run_variant("tt-logger.hpp:          ", "tt-logger-build-sample");
+    run_variant("tt-logger-compiled.hpp: ", "tt-logger-build-sample-compiled");
+
+    std::cout << std::endl;
+    std::cout << "=== Benchmarks completed ===" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-build-sample.cpp
+ * @brief A translation unit that logs the way a typical source file does, compiled by tt-logger-build-benchmark
+ *
+ * Built against tt-logger.hpp by default and against tt-logger-compiled.hpp with
+ * TT_LOGGER_BUILD_SAMPLE_COMPILED.
+ */
+
+#if TT_LOGGER_BUILD_SAMPLE_COMPILED
+#    include <tt-logger/tt-logger-compiled.hpp>
+#else
+#    include <tt-logger/tt-logger.hpp>
+#endif
+
+#include <cstdint>
+#include <string>
+
+void tt_logger_build_sample(int device, std::uint64_t address, double elapsed, const std::string & name) {
+    log_info(tt::LogType::LogDevice, "Opening device {}", device);
+    log_debug(tt::LogType::LogDevice, "Device {} mapped at {:#x}", device, address);
+    log_info(tt::LogType::LogDevice, "Device {} is {}", device, name);
+    log_warning(tt::LogType::LogDevice, "Device {} firmware is older than expected", device);
+    log_trace(tt::LogType::LogDevice, "Reset sequence on device {} took {:.3f} ms", device, elapsed);
+
+    log_info(tt::LogType::LogLLRuntime, "Loading program {}", name);
+    log_debug(tt::LogType::LogLLRuntime, "Program {} has {} kernels", name, device + 3);
+    log_info(tt::LogType::LogLLRuntime, "Program {} compiled in {:.2f} s", name, elapsed);
+    log_error(tt::LogType::LogLLRuntime, "Kernel {} failed to build", name);
+    log_trace(tt::LogType::LogLLRuntime, "Binary of {} written at {:#x}", name, address);
+
+    log_info(tt::LogType::LogMetal, "Enqueueing {} bytes at {:#x}", address % 4096, address);
+    log_debug(tt::LogType::LogMetal, "Command queue {} has {} entries", device, device * 8);
+    log_warning(tt::LogType::LogMetal, "Command queue {} is {}% full", device, 85);
+    log_info(tt::LogType::LogMetal, "Finished {} in {:.1f} us", name, elapsed * 1000.0);
+    log_critical(tt::LogType::LogMetal, "Command queue {} hung", device);
+
+    log_info(tt::LogType::LogOp, "Running {} on device {}", name, device);
+    log_debug(tt::LogType::LogOp, "{}: grid {}x{}, {} cores", name, 8, 8, 64);
+    log_info(tt::LogType::LogOp, "{} produced a tensor of {} elements", name, address);
+    log_warning(tt::LogType::LogOp, "{} falls back to the host", name);
+    log_trace(tt::LogType::LogOp, "{} arguments: {}, {}, {}", name, device, address, elapsed);
+
+    log_info(tt::LogType::LogAlways, "Run {} started", name);
+    log_info(tt::LogType::LogAlways, "{} devices, {} MB of memory", device + 1, address >> 20);
+    log_error(tt::LogType::LogAlways, "Run {} stopped after {:.1f} s", name, elapsed);
+    log_info(tt::LogType::LogAlways, "Done");
+
+    log_info(tt::LogType::LogSiliconDriver, "Chip {} link {} up", device, device + 1);
+    log_debug(tt::LogType::LogSiliconDriver, "Chip {} TLB {} at {:#x}", device, 4, address);
+    log_warning(tt::LogType::LogSiliconDriver, "Chip {} temperature {:.1f} C", device, elapsed * 10.0);
+    log_error(tt::LogType::LogSiliconDriver, "Chip {} did not answer", device);
+    log_fatal(tt::LogType::LogSiliconDriver, "Chip {} is lost", device);
+}
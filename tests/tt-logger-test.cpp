@@ -10,19 +10,84 @@
  * - Basic logging functionality (info, debug, warning, error, critical)
  * - Format string functionality with various argument types
  * - Log level filtering
+ * - Async logging through the backend thread
+ * - Deferred formatting on the backend thread
+ * - Merging of per-thread buffers
+ * - Writing and decoding the binary log format
+ * - Call-site registration
+ * - Cycle-counter timestamps and their drift against the system clock
+ * - Per-LogType compile-time elimination (LogEmulationDriver is compiled out, see CMakeLists.txt)
+ * - Per-LogType runtime levels
+ * - TT_LOGGER_TYPES parsing and switching types on and off
+ * - Runtime control commands over the control socket
+ * - Levels shared by several processes through shared memory
+ * - Configuration file with rate limits and hot reload
+ * - Rotating file segments by size and by age
+ * - Block-compressed log files and decoding a truncated one
+ * - Splitting the log into files per LogType and group
+ * - Placeholders in log file paths and rank detection
+ * - Flight recorder rings dumped on demand and from a crashing child process
+ * - Backtrace of below-threshold messages written before an error
+ * - Rate-limited log_*_every_n, log_*_first_n and log_*_every_ms call sites
+ * - Folding repeated messages per call site and LogType into "repeated N times" summaries
+ * - Sampling trace and debug messages per LogType with the weight on every written line
+ * - Switching single call sites on and off by file, line, function and format string
+ * - Logging through the tt-logger::compiled library (when built with TT_LOGGER_BUILD_COMPILED=ON)
  */
 
 #include <fmt/ranges.h>  // needed for container formatting
 #include <fmt/std.h>     // needed for filesystem::path formatting
+#include <spdlog/sinks/ostream_sink.h>
+#include <spdlog/sinks/stdout_sinks.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <set>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <tt-logger/tt-logger.hpp>
 #include <vector>
 
+#if TT_LOGGER_HAS_SHARED_LEVELS || TT_LOGGER_HAS_FLIGHT_RECORDER
+#    include <sys/wait.h>
+#endif
+
+#if TT_LOGGER_TEST_COMPILED
+#    include <tt-logger/tt-logger-compiled.hpp>
+
+// Counts how often it is formatted, to check that the compiled entry point formats only messages it writes
+struct CountedArg {
+    static inline int formatted = 0;
+};
+
+template <> struct fmt::formatter<CountedArg> : fmt::formatter<std::string_view> {
+    template <typename FormatContext> auto format(const CountedArg &, FormatContext & ctx) const {
+        ++CountedArg::formatted;
+        return fmt::formatter<std::string_view>::format("counted", ctx);
+    }
+};
+#endif
+
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+// Recurses until the stack runs out, for the flight recorder's crash test. The compiler cannot see that the
+// flag never changes, so it does not warn about infinite recursion.
+volatile bool keep_overflowing = true;
+
+[[gnu::noinline]] int overflow_stack(int depth) {
+    volatile char frame[1024];
+    frame[0] = static_cast<char>(depth);
+    return keep_overflowing ? overflow_stack(depth + 1) + frame[0] : frame[0];
+}
+#endif
+
 int main() {
     std::cout << "=== TT-Logger Simple Test Program ===" << std::endl;
     std::cout << std::endl;
@@ -156,6 +221,960 @@ int main() {
 
     std::cout << std::endl;
     std::cout << "=== Performance tests completed ===" << std::endl;
+    std::cout << std::endl;
+
+    // Test 11: Async logging
+    std::cout << "Test 11: Async logging" << std::endl;
+    std::cout << "Expected: Three async messages in order, followed by enqueued=3 dropped=0" << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    tt::LoggerRegistry::instance().enable_async(16);
+    for (int i = 0; i < 3; ++i) {
+        log_info(tt::LogDispatch, "Async message {}", i);
+    }
+    tt::LoggerRegistry::instance().flush();
+    auto async_stats = tt::LoggerRegistry::instance().async_stats();
+    std::cout << "enqueued=" << async_stats.enqueued << " dropped=" << async_stats.dropped << std::endl;
+    tt::LoggerRegistry::instance().disable_async();
+
+    std::cout << std::endl;
+
+    // Test 12: Deferred formatting
+    std::cout << "Test 12: Deferred formatting" << std::endl;
+    std::cout << "Expected: Same output as tests 2-4, a '[tt-logger] failed to format deferred message' line for a "
+                 "bad format of an argument that cannot be deferred instead of an exception, followed by records=6 "
+                 "eager_records=3"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    tt::LoggerRegistry::instance().enable_deferred();
+    std::string device_name = "formatted";
+    log_info(tt::LogDevice, "Device {} message with number {}", device_name, 123);
+    log_info(tt::LogOp, "Op test with {} parameters and value {}", "multiple", 42);
+    log_info(tt::LogOp, "Deferred {} value {:.2f} flag {}", tt::LogDispatch, 3.14159, true);
+    log_info(tt::LogSiliconDriver, "Opening chip ids: {} with pci ids: {}", chip_ids, pci_ids);
+    log_info(tt::LogOp, "Using path: {}", test_path);
+    try {
+        log_info(tt::LogSiliconDriver, fmt::runtime("Bad chip ids: {:q}"), chip_ids);
+    } catch (const std::exception & e) {
+        std::cout << "Exception from the log call: " << e.what() << std::endl;
+    }
+    tt::LoggerRegistry::instance().flush();
+    auto deferred_stats = tt::LoggerRegistry::instance().deferred_stats();
+    std::cout << "records=" << deferred_stats.records << " eager_records=" << deferred_stats.eager_records
+              << std::endl;
+    tt::LoggerRegistry::instance().disable_deferred();
+
+    std::cout << std::endl;
+
+    // Test 13: Per-thread buffers merged by timestamp
+    std::cout << "Test 13: Per-thread buffers merged by timestamp" << std::endl;
+    std::cout << "Expected: Steps 0-5 in order although each comes from a different thread, followed by "
+                 "reclaimed_buffers=6"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    tt::LoggerRegistry::instance().enable_deferred();
+    for (int step = 0; step < 6; ++step) {
+        std::thread([step] { log_info(tt::LogFabric, "Step {} from its own thread", step); }).join();
+    }
+    tt::LoggerRegistry::instance().flush();
+    for (int attempt = 0; attempt < 100 && tt::LoggerRegistry::instance().deferred_stats().reclaimed_buffers < 6;
+         ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::cout << "reclaimed_buffers=" << tt::LoggerRegistry::instance().deferred_stats().reclaimed_buffers
+              << std::endl;
+    tt::LoggerRegistry::instance().disable_deferred();
+
+    std::cout << std::endl;
+
+    // Test 14: Binary log format
+    std::cout << "Test 14: Binary log format" << std::endl;
+    std::cout << "Expected: Three decoded messages, the first written as text and the other two as typed "
+                 "arguments, followed by records=3 call_sites=3"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    auto binary_path = std::filesystem::temp_directory_path() / "tt-logger-test.ttlog";
+    {
+        auto           binary_sink = std::make_shared<tt::BinarySink>(binary_path.string());
+        spdlog::logger binary_logger("Device", binary_sink);
+        binary_logger.log(spdlog::source_loc{ __FILE__, __LINE__, SPDLOG_FUNCTION }, spdlog::level::info,
+                          "Binary {} message", "text");
+        {
+            tt::DeferredBackend backend(binary_sink);
+            backend.log(binary_logger, spdlog::source_loc{ __FILE__, __LINE__, SPDLOG_FUNCTION }, spdlog::level::info,
+                        "Binary {} value {:.2f} flag {}", device_name, 3.14159, true);
+            backend.log(binary_logger, spdlog::source_loc{ __FILE__, __LINE__, SPDLOG_FUNCTION }, spdlog::level::warn,
+                        "Binary negative {} char {} float {}", -7, 'x', 0.1f);
+        }
+        auto binary_stats = binary_sink->stats();
+
+        std::ifstream       binary_file(binary_path, std::ios::binary);
+        tt::BinaryLogReader reader(binary_file);
+        auto                decoded_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+        decoded_sink->set_pattern(tt::plain_pattern);
+        if (!reader.read([&](const spdlog::details::log_msg & msg) { decoded_sink->log(msg); })) {
+            std::cout << "decode failed: " << reader.error() << std::endl;
+        }
+        std::cout << "records=" << binary_stats.records << " call_sites=" << binary_stats.call_sites << std::endl;
+    }
+    std::filesystem::remove(binary_path);
+
+    std::cout << std::endl;
+
+    // Test 15: Call-site registry
+    std::cout << "Test 15: Call-site registry" << std::endl;
+    std::cout << "Expected: Six messages from two log calls, followed by new_sites=2 and one line per site with "
+                 "its type, level, format string and location"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    const std::size_t sites_before = tt::LoggerRegistry::instance().registered_call_sites().size();
+    for (int i = 0; i < 3; ++i) {
+        log_info(tt::LogTimer, "Site A iteration {}", i);
+        log_warning(tt::LogTimer, "Site B");
+    }
+    auto sites = tt::LoggerRegistry::instance().registered_call_sites();
+    std::cout << "new_sites=" << sites.size() - sites_before << std::endl;
+    for (std::size_t id = sites_before; id < sites.size(); ++id) {
+        const tt::CallSite & site = *sites[id];
+        std::cout << "id=" << site.id << " type=" << tt::logtype_to_string(site.type)
+                  << " level=" << spdlog::level::to_string_view(site.level).data() << " format=\"" << site.format
+                  << "\" at " << std::filesystem::path(site.file).filename().string() << ":" << site.line << " in "
+                  << site.function << std::endl;
+    }
+
+    std::cout << std::endl;
+
+    // Test 16: Cycle-counter timestamps
+    std::cout << "Test 16: Cycle-counter timestamps" << std::endl;
+    std::cout << "Expected: One message with the current time, followed by drift_ok=1 twice (converted time within "
+                 "100 us of the system clock 300 ms after a calibration), then step_ok=1 and rate_ok=1 after a "
+                 "calibration point one hour ahead"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    tt::LoggerRegistry::instance().enable_deferred(tt::DeferredBackend::default_buffer_size,
+                                                   tt::AsyncOverflowPolicy::block, tt::TimestampSource::tsc);
+    log_info(tt::LogTimer, "Timestamped from the cycle counter");
+    tt::LoggerRegistry::instance().disable_deferred();
+
+    tt::TscClock tsc_clock;
+    for (int round = 0; round < 2; ++round) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        const auto   converted = tsc_clock.to_time_point(tt::TscClock::ticks());
+        const auto   actual    = spdlog::log_clock::now();
+        const double drift_us  = std::chrono::duration<double, std::micro>(converted - actual).count();
+        std::cout << "drift_ok=" << (std::abs(drift_us) < 100.0) << std::endl;
+        tsc_clock.recalibrate();
+    }
+
+    // A system clock step of an hour moves the converted time but leaves the tick rate alone
+    {
+        const double        rate        = tsc_clock.ns_per_tick();
+        const std::int64_t  hour_ns     = std::chrono::nanoseconds(std::chrono::hours(1)).count();
+        const std::uint64_t step_ticks  = tt::TscClock::ticks();
+        const std::int64_t  stepped_ns  = tt::detail::system_clock_ns() + hour_ns;
+        tsc_clock.recalibrate(step_ticks, stepped_ns);
+        std::cout << "step_ok=" << (std::llabs(tsc_clock.to_ns(step_ticks) - stepped_ns) < 1000) << std::endl;
+        std::cout << "rate_ok=" << (tsc_clock.ns_per_tick() == rate) << std::endl;
+    }
+
+    std::cout << std::endl;
+
+    // Test 17: Per-LogType compile-time elimination
+    std::cout << "Test 17: Per-LogType compile-time elimination" << std::endl;
+    std::cout << "Expected: No EmulationDriver message and evaluated_args=0, followed by one Dispatch debug message"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    static_assert(!tt::is_compiled_in(tt::LogEmulationDriver, spdlog::level::critical));
+    static_assert(tt::is_compiled_in(tt::LogDispatch, spdlog::level::trace));
+
+    tt::LoggerRegistry::instance().set_level(spdlog::level::trace);
+    int evaluated_args = 0;
+    log_critical(tt::LogEmulationDriver, "This message is compiled out {}", ++evaluated_args);
+    std::cout << "evaluated_args=" << evaluated_args << std::endl;
+    log_debug(tt::LogDispatch, "This debug message is compiled in");
+    tt::LoggerRegistry::instance().set_level(spdlog::level::info);
+
+    std::cout << std::endl;
+
+    // Test 18: Per-LogType runtime levels
+    std::cout << "Test 18: Per-LogType runtime levels" << std::endl;
+    std::cout << "Expected: Dispatch trace and Op info messages, no Device info message, and a warning about "
+                 "'Bogus:debug' on stderr"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    tt::LoggerRegistry::instance().set_levels("Dispatch:trace,Device:warning,Bogus:debug");
+    log_trace(tt::LogDispatch, "Dispatch trace message should be visible");
+    log_info(tt::LogDevice, "Device info message should NOT be visible");
+    log_info(tt::LogOp, "Op info message should be visible");
+    tt::LoggerRegistry::instance().set_levels("info");
+
+    std::cout << std::endl;
+
+    // Test 19: Log type selection
+    std::cout << "Test 19: Log type selection" << std::endl;
+    std::cout << "Expected: Always only, everything but MetalTrace and Verif, Always and Metal (not MetalTrace), "
+                 "the same with 'Bogus' reported; then one Op message after re-enabling"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        const auto describe = [](std::string_view spec) {
+            std::vector<std::string> unknown;
+            const auto               mask = tt::detail::parse_log_type_mask(
+                spec, [&](const char *, std::string_view entry) { unknown.emplace_back(entry); });
+            std::vector<std::string> enabled;
+            for (std::size_t index = 0; index < tt::log_type_names.size(); ++index) {
+                if (mask & tt::detail::log_type_bit(index)) {
+                    enabled.emplace_back(tt::log_type_names[index]);
+                }
+            }
+            const std::string selected = mask == tt::detail::all_log_types ? "All" : fmt::format("{}", enabled);
+            std::cout << "'" << spec << "' -> " << selected
+                      << (unknown.empty() ? "" : fmt::format(" unknown={}", unknown)) << std::endl;
+        };
+        describe("Always");
+        describe("All,-MetalTrace,-Verif");
+        describe("Metal");
+        describe("Metal;Bogus");
+    }
+
+    tt::LoggerRegistry::instance().disable_type(tt::LogOp);
+    log_info(tt::LogOp, "Op message should NOT be visible while Op is disabled");
+    tt::LoggerRegistry::instance().enable_type(tt::LogOp);
+    log_info(tt::LogOp, "Op message should be visible after re-enabling");
+
+    std::cout << std::endl;
+
+#if TT_LOGGER_HAS_CONTROL_SOCKET
+    // Test 20: Control socket
+    std::cout << "Test 20: Control socket" << std::endl;
+    std::cout << "Expected: a regular file at the socket path kept and the socket created with mode 600; ok for "
+                 "set-level and enable-type, then a Fabric debug message; errors for a bad level list and an unknown "
+                 "command; the status line for Fabric; and no Fabric message after disable-type"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        auto &            registry    = tt::LoggerRegistry::instance();
+        const std::string socket_path = tt::default_control_socket_path(::getpid());
+
+        std::ofstream(socket_path) << "not a socket\n";
+        try {
+            registry.enable_control(socket_path);
+        } catch (const std::exception &) {
+        }
+        std::cout << "regular file kept=" << std::filesystem::is_regular_file(socket_path) << std::endl;
+        std::filesystem::remove(socket_path);
+
+        registry.enable_control(socket_path);
+        const auto mode = std::filesystem::status(socket_path).permissions() & std::filesystem::perms::all;
+        std::cout << "socket mode=" << std::oct << static_cast<unsigned>(mode) << std::dec << std::endl;
+
+        const auto send = [&](std::string_view command) {
+            const std::string reply = tt::send_control_command(socket_path, command);
+            std::cout << command << " -> " << reply.substr(0, reply.find('\n')) << std::endl;
+            return reply;
+        };
+        log_debug(tt::LogFabric, "Fabric debug message should NOT be visible");
+        send("set-level Fabric:debug");
+        send("enable-type Fabric");
+        log_debug(tt::LogFabric, "Fabric debug message should be visible");
+        send("set-level Fabric:loud");
+        send("reboot");
+        const std::string status = send("status");
+        const std::size_t fabric = status.find("Fabric");
+        std::cout << status.substr(fabric, status.find('\n', fabric) - fabric) << std::endl;
+        send("disable-type Fabric");
+        log_debug(tt::LogFabric, "Fabric debug message should NOT be visible after disable-type");
+        send("flush");
+
+        registry.disable_control();
+        registry.enable_type(tt::LogFabric);
+        registry.set_level(tt::LogFabric, spdlog::level::info);
+        std::cout << "socket removed=" << !std::filesystem::exists(socket_path) << std::endl;
+    }
+
+    std::cout << std::endl;
+#endif
+
+#if TT_LOGGER_HAS_SHARED_LEVELS
+    // Test 21: Shared levels across processes
+    std::cout << "Test 21: Shared levels across processes" << std::endl;
+    std::cout << "Expected: 3 of 3 child processes see Fabric switch from info to debug, then one Fabric debug "
+                 "message while this process is attached and none after detaching"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        auto &            registry = tt::LoggerRegistry::instance();
+        const std::string job_id   = "tt-logger-test-" + std::to_string(::getpid());
+        constexpr int     children = 3;
+
+        // Each child attaches, reports in through the pipe and waits for the writer below to raise Fabric to debug
+        int ready[2];
+        if (::pipe(ready) != 0) {
+            std::perror("pipe");
+            return 1;
+        }
+        std::cout << std::flush;
+        std::vector<pid_t> pids;
+        for (int child = 0; child < children; ++child) {
+            const pid_t pid = ::fork();
+            if (pid == 0) {
+                registry.attach_shared_levels(job_id);
+                const bool was_info = !tt::should_log(tt::LogFabric, spdlog::level::debug);
+                const char byte     = 1;
+                (void) !::write(ready[1], &byte, 1);
+                const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+                while (!tt::should_log(tt::LogFabric, spdlog::level::debug) &&
+                       std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                ::_exit(was_info && tt::should_log(tt::LogFabric, spdlog::level::debug) ? 0 : 1);
+            }
+            pids.push_back(pid);
+        }
+        for (int child = 0; child < children; ++child) {
+            char byte;
+            (void) !::read(ready[0], &byte, 1);
+        }
+        ::close(ready[0]);
+        ::close(ready[1]);
+
+        tt::SharedLevelsWriter<tt::log_type_names.size()>(job_id).set(tt::LogFabric, SPDLOG_LEVEL_DEBUG);
+
+        int saw_debug = 0;
+        for (const pid_t pid : pids) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            saw_debug += WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+        std::cout << "children that saw Fabric debug: " << saw_debug << "/" << children << std::endl;
+
+        registry.attach_shared_levels(job_id);
+        log_debug(tt::LogFabric, "Fabric debug message should be visible while attached");
+        registry.detach_shared_levels();
+        log_debug(tt::LogFabric, "Fabric debug message should NOT be visible after detaching");
+        tt::remove_shared_levels(job_id);
+    }
+
+    std::cout << std::endl;
+#endif
+
+#if TT_LOGGER_HAS_CONFIG_WATCH
+    // Test 22: Configuration file hot reload
+    std::cout << "Test 22: Configuration file hot reload" << std::endl;
+    std::cout << "Expected: 2 of 5 Op messages (rate_limit Op:2) and a warning about 'bogus' on stderr, then after "
+                 "the file is replaced a Fabric debug message in the '[Fabric] ...' pattern"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        auto &                      registry    = tt::LoggerRegistry::instance();
+        const std::filesystem::path config_path = std::filesystem::temp_directory_path() /
+                                                  ("tt-logger-test-" + std::to_string(::getpid()) + ".conf");
+        const auto write_config = [&](const std::string & text) {
+            // Written next to the file and renamed over it, like most editors do
+            const auto temporary = config_path.string() + ".tmp";
+            std::ofstream(temporary) << text;
+            std::filesystem::rename(temporary, config_path);
+        };
+
+        write_config("# Test configuration\nlevel = info\nrate_limit = Op:2\nbogus = 1\n");
+        registry.load_config(config_path.string());
+        for (int i = 0; i < 5; ++i) {
+            log_info(tt::LogOp, "Op message {} within the rate limit", i);
+        }
+
+        write_config("level = info,Fabric:debug\npattern = [%n] %v\n");
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!tt::should_log(tt::LogFabric, spdlog::level::debug) && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        log_debug(tt::LogFabric, "Fabric debug message after the reload");
+
+        registry.unload_config();
+        std::filesystem::remove(config_path);
+    }
+
+    std::cout << std::endl;
+#endif
+
+    // Test 23: Rotating file sink
+    std::cout << "Test 23: Rotating file sink" << std::endl;
+    std::cout << "Expected: 100 messages of 57 bytes in 1 KiB segments fill run.0.log to run.5.log, a message 2 s "
+                 "after the first starts run.6.log (1 s interval), and the 7 files hold all 5726 bytes"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        const std::filesystem::path directory =
+            std::filesystem::temp_directory_path() / ("tt-logger-rotate-" + std::to_string(::getpid()));
+        std::filesystem::create_directories(directory);
+        const std::string filename = (directory / "run.log").string();
+
+        tt::RotationPolicy policy;
+        policy.max_size = 1024;
+        policy.interval = std::chrono::seconds(1);
+        {
+            auto sink = std::make_shared<tt::RotatingFileSink>(filename, policy);
+            sink->set_pattern("%v");
+            spdlog::logger logger("Rotate", sink);
+
+            const auto start = spdlog::log_clock::now();
+            for (int i = 0; i < 100; ++i) {
+                logger.info("Rotating message {:3} with some padding to fill a segment", i);
+            }
+            std::cout << "After 100 messages: rotations = " << sink->stats().rotations << ", writing "
+                      << std::filesystem::path(sink->current_path()).filename() << std::endl;
+
+            const spdlog::details::log_msg late(start + std::chrono::seconds(2), spdlog::source_loc{}, "Rotate",
+                                                spdlog::level::info, "Message two seconds later");
+            sink->log(late);
+            std::cout << "After the late message: rotations = " << sink->stats().rotations << ", writing "
+                      << std::filesystem::path(sink->current_path()).filename() << std::endl;
+        }
+
+        // The sink is gone, so every segment is closed and trimmed to what was written
+        std::size_t files = 0;
+        std::size_t bytes = 0;
+        for (const auto & entry : std::filesystem::directory_iterator(directory)) {
+            ++files;
+            bytes += entry.file_size();
+        }
+        std::cout << "Segment files: " << files << ", total bytes: " << bytes << std::endl;
+        std::filesystem::remove_all(directory);
+    }
+
+    std::cout << std::endl;
+
+#if TT_LOGGER_HAS_COMPRESSION
+    // Test 24: Compressed file sink
+    std::cout << "Test 24: Compressed file sink" << std::endl;
+    std::cout << "Expected: 1000 lines in 4 KiB blocks decode in full; the same file cut inside its last block "
+                 "decodes every block but that one and reports the truncation"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        const std::filesystem::path path =
+            std::filesystem::temp_directory_path() / ("tt-logger-test-" + std::to_string(::getpid()) + ".log.gz");
+        tt::CompressionStats stats;
+        {
+            auto sink = std::make_shared<tt::CompressedFileSink>(path.string(), 4096);
+            sink->set_pattern("%v");
+            spdlog::logger logger("Compressed", sink);
+            for (int i = 0; i < 1000; ++i) {
+                logger.info("Compressed message {:4} of a repetitive run", i);
+            }
+            logger.flush();
+            stats = sink->stats();
+        }
+        std::cout << "Blocks: " << stats.blocks << ", " << stats.input_bytes << " bytes compressed to "
+                  << stats.output_bytes << " (" << std::fixed << std::setprecision(1) << stats.ratio() << "x)"
+                  << std::endl;
+
+        std::ifstream     file(path, std::ios::binary);
+        const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        const auto        count_lines = [](const std::string & text) {
+            return std::count(text.begin(), text.end(), '\n');
+        };
+
+        const tt::DecompressedLog whole = tt::decompress_log(data);
+        std::cout << "Whole file: " << whole.blocks << " blocks, " << count_lines(whole.text)
+                  << " lines, truncated: " << (whole.truncated ? "yes" : "no") << std::endl;
+
+        const tt::DecompressedLog cut = tt::decompress_log(std::string_view(data).substr(0, data.size() - 10));
+        std::cout << "Cut file: " << cut.blocks << " blocks, " << count_lines(cut.text)
+                  << " lines, truncated: " << (cut.truncated ? "yes" : "no")
+                  << ", last line: " << cut.text.substr(cut.text.rfind('\n', cut.text.size() - 2) + 1);
+        std::filesystem::remove(path);
+    }
+
+    std::cout << std::endl;
+#endif
+
+    // Test 25: Files per LogType
+    std::cout << "Test 25: Files per LogType" << std::endl;
+    std::cout << "Expected: run.log.gz becomes run-{type}.log.gz; Device and SiliconDriver share io.log, Op gets "
+                 "Op.log, and no file exists for types that did not log"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        std::cout << "Template: " << tt::per_type_path_template("logs/run.log.gz") << std::endl;
+
+        const auto files = tt::detail::parse_log_type_files(
+            "Device:io,SiliconDriver:io,Bogus:x", [](const char * problem, std::string_view entry) {
+                std::cout << "Rejected: " << entry << " (" << problem << ")" << std::endl;
+            });
+        std::vector<std::pair<std::string, std::string>> routes;
+        for (std::size_t index = 0; index < files.size(); ++index) {
+            routes.emplace_back(tt::log_type_names[index], files[index]);
+        }
+
+        const std::filesystem::path directory =
+            std::filesystem::temp_directory_path() / ("tt-logger-split-" + std::to_string(::getpid()));
+        std::filesystem::create_directories(directory);
+        const std::string path_template = (directory / "{type}.log").string();
+        {
+            auto sink = std::make_shared<tt::SplitSink>(routes, "Always", [&](const std::string & name) {
+                return std::make_shared<spdlog::sinks::basic_file_sink_mt>(
+                    tt::expand_type_placeholder(path_template, name), true);
+            });
+            sink->set_pattern("%n %v");
+            std::vector<std::thread> threads;
+            for (const char * name : { "Device", "SiliconDriver", "Op" }) {
+                threads.emplace_back([&sink, name] {
+                    spdlog::logger logger(name, sink);
+                    for (int i = 0; i < 100; ++i) {
+                        logger.info("message {}", i);
+                    }
+                });
+            }
+            for (auto & thread : threads) {
+                thread.join();
+            }
+        }
+
+        std::set<std::string> names;
+        for (const auto & entry : std::filesystem::directory_iterator(directory)) {
+            std::ifstream file(entry.path());
+            std::string   line;
+            std::size_t   lines = 0;
+            while (std::getline(file, line)) {
+                ++lines;
+            }
+            names.insert(entry.path().filename().string() + ": " + std::to_string(lines) + " lines");
+        }
+        for (const auto & name : names) {
+            std::cout << name << std::endl;
+        }
+        std::filesystem::remove_all(directory);
+    }
+
+    std::cout << std::endl;
+
+    // Test 26: Log file path placeholders
+    std::cout << "Test 26: Log file path placeholders" << std::endl;
+    std::cout << "Expected: logs/node7-rank3-4242-{type}-{nope}.log with {nope} reported, logs/{host}-{pid}.log "
+                 "without a host or pid, rank 3 taken from SLURM_PROCID, and the pid field matching this process"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        tt::LogPathFields fields;
+        fields.pid  = "4242";
+        fields.host = "node7";
+        fields.rank = "3";
+        std::cout << tt::expand_log_path("logs/{host}-rank{rank}-{pid}-{type}-{nope}.log", fields,
+                                         [](const char * problem, std::string_view placeholder) {
+                                             std::cout << "Kept " << problem << " " << placeholder << std::endl;
+                                         })
+                  << std::endl;
+        std::cout << tt::expand_log_path("logs/{host}-{pid}.log", tt::LogPathFields{},
+                                         [](const char * problem, std::string_view placeholder) {
+                                             std::cout << "Kept " << problem << " " << placeholder << std::endl;
+                                         })
+                  << std::endl;
+
+        const char *      previous = std::getenv("SLURM_PROCID");
+        const std::string saved    = previous ? previous : "";
+        setenv("SLURM_PROCID", "3", 1);
+        std::cout << "Detected rank: " << tt::detect_rank() << std::endl;
+        if (previous) {
+            setenv("SLURM_PROCID", saved.c_str(), 1);
+        } else {
+            unsetenv("SLURM_PROCID");
+        }
+
+        const auto current = tt::LogPathFields::current();
+        std::cout << "Current pid matches: " << (current.pid == std::to_string(::getpid()) ? "yes" : "no")
+                  << ", time has 15 characters: " << (current.time.size() == 15 ? "yes" : "no") << std::endl;
+    }
+
+    std::cout << std::endl;
+
+#if TT_LOGGER_HAS_FLIGHT_RECORDER
+    // Test 27: Flight recorder
+    std::cout << "Test 27: Flight recorder" << std::endl;
+    std::cout << "Expected: only the info message is printed; the dump holds about 100 of the 202 messages of the "
+                 "main thread (a 4 KiB ring), ending with the Dispatch trace message, and all 50 of the worker; "
+                 "children killed by SIGABRT and by a stack overflow leave dumps ending with their last message"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        auto &                      registry  = tt::LoggerRegistry::instance();
+        const std::filesystem::path dump_path = std::filesystem::temp_directory_path() / "tt-logger-flight-{pid}.ttlog";
+        registry.enable_flight_recorder("debug,Dispatch:trace", dump_path.string(), 4096);
+
+        const std::size_t main_thread = spdlog::details::os::thread_id();
+        log_info(tt::LogOp, "Info message printed and recorded");
+        for (int i = 0; i < 200; ++i) {
+            log_debug(tt::LogOp, "Recorded debug message {} of {}", i, "main");
+        }
+        std::thread([] {
+            for (int i = 0; i < 50; ++i) {
+                log_debug(tt::LogDevice, "Recorded debug message {} of {}", i, "worker");
+            }
+        }).join();
+        log_trace(tt::LogDispatch, "Recorded Dispatch trace message");
+        log_trace(tt::LogOp, "Op trace message neither printed nor recorded");
+
+        // Decodes a dump and summarizes the messages of each thread
+        const auto summarize = [&](const std::string & path) {
+            std::ifstream       file(path, std::ios::binary);
+            tt::BinaryLogReader reader(file);
+            std::size_t         main_count = 0, other_count = 0;
+            std::string         main_last, other_last;
+            if (!reader.read([&](const spdlog::details::log_msg & msg) {
+                    std::string text(msg.payload.data(), msg.payload.size());
+                    if (msg.thread_id == main_thread) {
+                        ++main_count;
+                        main_last = std::move(text);
+                    } else {
+                        ++other_count;
+                        other_last = std::move(text);
+                    }
+                })) {
+                std::cout << "decode failed: " << reader.error() << std::endl;
+            }
+            std::cout << "main thread: " << main_count << " messages, last '" << main_last << "'; other threads: "
+                      << other_count << " messages, last '" << other_last << "'" << std::endl;
+        };
+
+        const std::string on_demand = (std::filesystem::temp_directory_path() / "tt-logger-test-dump.ttlog").string();
+        std::cout << "dump written: " << (registry.dump_flight_recorder(on_demand) ? "yes" : "no") << std::endl;
+        summarize(on_demand);
+        std::filesystem::remove(on_demand);
+
+        // The child's dump goes to the path expanded with this process's pid, which it inherits
+        std::cout << std::flush;
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            log_debug(tt::LogOp, "Child debug message before the abort");
+            std::abort();
+        }
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        const bool aborted = WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+        std::cout << "child killed by SIGABRT: " << (aborted ? "yes" : "no") << std::endl;
+        const auto        ignore     = [](const char *, std::string_view) {};
+        const std::string crash_dump = tt::expand_log_path(dump_path.string(), tt::LogPathFields::current(), ignore);
+        summarize(crash_dump);
+        std::filesystem::remove(crash_dump);
+
+        // The handler runs on the alternate stack installed with the thread's ring
+        std::cout << std::flush;
+        const pid_t overflow_pid = ::fork();
+        if (overflow_pid == 0) {
+            log_debug(tt::LogOp, "Child debug message before the stack overflow");
+            overflow_stack(0);
+            std::_Exit(0);
+        }
+        ::waitpid(overflow_pid, &status, 0);
+        const bool overflowed = WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV;
+        std::cout << "child killed by SIGSEGV: " << (overflowed ? "yes" : "no") << std::endl;
+        summarize(crash_dump);
+        std::filesystem::remove(crash_dump);
+
+        registry.enable_flight_recorder("off");
+    }
+
+    std::cout << std::endl;
+#endif
+
+    // Test 28: Backtrace on error
+    std::cout << "Test 28: Backtrace on error" << std::endl;
+    std::cout << "Expected: the Op info message, then a backtrace of Op debug messages 2 to 4 right before the Op "
+                 "error; the second Op error and the Device error come without one, and nothing is printed after "
+                 "the backtrace is turned off"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        auto & registry = tt::LoggerRegistry::instance();
+        registry.enable_backtrace("Op:debug", 3);
+        for (int i = 0; i < 5; ++i) {
+            log_debug(tt::LogOp, "Op debug message {} kept for the backtrace", i);
+        }
+        log_trace(tt::LogOp, "Op trace message below the backtrace level");
+        log_debug(tt::LogDevice, "Device debug message not kept");
+        log_info(tt::LogOp, "Op info message printed as usual");
+        log_error(tt::LogOp, "Op error message after its backtrace");
+        log_error(tt::LogOp, "Op error message with nothing left to write");
+        log_error(tt::LogDevice, "Device error message without a backtrace");
+
+        registry.enable_backtrace("off");
+        log_debug(tt::LogOp, "Op debug message dropped");
+        log_error(tt::LogOp, "Op error message after the backtrace is turned off");
+    }
+
+    std::cout << std::endl;
+
+    // Test 29: Rate-limited call sites
+    std::cout << "Test 29: Rate-limited call sites" << std::endl;
+    std::cout << "Expected: every_n prints calls 0, 4 and 8, the last two with 3 suppressed, and evaluates its "
+                 "arguments 3 times; first_n prints calls 0 and 1; every_ms prints its first call and the one "
+                 "after the pause with 2 suppressed; the plain message is printed with 1 suppressed the second time"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        int        evaluated = 0;
+        const auto argument  = [&](int i) {
+            ++evaluated;
+            return i;
+        };
+        for (int i = 0; i < 10; ++i) {
+            log_warning_every_n(tt::LogOp, 4, "every_n call {}", argument(i));
+        }
+        std::cout << "every_n arguments evaluated: " << evaluated << " times" << std::endl;
+        for (int i = 0; i < 5; ++i) {
+            log_info_first_n(tt::LogOp, 2, "first_n call {}", i);
+        }
+        for (int i = 0; i < 4; ++i) {
+            if (i == 3) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(60));
+            }
+            log_info_every_ms(tt::LogOp, 50, "every_ms call {}", i);
+        }
+        for (int i = 0; i < 3; ++i) {
+            log_info_every_n(tt::LogOp, 2, "Plain every_n message");
+        }
+    }
+
+    std::cout << std::endl;
+
+    // Test 30: Duplicate message filter
+    std::cout << "Test 30: Duplicate message filter" << std::endl;
+    std::cout << "Expected: 0x10 once, then 'repeated 999 times' before 0x20; Fabric prints the same text from the "
+                 "same site; the interleaved sites print once each; after 50 ms the timer summarizes lines 1, 2 "
+                 "and 3 with 2, 1 and 2 repeats; end_runs() summarizes the last repeat of line 3; 1005 suppressed"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        auto stdout_sink = std::make_shared<spdlog::sinks::stdout_sink_mt>();
+        stdout_sink->set_pattern("%n | %l | %v (line %#)");
+        auto filter = std::make_shared<tt::DuplicateFilterSink>(stdout_sink, std::chrono::milliseconds(50));
+        spdlog::logger silicon_driver("SiliconDriver", filter);
+        spdlog::logger fabric("Fabric", filter);
+        const spdlog::source_loc retry_site{ __FILE__, 1, "" }, other_site{ __FILE__, 2, "" },
+            polling_site{ __FILE__, 3, "" };
+
+        for (int i = 0; i < 1000; ++i) {
+            silicon_driver.log(retry_site, spdlog::level::warn, "Retrying read of 0x10");
+        }
+        silicon_driver.log(retry_site, spdlog::level::warn, "Retrying read of 0x20");
+        fabric.log(retry_site, spdlog::level::warn, "Retrying read of 0x20");
+        for (int i = 0; i < 2; ++i) {
+            silicon_driver.log(retry_site, spdlog::level::warn, "Retrying read of 0x20");
+            silicon_driver.log(other_site, spdlog::level::info, "Waiting for the link");
+        }
+        for (int i = 0; i < 3; ++i) {
+            silicon_driver.log(polling_site, spdlog::level::info, "Polling core (1,2)");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        silicon_driver.log(polling_site, spdlog::level::info, "Polling core (1,2)");
+        filter->end_runs();
+        std::cout << "Suppressed: " << filter->suppressed() << std::endl;
+    }
+
+    std::cout << std::endl;
+
+    // Test 31: Sampling trace and debug messages
+    std::cout << "Test 31: Sampling trace and debug messages" << std::endl;
+    std::cout << "Expected: about 100 of 100000 Dispatch trace messages written, each with sample_weight=1000, and "
+                 "their weights adding up to within 30% of 100000; all 10 Dispatch info and Op trace messages "
+                 "written without a weight; everything written again once sampling is off"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        auto & registry = tt::LoggerRegistry::instance();
+        registry.set_levels("Dispatch:trace,Op:trace");
+        registry.set_sample_rates("Dispatch:1000");
+
+        // Captures what the two loggers write
+        std::ostringstream captured;
+        auto               capture = std::make_shared<spdlog::sinks::ostream_sink_mt>(captured);
+        capture->set_pattern("%n %l %v");
+        const auto dispatch_sinks = registry.get(tt::LogDispatch)->sinks();
+        const auto op_sinks       = registry.get(tt::LogOp)->sinks();
+        registry.get(tt::LogDispatch)->sinks().assign(1, capture);
+        registry.get(tt::LogOp)->sinks().assign(1, capture);
+
+        const auto count_lines = [&](std::string_view prefix, std::uint64_t & weights) {
+            std::istringstream lines(captured.str());
+            std::string        line;
+            std::size_t        count = 0;
+            weights                  = 0;
+            while (std::getline(lines, line)) {
+                if (line.compare(0, prefix.size(), prefix) == 0) {
+                    ++count;
+                    const std::size_t weight = line.find("[sample_weight=");
+                    weights += weight == std::string::npos ? 1 : std::stoull(line.substr(weight + 15));
+                }
+            }
+            return count;
+        };
+
+        for (int i = 0; i < 100000; ++i) {
+            log_trace(tt::LogDispatch, "Dispatch trace message {}", i);
+        }
+        for (int i = 0; i < 10; ++i) {
+            log_info(tt::LogDispatch, "Dispatch info message {}", i);
+            log_trace(tt::LogOp, "Op trace message {}", i);
+        }
+        std::uint64_t      weights = 0;
+        const std::size_t  sampled = count_lines("Dispatch trace", weights);
+        const std::int64_t error   = static_cast<std::int64_t>(weights) - 100000;
+        std::cout << "Dispatch trace: " << (sampled > 50 && sampled < 150 ? "about 100" : std::to_string(sampled))
+                  << " lines, weights within 30%: " << (std::abs(error) < 30000 ? "yes" : "no") << std::endl;
+        std::cout << "Dispatch info: " << count_lines("Dispatch info", weights) << " lines, weights " << weights
+                  << std::endl;
+        std::cout << "Op trace: " << count_lines("Op trace", weights) << " lines, weights " << weights << std::endl;
+
+        registry.set_sample_rates("0");
+        captured.str("");
+        for (int i = 0; i < 1000; ++i) {
+            log_trace(tt::LogDispatch, "Dispatch trace message {}", i);
+        }
+        std::cout << "Dispatch trace without sampling: " << count_lines("Dispatch trace", weights) << " lines"
+                  << std::endl;
+
+        registry.get(tt::LogDispatch)->sinks() = dispatch_sinks;
+        registry.get(tt::LogOp)->sinks()       = op_sinks;
+        registry.set_levels("info");
+    }
+
+    std::cout << std::endl;
+
+    // Test 32: Call site rules
+    std::cout << "Test 32: Call site rules" << std::endl;
+    std::cout << "Expected: with Fabric at info, the 'Retrying' site switched off, the 'Queue depth' debug site "
+                 "forced on and the 'Link up' site switched off by its line, only 3 'Queue depth' lines written and "
+                 "the three sites listed as -, - and +; with the rules cleared 3 'Retrying' and 3 'Link up' lines "
+                 "written and no 'Queue depth' line; a '+' rule without a type rejected"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        auto & registry = tt::LoggerRegistry::instance();
+        registry.set_levels("Fabric:info");
+
+        std::ostringstream captured;
+        auto               capture = std::make_shared<spdlog::sinks::ostream_sink_mt>(captured);
+        capture->set_pattern("%l %v");
+        const auto fabric_sinks = registry.get(tt::LogFabric)->sinks();
+        registry.get(tt::LogFabric)->sinks().assign(1, capture);
+
+        int        link_line = 0;
+        const auto run_link  = [&] {
+            for (int i = 0; i < 3; ++i) {
+                log_info(tt::LogFabric, "Retrying send {}", i);
+                log_debug(tt::LogFabric, "Queue depth {}", i);
+                link_line = __LINE__ + 1;
+                log_info(tt::LogFabric, "Link up {}", i);
+            }
+        };
+        run_link();  // Registers the info sites; the debug one registers once its rule lets it through
+        registry.set_site_rules(fmt::format("format 'Retrying*' -; type Fabric format 'Queue depth*' +; "
+                                            "file tt-logger-test.cpp line {} -",
+                                            link_line));
+        captured.str("");
+        run_link();
+        std::cout << captured.str();
+        for (const tt::CallSite * site : registry.registered_call_sites()) {
+            if (site->type == tt::LogFabric && site->line >= link_line - 3 && site->line <= link_line) {
+                std::cout << "Site '" << site->format << "': " << "-=+"[site->state.load()] << std::endl;
+            }
+        }
+
+        registry.set_site_rules("");
+        captured.str("");
+        run_link();
+        std::cout << "Without rules:" << std::endl << captured.str();
+
+        // Debug sites have not logged at info, so a "+" rule needs the type to know of them
+        const auto untyped = tt::detail::parse_site_rules(
+            "format 'Queue depth*' +", [](const char * problem, std::string_view rule) {
+                std::cout << "Rejected: " << problem << " '" << rule << "'" << std::endl;
+            });
+        std::cout << "Untyped rules kept: " << untyped.size() << std::endl;
+
+        registry.get(tt::LogFabric)->sinks() = fabric_sinks;
+        registry.set_levels("info");
+    }
+
+    std::cout << std::endl;
+
+#if TT_LOGGER_TEST_COMPILED
+    // Test 33: Compiled library entry point
+    std::cout << "Test 33: Compiled library entry point" << std::endl;
+    std::cout << "Expected: with Fabric at info, tt::compiled::should_log agrees with tt::should_log; 'info Link 2 "
+                 "of 4 up', 'warning Raw {} text' and 'error Bad {:d} format' written and the debug message not; "
+                 "a debug message below the level and 20 sampled out at Fabric:debug formatted 0 times, one at "
+                 "info once"
+              << std::endl;
+    std::cout << "Actual output:" << std::endl;
+
+    {
+        auto & registry = tt::LoggerRegistry::instance();
+        registry.set_levels("Fabric:info");
+
+        std::ostringstream captured;
+        auto               capture = std::make_shared<spdlog::sinks::ostream_sink_mt>(captured);
+        capture->set_pattern("%l %v");
+        const auto fabric_sinks = registry.get(tt::LogFabric)->sinks();
+        registry.get(tt::LogFabric)->sinks().assign(1, capture);
+
+        bool agree = true;
+        for (int level = SPDLOG_LEVEL_TRACE; level <= SPDLOG_LEVEL_CRITICAL; ++level) {
+            agree = agree && tt::compiled::should_log(tt::LogFabric, level) ==
+                                 tt::should_log(tt::LogFabric, static_cast<spdlog::level::level_enum>(level));
+        }
+        std::cout << "should_log agrees: " << (agree ? "yes" : "no") << std::endl;
+
+        for (int level : { SPDLOG_LEVEL_INFO, SPDLOG_LEVEL_DEBUG }) {
+            if (tt::compiled::should_log(tt::LogFabric, level)) {
+                tt::compiled::log(tt::LogFabric, level, __FILE__, __LINE__, "main", "Link {} of {} {}", level, 4,
+                                  level == SPDLOG_LEVEL_INFO ? "up" : "down");
+            }
+        }
+        tt::compiled::log(tt::LogFabric, SPDLOG_LEVEL_WARN, __FILE__, __LINE__, "main", "Raw {} text");
+        tt::compiled::vlog(tt::LogFabric, SPDLOG_LEVEL_ERROR, __FILE__, __LINE__, "main", "Bad {:d} format",
+                           fmt::make_format_args("text"));
+        std::cout << captured.str();
+
+        const CountedArg counted;
+        tt::compiled::log(tt::LogFabric, SPDLOG_LEVEL_DEBUG, __FILE__, __LINE__, "main", "Below {}", counted);
+        registry.set_levels("Fabric:debug");
+        registry.set_sample_rates("Fabric:1000000");
+        for (int call = 0; call < 20; ++call) {
+            tt::compiled::log(tt::LogFabric, SPDLOG_LEVEL_DEBUG, __FILE__, __LINE__, "main", "Sampled {}", counted);
+        }
+        registry.set_sample_rates("Fabric:0");
+        const int skipped = CountedArg::formatted;
+        tt::compiled::log(tt::LogFabric, SPDLOG_LEVEL_INFO, __FILE__, __LINE__, "main", "Written {}", counted);
+        std::cout << "Formatted when skipped: " << skipped << ", when written: " << CountedArg::formatted - skipped
+                  << std::endl;
+
+        registry.get(tt::LogFabric)->sinks() = fabric_sinks;
+        registry.set_levels("info");
+    }
+
+    std::cout << std::endl;
+#endif
 
     std::cout << "=== All tests completed ===" << std::endl;
 
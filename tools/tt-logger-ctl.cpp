@@ -0,0 +1,160 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-ctl.cpp
+ * @brief Changes the log configuration of a running process over its control socket
+ *
+ * Usage: tt-logger-ctl (--pid PID | --socket PATH) COMMAND [ARGS...]
+ *        tt-logger-ctl --job ID (set-level LEVELS | status | remove)
+ *
+ * The target process must have been started with TT_LOGGER_CONTROL_SOCKET set: to 1 for the default
+ * socket path derived from its pid, or to an explicit path. Without --pid or --socket the path is taken
+ * from TT_LOGGER_CONTROL_SOCKET in the environment. Commands:
+ *
+ *   set-level LEVELS        Level list in TT_LOGGER_LEVEL syntax, e.g. "Fabric:debug" or "warning"
+ *   enable-type TYPES       Switch categories on, e.g. "Fabric,Op"
+ *   disable-type TYPES      Switch categories off
+ *   set-sampling RATES      Write 1 in N trace and debug messages, e.g. "Dispatch:1000"; 0 for all
+ *   set-sites RULES         Switch call sites on or off in TT_LOGGER_SITES syntax, e.g.
+ *                           "type Dispatch file dispatch.cpp line 100-200 +; func *poll* -"
+ *   list-sites              Print every call site that has logged, with its state (+, - or =)
+ *   flush                   Write out everything logged so far
+ *   dump-recorder [PATH]    Write the flight recorder to PATH, or to its crash dump file; a relative
+ *                           PATH is relative to the working directory of the process
+ *   status                  Print the level and sampling rate of every category
+ *
+ * With --job the command applies to every process of a job started with TT_LOGGER_SHARED_LEVELS=ID by
+ * writing the job's shared level table directly. Only set-level and status are available there, plus
+ * remove, which deletes the table once the job is over.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <tt-logger/tt-logger.hpp>
+
+namespace {
+
+int usage() {
+    std::cerr << "Usage: tt-logger-ctl (--pid PID | --socket PATH) COMMAND [ARGS...]\n"
+                 "       tt-logger-ctl --job ID (set-level LEVELS | status | remove)\n"
+                 "Commands: set-level LEVELS, enable-type TYPES, disable-type TYPES, set-sampling RATES,\n"
+                 "          set-sites RULES, list-sites, flush, dump-recorder [PATH], status"
+              << std::endl;
+    return 2;
+}
+
+// Runs a command against a job's shared level table
+int run_shared(const std::string & job_id, const std::string & command, const std::string & argument) {
+    constexpr std::size_t type_count = tt::log_type_names.size();
+    if (command == "remove") {
+        if (!tt::remove_shared_levels(job_id)) {
+            std::cerr << "tt-logger-ctl: cannot remove shared levels of job '" << job_id
+                      << "': " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (command != "set-level" && command != "status") {
+        std::cerr << "tt-logger-ctl: only set-level, status and remove are available with --job" << std::endl;
+        return 2;
+    }
+
+    bool       valid   = true;
+    const auto invalid = [&](const char * problem, std::string_view entry) {
+        std::cerr << "tt-logger-ctl: " << problem << " '" << entry << "'" << std::endl;
+        valid = false;
+    };
+    const tt::detail::LogTypeLevels levels = tt::detail::parse_log_type_levels(argument, -1, invalid);
+    if (!valid || (command == "set-level" && argument.empty())) {
+        return 1;
+    }
+
+    try {
+        tt::SharedLevelsWriter<type_count> writer(job_id);
+        for (std::size_t index = 0; index < type_count; ++index) {
+            if (levels[index] >= 0) {
+                writer.set(index, static_cast<std::uint8_t>(levels[index]));
+            }
+        }
+        std::cout << "ok" << std::endl;
+        if (command == "status") {
+            for (std::size_t index = 0; index < type_count; ++index) {
+                const auto level = static_cast<spdlog::level::level_enum>(writer.get(index));
+                const auto name  = spdlog::level::to_string_view(level);
+                std::cout << fmt::format("{:<16} {}", tt::log_type_names[index],
+                                         fmt::string_view(name.data(), name.size()))
+                          << std::endl;
+            }
+        }
+    } catch (const std::runtime_error & error) {
+        std::cerr << "tt-logger-ctl: " << error.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char ** argv) {
+    std::string path;
+    std::string job_id;
+    int         i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (std::strcmp(argv[i], "--pid") == 0 && i + 1 < argc) {
+            path = tt::default_control_socket_path(std::strtol(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else if (std::strcmp(argv[i], "--job") == 0 && i + 1 < argc) {
+            job_id = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+    if (!job_id.empty()) {
+        if (i == argc) {
+            return usage();
+        }
+        std::string argument;
+        for (int arg = i + 1; arg < argc; ++arg) {
+            argument += argument.empty() ? "" : ",";
+            argument += argv[arg];
+        }
+        return run_shared(job_id, argv[i], argument);
+    }
+    if (path.empty()) {
+        const char * env_path = std::getenv("TT_LOGGER_CONTROL_SOCKET");
+        if (!env_path || !*env_path || std::strcmp(env_path, "1") == 0) {
+            return usage();
+        }
+        path = env_path;
+    }
+    if (i == argc) {
+        return usage();
+    }
+
+    std::string command = argv[i];
+    for (++i; i < argc; ++i) {
+        command += ' ';
+        command += argv[i];
+    }
+
+    std::string reply;
+    try {
+        reply = tt::send_control_command(path, command);
+    } catch (const std::runtime_error & error) {
+        std::cerr << "tt-logger-ctl: " << error.what() << std::endl;
+        return 1;
+    }
+    if (reply.empty()) {
+        std::cerr << "tt-logger-ctl: no reply from '" << path << "'" << std::endl;
+        return 1;
+    }
+
+    const bool ok = reply.compare(0, 3, "ok\n") == 0;
+    (ok ? std::cout : std::cerr) << reply << std::flush;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-decode.cpp
+ * @brief Prints a binary log (TT_LOGGER_FILE=*.ttlog) in the usual human-readable format
+ *
+ * Usage: tt-logger-decode [--color | --plain] [FILE]
+ *
+ * Reads FILE, or stdin when no file is given, and writes one line per message to stdout using the same
+ * pattern as the text sinks. Output is colored when stdout is a terminal unless overridden.
+ */
+
+#include <spdlog/sinks/ansicolor_sink.h>
+#include <spdlog/sinks/stdout_sinks.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tt-logger/tt-logger.hpp>
+
+namespace {
+
+int usage() {
+    std::cerr << "Usage: tt-logger-decode [--color | --plain] [FILE]" << std::endl;
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char ** argv) {
+    bool         color = isatty(STDOUT_FILENO) != 0;
+    const char * path  = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--color") == 0) {
+            color = true;
+        } else if (std::strcmp(argv[i], "--plain") == 0) {
+            color = false;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            return usage();
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            return usage();
+        }
+    }
+
+    std::ifstream file;
+    if (path && std::strcmp(path, "-") != 0) {
+        file.open(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "tt-logger-decode: cannot open '" << path << "'" << std::endl;
+            return 1;
+        }
+    }
+    std::istream & in = file.is_open() ? static_cast<std::istream &>(file) : std::cin;
+
+    std::shared_ptr<spdlog::sinks::sink> sink;
+    if (color) {
+        sink = std::make_shared<spdlog::sinks::ansicolor_stdout_sink_st>(spdlog::color_mode::always);
+        sink->set_pattern(tt::colored_pattern);
+    } else {
+        sink = std::make_shared<spdlog::sinks::stdout_sink_st>();
+        sink->set_pattern(tt::plain_pattern);
+    }
+
+    tt::BinaryLogReader reader(in);
+    const bool complete = reader.read([&](const spdlog::details::log_msg & msg) { sink->log(msg); });
+    sink->flush();
+    if (!complete) {
+        std::cerr << "tt-logger-decode: " << reader.error() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent AI ULC
+//
+// SPDX-License-Identifier: Apache-2.0
+
+/**
+ * @file tt-logger-merge.cpp
+ * @brief Interleaves text logs written per LogType (TT_LOGGER_FILE=run-{type}.log) by timestamp
+ *
+ * Usage: tt-logger-merge FILE...
+ *
+ * Every file must already be in time order, as the text sinks write it. A message starts with the
+ * timestamp of the default pattern, "2025-01-31 12:00:00.123 | ..."; lines that do not are continuations
+ * of a multi-line message and stay with it. Messages with equal timestamps keep the order of the files
+ * on the command line. Files ending in .gz are read compressed when tt-logger was built with zlib.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <tt-logger/tt-logger.hpp>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+int usage() {
+    std::cerr << "Usage: tt-logger-merge FILE..." << std::endl;
+    return 2;
+}
+
+// Length of "YYYY-MM-DD HH:MM:SS.mmm", the timestamp at the start of plain_pattern
+constexpr std::size_t timestamp_length = 23;
+
+bool starts_message(std::string_view line) {
+    if (line.size() < timestamp_length) {
+        return false;
+    }
+    for (std::size_t index = 0; index < timestamp_length; ++index) {
+        const char c      = line[index];
+        const bool digit  = c >= '0' && c <= '9';
+        const char layout = "0000-00-00 00:00:00.000"[index];
+        if (layout == '0' ? !digit : c != layout) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads one input file line by line, decompressing .gz files
+class LineReader {
+  public:
+    explicit LineReader(const std::string & path) {
+#if TT_LOGGER_HAS_COMPRESSION
+        if (path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0) {
+            gz_ = gzopen(path.c_str(), "rb");
+            return;
+        }
+#endif
+        file_.open(path, std::ios::binary);
+    }
+
+    LineReader(const LineReader &)             = delete;
+    LineReader & operator=(const LineReader &) = delete;
+
+    ~LineReader() {
+#if TT_LOGGER_HAS_COMPRESSION
+        if (gz_) {
+            gzclose(gz_);
+        }
+#endif
+    }
+
+    bool is_open() const {
+#if TT_LOGGER_HAS_COMPRESSION
+        if (gz_) {
+            return true;
+        }
+#endif
+        return file_.is_open();
+    }
+
+    bool next(std::string & line) {
+#if TT_LOGGER_HAS_COMPRESSION
+        if (gz_) {
+            line.clear();
+            char chunk[4096];
+            while (gzgets(gz_, chunk, sizeof(chunk))) {
+                line += chunk;
+                if (!line.empty() && line.back() == '\n') {
+                    line.pop_back();
+                    return true;
+                }
+            }
+            return !line.empty();
+        }
+#endif
+        return static_cast<bool>(std::getline(file_, line));
+    }
+
+  private:
+    std::ifstream file_;
+#if TT_LOGGER_HAS_COMPRESSION
+    gzFile gz_ = nullptr;
+#endif
+};
+
+// One message of an input, with its continuation lines
+struct Message {
+    std::string text;
+    std::size_t input = 0;
+};
+
+class Input {
+  public:
+    explicit Input(const std::string & path) : reader_(path) {}
+
+    bool is_open() const { return reader_.is_open(); }
+
+    // Reads the next message, returning false at the end of the file
+    bool next(std::string & message) {
+        message.clear();
+        if (!has_lookahead_ && !reader_.next(lookahead_)) {
+            return false;
+        }
+        has_lookahead_ = false;
+        message        = std::move(lookahead_);
+        while (reader_.next(lookahead_)) {
+            if (starts_message(lookahead_)) {
+                has_lookahead_ = true;
+                break;
+            }
+            message += '\n';
+            message += lookahead_;
+        }
+        return true;
+    }
+
+  private:
+    LineReader  reader_;
+    std::string lookahead_;
+    bool        has_lookahead_ = false;
+};
+
+}  // namespace
+
+int main(int argc, char ** argv) {
+    if (argc < 2) {
+        return usage();
+    }
+    std::vector<std::unique_ptr<Input>> inputs;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            return usage();
+        }
+        inputs.push_back(std::make_unique<Input>(argv[i]));
+        if (!inputs.back()->is_open()) {
+            std::cerr << "tt-logger-merge: cannot open '" << argv[i] << "'" << std::endl;
+            return 1;
+        }
+    }
+
+    // Smallest timestamp first, then the earlier input
+    const auto later = [](const Message & a, const Message & b) {
+        const std::string_view a_time = std::string_view(a.text).substr(0, timestamp_length);
+        const std::string_view b_time = std::string_view(b.text).substr(0, timestamp_length);
+        return std::tie(a_time, a.input) > std::tie(b_time, b.input);
+    };
+    std::priority_queue<Message, std::vector<Message>, decltype(later)> pending(later);
+
+    Message message;
+    for (std::size_t index = 0; index < inputs.size(); ++index) {
+        if (inputs[index]->next(message.text)) {
+            message.input = index;
+            pending.push(std::move(message));
+        }
+    }
+    while (!pending.empty()) {
+        Message next = pending.top();
+        pending.pop();
+        std::cout << next.text << '\n';
+        if (inputs[next.input]->next(next.text)) {
+            pending.push(std::move(next));
+        }
+    }
+    std::cout.flush();
+    return std::cout ? 0 : 1;
+}